@@ -30,6 +30,43 @@ def setup_parser(common_parser, subparsers):
         required=True,
     )
 
+    parser.add_argument(
+        "--paired",
+        help="The reads are paired-end, given as consecutive mate 1 and mate 2 files:"
+        " eg '--reads s_1.fq s_2.fq'. Mates are then mapped jointly.",
+        action="store_true",
+        required=False,
+    )
+
+    parser.add_argument(
+        "--max_insert_size",
+        help="With --paired, the maximum distance between the mapping positions"
+        " of two mates in the prg. Default: 1000.",
+        type=int,
+        default=1000,
+        required=False,
+    )
+
+    parser.add_argument(
+        "--subsample_fraction",
+        help="Map only this fraction of the reads (or pairs), chosen at random"
+        " using the seed. Default: 1.",
+        type=float,
+        default=1.0,
+        required=False,
+    )
+
+    parser.add_argument(
+        "--max_mean_depth",
+        help="Stop mapping reads once the estimated mean depth of coverage of the"
+        " sites reaches this. Default: 0, maps all reads.",
+        type=float,
+        default=0.0,
+        required=False,
+    )
+
+    # Genotyping a batch of samples in one run ('--samples') is only offered by the
+    # gramtools_genotype executable: the steps after it check and rebase one sample.
     parser.add_argument(
         "--sample_id",
         help="A name for your dataset.\n" "Appears in the genotyping outputs.",
@@ -52,6 +89,32 @@ def setup_parser(common_parser, subparsers):
         required=False,
     )
 
+    parser.add_argument(
+        "--read_cache_size",
+        help="Maximum number of distinct reads whose mapping is cached, so that"
+        " duplicate reads are only searched once. Default: 0, no cache.",
+        type=int,
+        default=0,
+        required=False,
+    )
+
+    parser.add_argument(
+        "--numa",
+        help="On multi-socket machines, interleave the prg indices' memory over the"
+        " NUMA nodes, or replicate them on each node. Default: none.",
+        choices=["none", "interleave", "replicate"],
+        default="none",
+        required=False,
+    )
+
+    parser.add_argument(
+        "--huge_pages",
+        help="Back the prg indices with 2 MB transparent huge pages, which speeds up"
+        " read mapping on large prgs.",
+        action="store_true",
+        required=False,
+    )
+
     parser.add_argument(
         "--seed",
         help="Fix the seed to produce the same read mappings across different runs."
@@ -59,3 +122,11 @@ def setup_parser(common_parser, subparsers):
         type=int,
         required=False,
     )
+
+    parser.add_argument(
+        "--coverage_json",
+        help="Also write the coverage files in text and JSON formats.\n"
+        "Coverage is always written in binary format, to coverage/coverage.bin.",
+        action="store_true",
+        required=False,
+    )
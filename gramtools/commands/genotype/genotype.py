@@ -88,6 +88,20 @@ def _execute_command_cpp_genotype(geno_report, action, geno_paths, args):
 
     if args.seed is not None:
         command += ["--seed", str(args.seed)]
+    if args.coverage_json:
+        command += ["--coverage_json"]
+    if args.paired:
+        command += ["--paired", "--max_insert_size", str(args.max_insert_size)]
+    if args.subsample_fraction < 1:
+        command += ["--subsample_fraction", str(args.subsample_fraction)]
+    if args.max_mean_depth > 0:
+        command += ["--max_mean_depth", str(args.max_mean_depth)]
+    if args.read_cache_size > 0:
+        command += ["--read_cache_size", str(args.read_cache_size)]
+    if args.numa != "none":
+        command += ["--numa", args.numa]
+    if args.huge_pages:
+        command += ["--huge_pages"]
     if args.debug:
         command += ["--debug"]
 
@@ -46,7 +46,8 @@ class BuildAndGenotype:
     def run_genotype(self):
         args = it_tests.gramtools_main.root_parser.parse_args(
             f"genotype --gram_dir {self.gram_dir} --genotype_dir "
-            f"{self.geno_dir} --reads {self.reads_file} --sample_id test --force".split()
+            f"{self.geno_dir} --reads {self.reads_file} --sample_id test --force "
+            "--coverage_json".split()
         )
         genotype.run(args)
 
@@ -0,0 +1,25 @@
+/** @file
+ * Benchmarks of recording mapped reads' coverage.
+ */
+
+#include "bench_resources.hpp"
+#include "genotype/quasimap/coverage/coverage_common.hpp"
+
+using namespace gram;
+using namespace gram::bench;
+
+static void BM_record_search_states(benchmark::State& state) {
+  auto const& bench_prg = get_bench_prg(spec_from_state(state));
+  auto const& prg_info = bench_prg.prg_info;
+  auto const& mapped_states = bench_prg.trace.mapped_states;
+  auto coverage = coverage::generate::empty_structure(prg_info);
+  SelectionKey selection_key{1};
+  for (auto _ : state)
+    for (auto const& search_states : mapped_states)
+      benchmark::DoNotOptimize(coverage::record::search_states(
+          coverage, search_states, bench_prg.trace.read_length, prg_info,
+          selection_key++));
+  state.SetItemsProcessed(state.iterations() * mapped_states.size());
+  set_prg_counters(state, bench_prg);
+}
+BENCHMARK(BM_record_search_states)->Apply(synthetic_prg_args);
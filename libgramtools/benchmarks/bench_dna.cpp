@@ -0,0 +1,53 @@
+/** @file
+ * Benchmarks of the base encoding and reverse complement kernels, at each SIMD
+ * level the CPU supports.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+#include "common/dna_kernels.hpp"
+
+using namespace gram;
+
+namespace {
+std::string random_bases(std::size_t length) {
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> draw(0, 3);
+  std::string bases(length, 'A');
+  for (auto& base : bases) base = "ACGT"[draw(generator)];
+  return bases;
+}
+
+void simd_level_args(benchmark::internal::Benchmark* benchmark) {
+  for (int level = 0; level <= static_cast<int>(best_simd_level()); ++level)
+    for (int read_length : {150, 10000}) benchmark->Args({level, read_length});
+}
+}  // namespace
+
+static void BM_encode_bases(benchmark::State& state) {
+  auto const& kernels =
+      get_dna_kernels(static_cast<SimdLevel>(state.range(0)));
+  auto const bases = random_bases(state.range(1));
+  Sequence encoded(bases.size());
+  for (auto _ : state) {
+    kernels.encode(bases.data(), bases.size(), encoded.data());
+    benchmark::DoNotOptimize(encoded.data());
+  }
+  state.SetBytesProcessed(state.iterations() * bases.size());
+}
+BENCHMARK(BM_encode_bases)->Apply(simd_level_args);
+
+static void BM_reverse_complement_bases(benchmark::State& state) {
+  auto const& kernels =
+      get_dna_kernels(static_cast<SimdLevel>(state.range(0)));
+  auto const encoded = encode_dna_bases(random_bases(state.range(1)));
+  Sequence reverse(encoded.size());
+  for (auto _ : state) {
+    kernels.reverse_complement(encoded.data(), encoded.size(), reverse.data());
+    benchmark::DoNotOptimize(reverse.data());
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_reverse_complement_bases)->Apply(simd_level_args);
@@ -0,0 +1,231 @@
+#include "bench_resources.hpp"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+
+#include "build/kmer_index/build.hpp"
+#include "common/utils.hpp"
+#include "genotype/quasimap/search/BWT_search.hpp"
+#include "genotype/quasimap/search/encapsulated_search.hpp"
+#include "genotype/quasimap/search/vBWT_jump.hpp"
+#include "prg/linearised_prg.hpp"
+#include "submod_resources.hpp"
+
+using namespace gram;
+using namespace gram::bench;
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr std::size_t num_haplotypes{4};
+
+/**
+ * A fresh directory under the system's temporary directory, removed with its
+ * contents on destruction. The PRGs' data structures are built from files
+ * written there, so benchmarking never writes to the working directory.
+ */
+class ScratchDir {
+ public:
+  ScratchDir() {
+    auto pattern = (fs::temp_directory_path() / "gram_bench_XXXXXX").string();
+    if (mkdtemp(pattern.data()) == nullptr)
+      throw std::runtime_error("Could not create a directory from " + pattern);
+    path = pattern;
+  }
+  ~ScratchDir() {
+    std::error_code ec;
+    fs::remove_all(path, ec);
+  }
+  ScratchDir(ScratchDir const&) = delete;
+  ScratchDir& operator=(ScratchDir const&) = delete;
+
+  fs::path const& get() const { return path; }
+
+ private:
+  fs::path path;
+};
+
+/**
+ * Maps the read as quasimap does, recording each kernel's inputs.
+ */
+void trace_read(Sequence const& read, BenchPrg const& bench_prg,
+                MappingTrace& trace) {
+  auto const& prg_info = bench_prg.prg_info;
+  auto const kmer_size = bench_prg.kmer_size;
+  Sequence kmer(read.end() - kmer_size, read.end());
+  trace.seed_kmers.push_back(kmer);
+  auto const seed = bench_prg.kmer_index.find(kmer);
+  if (seed == bench_prg.kmer_index.end()) return;
+
+  auto search_states = seed->second;
+  for (std::size_t pos = read.size() - kmer_size; pos-- > 0;) {
+    trace.markers_inputs.push_back(search_states);
+    process_markers_search_states(search_states, prg_info);
+    trace.backwards_inputs.emplace_back(read[pos], search_states);
+    search_states = search_base_backwards(read[pos], search_states, prg_info);
+    if (search_states.empty()) return;
+  }
+  trace.encapsulated_inputs.push_back(search_states);
+  search_states = handle_allele_encapsulated_states(search_states, prg_info);
+  if (!search_states.empty())
+    trace.mapped_states.push_back(std::move(search_states));
+}
+
+std::unique_ptr<BenchPrg> make_bench_prg(SyntheticPrgSpec const& spec) {
+  SyntheticPrg synthetic_prg(spec);
+  auto bench_prg = std::make_unique<BenchPrg>();
+  auto& prg_info = bench_prg->prg_info;
+  ScratchDir const scratch_dir;
+  prg_info =
+      submods::generate_prg_info(prg_string_to_ints(synthetic_prg.bracketed()),
+                                 scratch_dir.get().string());
+  // As in the tests' prg_setup: rank supports need re-initialising in scope
+  sdsl::util::init_support(prg_info.rank_bwt_a, &prg_info.dna_bwt_masks.mask_a);
+  sdsl::util::init_support(prg_info.rank_bwt_c, &prg_info.dna_bwt_masks.mask_c);
+  sdsl::util::init_support(prg_info.rank_bwt_g, &prg_info.dna_bwt_masks.mask_g);
+  sdsl::util::init_support(prg_info.rank_bwt_t, &prg_info.dna_bwt_masks.mask_t);
+  sdsl::util::init_support(prg_info.prg_markers_rank,
+                           &prg_info.prg_markers_mask);
+  sdsl::util::init_support(prg_info.prg_markers_select,
+                           &prg_info.prg_markers_mask);
+
+  BuildParams parameters{};
+  parameters.kmers_size = bench_kmer_size;
+  parameters.max_read_size = bench_read_length;
+  parameters.all_kmers_flag = false;
+  bench_prg->kmer_size = bench_kmer_size;
+  bench_prg->kmer_index = kmer_index::build(parameters, prg_info);
+
+  std::mt19937_64 rng(spec.seed);
+  Sequences haplotypes;
+  for (std::size_t i = 0; i < num_haplotypes; ++i)
+    haplotypes.push_back(
+        encode_dna_bases(synthetic_prg.sample_haplotype(rng)));
+
+  auto& trace = bench_prg->trace;
+  trace.read_length = bench_read_length;
+  for (std::size_t i = 0; i < bench_num_reads; ++i) {
+    auto const& haplotype = haplotypes[i % num_haplotypes];
+    if (haplotype.size() < bench_read_length) break;
+    std::uniform_int_distribution<std::size_t> start_dist(
+        0, haplotype.size() - bench_read_length);
+    auto const start = haplotype.begin() + start_dist(rng);
+    Sequence read(start, start + bench_read_length);
+    trace_read(read, *bench_prg, trace);
+  }
+  return bench_prg;
+}
+}  // namespace
+
+SyntheticPrg::SyntheticPrg(SyntheticPrgSpec const& spec) : spec(spec) {
+  std::mt19937_64 rng(spec.seed);
+  segments.push_back(Segment{random_bases(spec.invariant_length, rng), {}});
+  for (std::size_t site = 0; site < spec.num_sites; ++site) {
+    segments.push_back(make_site(spec.nesting_depth, rng));
+    segments.push_back(Segment{random_bases(spec.invariant_length, rng), {}});
+  }
+  render(segments, prg);
+}
+
+std::string SyntheticPrg::random_bases(std::size_t length,
+                                       std::mt19937_64& rng) const {
+  static constexpr char bases[] = {'A', 'C', 'G', 'T'};
+  std::uniform_int_distribution<int> base_dist(0, 3);
+  std::string result;
+  for (std::size_t i = 0; i < length; ++i) result += bases[base_dist(rng)];
+  return result;
+}
+
+SyntheticPrg::Segment SyntheticPrg::make_site(std::size_t depth,
+                                              std::mt19937_64& rng) const {
+  Segment site;
+  for (std::size_t allele = 0; allele < spec.num_alleles; ++allele) {
+    Segments allele_segments;
+    // A nested site is flanked by bases of its parent allele
+    bool const nests_site = depth > 0 && allele == 0;
+    auto const flank_length = std::max<std::size_t>(spec.allele_length / 2, 1);
+    if (nests_site) {
+      allele_segments.push_back(Segment{random_bases(flank_length, rng), {}});
+      allele_segments.push_back(make_site(depth - 1, rng));
+      allele_segments.push_back(Segment{random_bases(flank_length, rng), {}});
+    } else
+      allele_segments.push_back(
+          Segment{random_bases(spec.allele_length, rng), {}});
+    site.alleles.push_back(std::move(allele_segments));
+  }
+  return site;
+}
+
+void SyntheticPrg::render(Segments const& segments, std::string& out) {
+  for (auto const& segment : segments) {
+    if (segment.alleles.empty()) {
+      out += segment.bases;
+      continue;
+    }
+    out += '[';
+    for (std::size_t i = 0; i < segment.alleles.size(); ++i) {
+      if (i > 0) out += ',';
+      render(segment.alleles[i], out);
+    }
+    out += ']';
+  }
+}
+
+void SyntheticPrg::sample(Segments const& segments, std::mt19937_64& rng,
+                          std::string& out) {
+  for (auto const& segment : segments) {
+    if (segment.alleles.empty()) {
+      out += segment.bases;
+      continue;
+    }
+    std::uniform_int_distribution<std::size_t> allele_dist(
+        0, segment.alleles.size() - 1);
+    sample(segment.alleles[allele_dist(rng)], rng, out);
+  }
+}
+
+std::string SyntheticPrg::sample_haplotype(std::mt19937_64& rng) const {
+  std::string result;
+  sample(segments, rng, result);
+  return result;
+}
+
+BenchPrg const& bench::get_bench_prg(SyntheticPrgSpec const& spec) {
+  using SpecKey = std::tuple<std::size_t, std::size_t, std::size_t,
+                             std::size_t, std::size_t, uint64_t>;
+  static std::map<SpecKey, std::unique_ptr<BenchPrg>> built;
+  SpecKey const key{spec.num_sites,   spec.invariant_length,
+                    spec.nesting_depth, spec.num_alleles,
+                    spec.allele_length, spec.seed};
+  auto found = built.find(key);
+  if (found == built.end())
+    found = built.emplace(key, make_bench_prg(spec)).first;
+  return *found->second;
+}
+
+SyntheticPrgSpec bench::spec_from_state(benchmark::State const& state) {
+  return SyntheticPrgSpec{static_cast<std::size_t>(state.range(0)),
+                          static_cast<std::size_t>(state.range(1)),
+                          static_cast<std::size_t>(state.range(2))};
+}
+
+void bench::synthetic_prg_args(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"sites", "spacing", "nesting"});
+  for (int64_t num_sites : {1000, 10000})
+    for (int64_t spacing : {10, 100})
+      for (int64_t nesting_depth : {0, 2})
+        benchmark->Args({num_sites, spacing, nesting_depth});
+}
+
+void bench::set_prg_counters(benchmark::State& state,
+                             BenchPrg const& bench_prg) {
+  state.counters["prg_length"] = bench_prg.prg_info.encoded_prg.size();
+  state.counters["kmers_indexed"] = bench_prg.kmer_index.size();
+  state.counters["reads_mapped"] = bench_prg.trace.mapped_states.size();
+}
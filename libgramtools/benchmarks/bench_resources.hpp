@@ -0,0 +1,117 @@
+/** @file
+ * Synthetic PRGs, and the inputs each mapping kernel sees when reads sampled
+ * from them are mapped, for benchmarking the kernels in isolation.
+ */
+
+#ifndef GRAMTOOLS_BENCH_RESOURCES_HPP
+#define GRAMTOOLS_BENCH_RESOURCES_HPP
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+#include "build/kmer_index/kmer_index_types.hpp"
+#include "genotype/quasimap/coverage/types.hpp"
+#include "genotype/quasimap/search/types.hpp"
+#include "prg/prg_info.hpp"
+
+namespace gram::bench {
+
+/**
+ * The shape of a synthetic PRG: `num_sites` top-level sites, each separated by
+ * `invariant_length` bases (so lower is denser), and each with `num_alleles`
+ * alleles of `allele_length` bases. Up to `nesting_depth` levels of sites are
+ * nested in the first allele of each site.
+ */
+struct SyntheticPrgSpec {
+  std::size_t num_sites;
+  std::size_t invariant_length;
+  std::size_t nesting_depth;
+  std::size_t num_alleles{2};
+  std::size_t allele_length{6};
+  uint64_t seed{1};
+};
+
+/**
+ * A randomly generated PRG, in bracketed format, and some of the haplotypes
+ * (paths through it) it encodes.
+ */
+class SyntheticPrg {
+ public:
+  explicit SyntheticPrg(SyntheticPrgSpec const& spec);
+
+  std::string const& bracketed() const { return prg; }
+  /** A random path through the PRG */
+  std::string sample_haplotype(std::mt19937_64& rng) const;
+
+ private:
+  struct Segment;
+  using Segments = std::vector<Segment>;
+  struct Segment {
+    std::string bases;            /**< Invariant bases, if not a site */
+    std::vector<Segments> alleles; /**< Empty if not a site */
+  };
+
+  SyntheticPrgSpec spec;
+  Segments segments;
+  std::string prg;
+
+  Segment make_site(std::size_t depth, std::mt19937_64& rng) const;
+  std::string random_bases(std::size_t length, std::mt19937_64& rng) const;
+  static void render(Segments const& segments, std::string& out);
+  static void sample(Segments const& segments, std::mt19937_64& rng,
+                     std::string& out);
+};
+
+/**
+ * The inputs each mapping kernel is called with when mapping reads sampled from
+ * a synthetic PRG, recorded by mapping them once up front.
+ */
+struct MappingTrace {
+  Sequences seed_kmers;
+  std::vector<SearchStates> markers_inputs;
+  std::vector<std::pair<int_Base, SearchStates>> backwards_inputs;
+  std::vector<SearchStates> encapsulated_inputs;
+  std::vector<SearchStates> mapped_states;
+  std::size_t read_length;
+};
+
+/**
+ * Everything needed to map reads to a synthetic PRG.
+ */
+struct BenchPrg {
+  PRG_Info prg_info;
+  KmerIndex kmer_index;
+  uint32_t kmer_size;
+  MappingTrace trace;
+};
+
+constexpr uint32_t bench_kmer_size{11};
+constexpr std::size_t bench_read_length{150};
+constexpr std::size_t bench_num_reads{2000};
+
+/**
+ * Builds the PRG's data structures (fm-index, masks, coverage graph and an
+ * index of the kmers in its sampled haplotypes), then maps reads sampled from
+ * those haplotypes. Built once per spec, and shared by all benchmarks.
+ */
+BenchPrg const& get_bench_prg(SyntheticPrgSpec const& spec);
+
+/**
+ * The spec described by a benchmark's arguments: number of sites, invariant
+ * bases between sites and nesting depth.
+ */
+SyntheticPrgSpec spec_from_state(benchmark::State const& state);
+
+/**
+ * Registers the argument combinations each kernel is run on.
+ */
+void synthetic_prg_args(benchmark::internal::Benchmark* benchmark);
+
+/**
+ * Records the PRG's shape in the benchmark's output.
+ */
+void set_prg_counters(benchmark::State& state, BenchPrg const& bench_prg);
+}  // namespace gram::bench
+
+#endif  // GRAMTOOLS_BENCH_RESOURCES_HPP
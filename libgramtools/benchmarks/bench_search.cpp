@@ -0,0 +1,85 @@
+/** @file
+ * Benchmarks of the kernels that search a read through the prg: the kmer
+ * lookup of its seed, backward search in the fm-index and vBWT jumps.
+ */
+
+#include "bench_resources.hpp"
+#include "genotype/quasimap/search/BWT_search.hpp"
+#include "genotype/quasimap/search/encapsulated_search.hpp"
+#include "genotype/quasimap/search/vBWT_jump.hpp"
+
+using namespace gram;
+using namespace gram::bench;
+
+static void BM_kmer_lookup(benchmark::State& state) {
+  auto const& bench_prg = get_bench_prg(spec_from_state(state));
+  auto const& kmers = bench_prg.trace.seed_kmers;
+  for (auto _ : state)
+    for (auto const& kmer : kmers)
+      benchmark::DoNotOptimize(bench_prg.kmer_index.find(kmer));
+  state.SetItemsProcessed(state.iterations() * kmers.size());
+  set_prg_counters(state, bench_prg);
+}
+BENCHMARK(BM_kmer_lookup)->Apply(synthetic_prg_args);
+
+static void BM_base_next_sa_interval(benchmark::State& state) {
+  auto const& bench_prg = get_bench_prg(spec_from_state(state));
+  auto const& prg_info = bench_prg.prg_info;
+  auto const& inputs = bench_prg.trace.backwards_inputs;
+  std::size_t num_calls{0};
+  for (auto _ : state) {
+    for (auto const& [base, search_states] : inputs) {
+      auto const char_first_sa_index =
+          prg_info.fm_index.C[prg_info.fm_index.char2comp[base]];
+      for (auto const& search_state : search_states)
+        benchmark::DoNotOptimize(base_next_sa_interval(
+            base, char_first_sa_index, search_state.sa_interval, prg_info));
+      num_calls += search_states.size();
+    }
+  }
+  state.SetItemsProcessed(num_calls);
+  set_prg_counters(state, bench_prg);
+}
+BENCHMARK(BM_base_next_sa_interval)->Apply(synthetic_prg_args);
+
+static void BM_search_base_backwards(benchmark::State& state) {
+  auto const& bench_prg = get_bench_prg(spec_from_state(state));
+  auto const& inputs = bench_prg.trace.backwards_inputs;
+  for (auto _ : state)
+    for (auto const& [base, search_states] : inputs)
+      benchmark::DoNotOptimize(
+          search_base_backwards(base, search_states, bench_prg.prg_info));
+  state.SetItemsProcessed(state.iterations() * inputs.size());
+  set_prg_counters(state, bench_prg);
+}
+BENCHMARK(BM_search_base_backwards)->Apply(synthetic_prg_args);
+
+static void BM_process_markers_search_states(benchmark::State& state) {
+  auto const& bench_prg = get_bench_prg(spec_from_state(state));
+  auto const& inputs = bench_prg.trace.markers_inputs;
+  for (auto _ : state) {
+    for (auto const& input : inputs) {
+      // The search states are extended in place, so each call gets a copy
+      state.PauseTiming();
+      auto search_states = input;
+      state.ResumeTiming();
+      process_markers_search_states(search_states, bench_prg.prg_info);
+      benchmark::DoNotOptimize(search_states);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * inputs.size());
+  set_prg_counters(state, bench_prg);
+}
+BENCHMARK(BM_process_markers_search_states)->Apply(synthetic_prg_args);
+
+static void BM_handle_allele_encapsulated_states(benchmark::State& state) {
+  auto const& bench_prg = get_bench_prg(spec_from_state(state));
+  auto const& inputs = bench_prg.trace.encapsulated_inputs;
+  for (auto _ : state)
+    for (auto const& search_states : inputs)
+      benchmark::DoNotOptimize(
+          handle_allele_encapsulated_states(search_states, bench_prg.prg_info));
+  state.SetItemsProcessed(state.iterations() * inputs.size());
+  set_prg_counters(state, bench_prg);
+}
+BENCHMARK(BM_handle_allele_encapsulated_states)->Apply(synthetic_prg_args);
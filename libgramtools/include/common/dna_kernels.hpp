@@ -0,0 +1,67 @@
+/** @file
+ * Kernels converting bases between ASCII and their integer encoding (1-4), and
+ * reverse complementing encoded bases. They run on every base of every read,
+ * so they are vectorised: the widest implementation the CPU supports is
+ * selected at runtime, with a scalar fallback.
+ */
+
+#ifndef GRAMTOOLS_DNA_KERNELS_HPP
+#define GRAMTOOLS_DNA_KERNELS_HPP
+
+#include <cstddef>
+
+#include "common/utils.hpp"
+
+namespace gram {
+
+enum class SimdLevel { scalar, sse4, avx2 };
+
+struct DnaKernels {
+  /**
+   * Encodes `num_bases` ASCII bases as by `encode_dna_base`.
+   * @return false if any base is not ACGT/acgt; `out` is then unspecified.
+   */
+  bool (*encode)(char const *bases, std::size_t num_bases, int_Base *out);
+
+  /** Decodes encoded bases; values outside 1-4 decode to 'N'. */
+  void (*decode)(int_Base const *bases, std::size_t num_bases, char *out);
+
+  /**
+   * Writes the reverse complement of encoded bases to `out`, which must not
+   * overlap them. Values outside 1-4 complement to 0.
+   */
+  void (*reverse_complement)(int_Base const *bases, std::size_t num_bases,
+                             int_Base *out);
+};
+
+/** The widest implementation supported by the CPU */
+SimdLevel best_simd_level();
+
+/**
+ * @throws std::invalid_argument if the CPU does not support `level`.
+ */
+DnaKernels const &get_dna_kernels(SimdLevel level);
+
+/** The kernels of `best_simd_level()`, selected once */
+inline DnaKernels const &dna_kernels() {
+  static DnaKernels const &kernels = get_dna_kernels(best_simd_level());
+  return kernels;
+}
+
+inline bool encode_bases(char const *bases, std::size_t num_bases,
+                         int_Base *out) {
+  return dna_kernels().encode(bases, num_bases, out);
+}
+
+inline void decode_bases(int_Base const *bases, std::size_t num_bases,
+                         char *out) {
+  dna_kernels().decode(bases, num_bases, out);
+}
+
+inline void reverse_complement_bases(int_Base const *bases,
+                                     std::size_t num_bases, int_Base *out) {
+  dna_kernels().reverse_complement(bases, num_bases, out);
+}
+}  // namespace gram
+
+#endif  // GRAMTOOLS_DNA_KERNELS_HPP
@@ -0,0 +1,43 @@
+/** @file
+ * Backing large, randomly accessed arrays with 2 MB transparent huge pages.
+ * Backward search accesses the FM index and BWT masks at random over gigabytes,
+ * so with 4 KB pages most of its accesses miss the TLB.
+ *
+ * Works on stock Linux kernels whose transparent huge pages are enabled as
+ * "always" or "madvise"; elsewhere, nothing is advised.
+ */
+
+#ifndef GRAMTOOLS_HUGE_PAGES_HPP
+#define GRAMTOOLS_HUGE_PAGES_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "common/data_types.hpp"
+
+namespace gram {
+
+constexpr std::size_t huge_page_size{std::size_t{1} << 21};
+
+/**
+ * Advises the kernel to back the huge page aligned part of the `num_bytes` at
+ * `data` with huge pages. Where supported (Linux 6.1+), the part is collapsed
+ * into huge pages straight away, rather than in the background.
+ * @return the number of bytes collapsed into huge pages: 0 if the range holds
+ * no aligned huge page, or if the kernel cannot collapse them (the background
+ * daemon may still back the part with huge pages later).
+ */
+uint64_t advise_huge_pages(void const *data, std::size_t num_bytes);
+
+template <uint8_t width>
+uint64_t advise_huge_pages(sdsl::int_vector<width> const &vector) {
+  return advise_huge_pages(vector.data(), vector.capacity() / 8);
+}
+
+template <typename T>
+uint64_t advise_huge_pages(std::vector<T> const &vector) {
+  return advise_huge_pages(vector.data(), vector.size() * sizeof(T));
+}
+}  // namespace gram
+
+#endif  // GRAMTOOLS_HUGE_PAGES_HPP
@@ -0,0 +1,102 @@
+/** @file
+ * Lightweight instrumentation, for attributing time and work to the phases of
+ * a run: nested wall clock and CPU time spans, per thread event counters, and
+ * peak memory use. Collected over the whole process and reported as JSON.
+ */
+
+#ifndef GRAMTOOLS_INSTRUMENTATION_HPP
+#define GRAMTOOLS_INSTRUMENTATION_HPP
+
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <string>
+
+namespace gram::instrumentation {
+
+enum class Counter : std::size_t {
+  reads_seeded,         /**< Reads whose seeding kmer is in the kmer index */
+  bases_extended,       /**< Read bases backward searched past the seed */
+  vbwt_jumps,           /**< Variant markers jumped through in the vBWT */
+  sa_positions_located, /**< Suffix array entries resolved to PRG positions */
+  coverage_records      /**< Read mappings recorded in coverage */
+};
+constexpr std::size_t num_counters{5};
+
+std::string counter_name(Counter counter);
+
+/**
+ * Adds to the calling thread's count. Each thread has its own counters, so this
+ * takes no lock and shares no cache line with other threads.
+ */
+void count(Counter counter, uint64_t amount = 1);
+
+/**
+ * Accumulates a count locally, adding it to the thread's count when destroyed.
+ * For counting in tight loops.
+ */
+class LocalCount {
+ private:
+  Counter counter;
+  uint64_t amount{0};
+
+ public:
+  explicit LocalCount(Counter counter) : counter(counter) {}
+  ~LocalCount() {
+    if (amount > 0) count(counter, amount);
+  }
+  LocalCount(LocalCount const&) = delete;
+  LocalCount& operator=(LocalCount const&) = delete;
+
+  LocalCount& operator+=(uint64_t const added) {
+    amount += added;
+    return *this;
+  }
+  LocalCount& operator++() { return *this += 1; }
+};
+
+/**
+ * Spans time a phase, in wall clock and process CPU (all threads) time. A span
+ * begun while another is open on the same thread is nested in it.
+ */
+void begin_span(std::string name);
+void end_span();
+
+/**
+ * Times the enclosing scope as a span.
+ */
+class Span {
+ public:
+  explicit Span(std::string name) { begin_span(std::move(name)); }
+  ~Span() { end_span(); }
+  Span(Span const&) = delete;
+  Span& operator=(Span const&) = delete;
+};
+
+/**
+ * Records that `num_bytes` of the named structure are backed by huge pages.
+ * Bytes recorded under the same name, eg by index replicas, add up.
+ */
+void record_huge_pages(std::string const& structure, uint64_t num_bytes);
+
+/**
+ * The process's peak resident set size so far, in bytes.
+ */
+uint64_t peak_rss_bytes();
+
+/**
+ * The completed spans, as a tree, the counter totals and per thread counts, the
+ * bytes of each structure backed by huge pages, and the peak resident set size.
+ */
+nlohmann::json report();
+void write_report(std::string const& fpath);
+
+/**
+ * Discards the completed spans and zeroes all counters, so that the next
+ * report only covers what follows, eg one job of a long-running process.
+ * Open spans and huge page bytes, which describe structures that outlive the
+ * reset, are kept. Must not be called while other threads are counting.
+ */
+void reset();
+}  // namespace gram::instrumentation
+
+#endif  // GRAMTOOLS_INSTRUMENTATION_HPP
@@ -0,0 +1,122 @@
+/** @file
+ * NUMA (non-uniform memory access) placement of the read-only indices reads are
+ * mapped against. On multi-socket machines, memory is attached to one socket's
+ * NUMA node, and threads on the other sockets access it with higher latency.
+ *
+ * Linux only: the topology is read from sysfs and memory policies are set with
+ * raw system calls, so no NUMA library is needed. Elsewhere, and on single node
+ * machines, there is one node and all placement is a no-op.
+ */
+
+#ifndef GRAMTOOLS_NUMA_HPP
+#define GRAMTOOLS_NUMA_HPP
+
+#include <string>
+#include <vector>
+
+namespace gram {
+
+enum class NumaPolicy {
+  none,       /**< Memory and threads are placed by the OS */
+  interleave, /**< Indices are loaded with their pages spread over the nodes */
+  replicate   /**< Each node's mapping threads use their own copy of the
+                 indices */
+};
+
+/**
+ * @param policy one of "none", "interleave" or "replicate"
+ * @throws std::invalid_argument on any other policy.
+ */
+NumaPolicy parse_numa_policy(std::string const &policy);
+
+struct NumaNode {
+  int id;
+  std::vector<int> cpus;
+};
+using NumaNodes = std::vector<NumaNode>;
+
+/**
+ * Parses a sysfs CPU list, eg "0-3,8,10-11".
+ * @throws std::invalid_argument if it is malformed.
+ */
+std::vector<int> parse_cpu_list(std::string const &cpu_list);
+
+/**
+ * Reads the nodes, and their CPUs, from a sysfs node directory (normally
+ * /sys/devices/system/node). Nodes without CPUs are left out.
+ * @return no nodes if the directory is missing.
+ */
+NumaNodes read_numa_nodes(std::string const &node_dirpath);
+
+/**
+ * The nodes whose CPUs the process may run on, restricted to those CPUs. There
+ * is always at least one node: without NUMA support, node 0 with all the
+ * allowed CPUs.
+ */
+NumaNodes const &numa_nodes();
+
+/** Index, in `numa_nodes()`, of the node the calling thread runs on */
+std::size_t current_numa_node_index();
+
+/** Restricts the calling thread to the CPUs of `node` */
+void pin_current_thread(NumaNode const &node);
+
+/**
+ * While in scope, memory first touched by the calling thread has its pages
+ * interleaved over all the nodes, so that no node serves all the accesses to
+ * it. Has no effect on a single node.
+ */
+class ScopedInterleave {
+ public:
+  explicit ScopedInterleave(bool enabled = true);
+  ~ScopedInterleave();
+
+  ScopedInterleave(ScopedInterleave const &) = delete;
+  ScopedInterleave &operator=(ScopedInterleave const &) = delete;
+
+ private:
+  bool interleaving{false};
+};
+
+/**
+ * While in scope, the calling thread may run on the CPUs of all the nodes, as
+ * may the threads it starts: they do not compete with a pinned thread for its
+ * node's CPUs. Its previous CPUs are restored on destruction.
+ */
+class ScopedUnpinned {
+ public:
+  ScopedUnpinned();
+  ~ScopedUnpinned();
+
+  ScopedUnpinned(ScopedUnpinned const &) = delete;
+  ScopedUnpinned &operator=(ScopedUnpinned const &) = delete;
+
+ private:
+  std::vector<int> previous_cpus;
+};
+
+/**
+ * While in scope, the threads of OpenMP parallel regions are each pinned to a
+ * node, in contiguous blocks of thread numbers spread evenly over the nodes.
+ * The threads' previous CPUs are restored on destruction.
+ * @note OpenMP runtimes reuse the same threads for successive parallel regions
+ * of the same size, which keep their pinning.
+ */
+class PinnedThreads {
+ public:
+  PinnedThreads();
+  ~PinnedThreads();
+
+  PinnedThreads(PinnedThreads const &) = delete;
+  PinnedThreads &operator=(PinnedThreads const &) = delete;
+
+  /** Index, in `numa_nodes()`, of the node OpenMP thread `thread_num` is on */
+  static std::size_t node_index(std::size_t thread_num, std::size_t num_threads,
+                                std::size_t num_nodes);
+
+ private:
+  std::vector<std::vector<int>> previous_cpus;
+};
+}  // namespace gram
+
+#endif  // GRAMTOOLS_NUMA_HPP
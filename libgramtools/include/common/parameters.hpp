@@ -12,6 +12,8 @@
 #include <boost/program_options/variables_map.hpp>
 #include <filesystem>
 
+#include "common/numa.hpp"
+
 namespace po = boost::program_options;
 namespace fs = std::filesystem;
 
@@ -51,8 +53,13 @@ class CommonParameters {
   std::string sa_intervals_fpath;
   std::string paths_fpath;
 
+  std::string instrumentation_fpath; /**< Timings and counters of the run */
+
   uint32_t kmers_size;
   uint32_t maximum_threads;
+  NumaPolicy numa_policy{NumaPolicy::none}; /**< Placement of the indices reads
+                                               are mapped against */
+  bool huge_pages{false}; /**< Back the PRG indices with huge pages */
 };
 
 std::string full_path(const std::string& base_dirpath,
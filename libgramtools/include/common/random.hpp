@@ -16,12 +16,6 @@ class RandomGenerator {
   virtual ~RandomGenerator(){};
 
   virtual uint32_t generate(uint32_t min, uint32_t max) = 0;
-
-  SeedSize operator()() { return random_number_generator(); }
-
- protected:
-  std::mt19937
-      random_number_generator;  // 32-bit unsigned random number generator
 };
 
 class RandomInclusiveInt : public RandomGenerator {
@@ -33,9 +27,46 @@ class RandomInclusiveInt : public RandomGenerator {
   uint32_t generate(uint32_t min, uint32_t max) override;
   Seed const& get_seed() const { return seed; }
 
+  SeedSize operator()() { return random_number_generator(); }
+
  private:
   Seed seed = std::nullopt;
+  std::mt19937
+      random_number_generator;  // 32-bit unsigned random number generator
+};
+
+/**
+ * Counter-based generator (SplitMix64). Its whole state is one 64-bit word, so
+ * it is O(1) to set up, and the numbers it draws only depend on its key.
+ */
+class CounterRandomInt : public RandomGenerator {
+ public:
+  explicit CounterRandomInt(SelectionKey const key) : state(key) {}
+
+  uint32_t generate(uint32_t min, uint32_t max) override;
+  uint64_t next();
+
+ private:
+  uint64_t state;
 };
+
+/**
+ * The key of the random stream used to select among the mapping instances of
+ * one orientation of one read. It only depends on the run's master seed and
+ * the read's index among all reads of the run, so selection does not depend on
+ * the number of threads or on how reads are batched.
+ */
+SelectionKey read_selection_key(SeedSize const master_seed,
+                                uint64_t const read_index,
+                                bool const reverse_complement);
+
+/**
+ * Whether a read is kept when subsampling a `fraction` of the reads. As for
+ * `read_selection_key`, this only depends on the master seed and the read's
+ * index, but the two are drawn independently.
+ */
+bool read_is_subsampled(SeedSize const master_seed, uint64_t const read_index,
+                        double const fraction);
 }  // namespace gram
 
 #endif  // GRAMTOOLS_RANDOM_HPP
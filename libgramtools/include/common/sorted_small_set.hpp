@@ -0,0 +1,72 @@
+/** @file
+ * A set stored as a sorted vector, for the small sets built once per mapped
+ * read.
+ */
+
+#ifndef GRAMTOOLS_SORTED_SMALL_SET_HPP
+#define GRAMTOOLS_SORTED_SMALL_SET_HPP
+
+#include <algorithm>
+#include <initializer_list>
+
+#include <boost/container/small_vector.hpp>
+
+namespace gram {
+
+/**
+ * An ordered set of unique elements, kept sorted in a vector which stores up to
+ * `N` elements inline: sets of at most `N` elements allocate nothing on the
+ * heap. Iteration order, equality and ordering are those of the `std::set` of
+ * the same elements.
+ */
+template <typename T, std::size_t N>
+class SortedSmallSet {
+ public:
+  using storage = boost::container::small_vector<T, N>;
+  using value_type = T;
+  using const_iterator = typename storage::const_iterator;
+  using iterator = const_iterator;
+
+  SortedSmallSet() = default;
+
+  SortedSmallSet(std::initializer_list<T> elements) {
+    for (auto const& element : elements) insert(element);
+  }
+
+  /**
+   * @return true if `element` was inserted, false if it was already present.
+   */
+  bool insert(T const& element) {
+    auto position = std::lower_bound(elements.begin(), elements.end(), element);
+    if (position != elements.end() && *position == element) return false;
+    elements.insert(position, element);
+    return true;
+  }
+
+  bool contains(T const& element) const {
+    return std::binary_search(elements.begin(), elements.end(), element);
+  }
+
+  const_iterator begin() const { return elements.begin(); }
+  const_iterator end() const { return elements.end(); }
+  std::size_t size() const { return elements.size(); }
+  bool empty() const { return elements.empty(); }
+  void clear() { elements.clear(); }
+
+  bool operator==(SortedSmallSet const& other) const {
+    return std::equal(begin(), end(), other.begin(), other.end());
+  }
+  bool operator!=(SortedSmallSet const& other) const {
+    return !(*this == other);
+  }
+  bool operator<(SortedSmallSet const& other) const {
+    return std::lexicographical_compare(begin(), end(), other.begin(),
+                                        other.end());
+  }
+
+ private:
+  storage elements;
+};
+}  // namespace gram
+
+#endif  // GRAMTOOLS_SORTED_SMALL_SET_HPP
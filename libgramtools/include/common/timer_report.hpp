@@ -1,9 +1,16 @@
 #include <boost/timer/timer.hpp>
+#include <string>
+#include <tuple>
+#include <vector>
 
 #ifndef GRAMTOOLS_TIMER_REPORT_HPP
 #define GRAMTOOLS_TIMER_REPORT_HPP
 
 namespace gram {
+/**
+ * Times a run's phases, in CPU time summed over threads and in wall clock time.
+ * Each phase is also recorded as an instrumentation span.
+ */
 class TimerReport {
  public:
   void start(std::string note);
@@ -12,12 +19,13 @@ class TimerReport {
 
   void report() const;
 
-  template <typename TypeCol1, typename TypeCol2>
-  void cout_row(TypeCol1 col1, TypeCol2 col2) const;
+  template <typename TypeCol1, typename TypeCol2, typename TypeCol3>
+  void cout_row(TypeCol1 col1, TypeCol2 col2, TypeCol3 col3) const;
 
  private:
   using Note = std::string;
-  using Entry = std::pair<Note, double>;
+  /** Note, CPU seconds, wall clock seconds */
+  using Entry = std::tuple<Note, double, double>;
 
   Note note;
   std::vector<Entry> logger;
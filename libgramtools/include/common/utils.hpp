@@ -50,6 +50,12 @@ Sequence encode_dna_bases(const std::string &dna_str);
 
 Sequence encode_dna_bases(const GenomicRead &read_sequence);
 
+/**
+ * Decodes encoded bases back into a dna string, eg to write a read out.
+ * Values outside 1-4 decode to 'N'.
+ */
+std::string decode_dna_bases(const Sequence &bases);
+
 /************
  * Hashing **
  ************/
@@ -1,5 +1,22 @@
+#include "common/timer_report.hpp"
+#include "genotype/quasimap/quasimap.hpp"
 #include "parameters.hpp"
 
+namespace gram::genotype {
+/**
+ * Map one sample's reads, genotype it and write its outputs. The coverage
+ * graph's per base coverage must be zero on entry; it is left holding the
+ * sample's coverage.
+ * With `parameters.from_coverage`, the sample's saved coverage is loaded
+ * instead of mapping its reads, and the kmer index is not used.
+ * @param indices built once for all the samples genotyped
+ * @return the read mapping counts
+ */
+QuasimapReadsStats genotype_sample(GenotypeParams const& parameters,
+                                   IndexReplicas const& indices,
+                                   bool const& debug, TimerReport& timer);
+}  // namespace gram::genotype
+
 namespace gram::commands::genotype {
 void run(GenotypeParams const& parameters, bool const& debug);
 }
@@ -65,8 +65,8 @@ class GenotypedSite {
 
   gtype_information get_all_gtype_info() const { return this->gtype_info; }
   void populate_site(gtype_information const& gtype_info);
-  GtypedIndices const get_genotype() const { return gtype_info.genotype; }
-  allele_vector const get_alleles() const { return gtype_info.alleles; }
+  GtypedIndices const& get_genotype() const { return gtype_info.genotype; }
+  allele_vector const& get_alleles() const { return gtype_info.alleles; }
   std::size_t const get_pos() const { return pos; }
   covG_ptr const get_site_end_node() const { return site_end_node; }
   std::optional<allele_vector> const& extra_alleles() const {
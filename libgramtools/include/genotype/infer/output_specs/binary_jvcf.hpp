@@ -0,0 +1,131 @@
+/**
+ * @file Binary encoding of jvcf files, with random access by site.
+ *
+ * Layout (fixed-width integers are little-endian, `varint` is LEB128):
+ *  - magic, uint32 format version
+ *  - site records, one after the other
+ *  - string table: varint count, then each string as varint size + bytes
+ *  - site offset table: one uint64 file offset per site record
+ *  - header: the jvcf without its "Sites", in CBOR
+ *  - footer: uint64 number of sites, uint64 offsets of the string table, of the
+ *  site offset table and of the header, then the magic again
+ *
+ * A site record starts with its encoding type. Columnar records store each
+ * field for all samples in turn: POS, SEG, ALS, then number of samples, GT,
+ * HAPG, COV, DP and FT, then any other (model-specific) field: as a number
+ * column if it holds one number per sample, as CBOR otherwise. All
+ * strings (segment IDs, alleles, filters, field names) are indices into the
+ * string table, so repeated alleles are stored once.
+ * Sites whose fields do not fit the columnar layout are stored as CBOR.
+ */
+#ifndef BINARY_JVCF_HPP
+#define BINARY_JVCF_HPP
+
+#include <istream>
+#include <ostream>
+#include <unordered_map>
+
+#include "fields.hpp"
+
+namespace gram::json {
+
+class BinaryJvcfException : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+namespace binary_jvcf {
+constexpr char magic[8] = {'G', 'R', 'A', 'M', 'B', 'J', 'V', 'C'};
+constexpr uint32_t version{1};
+constexpr std::size_t footer_size{sizeof(magic) + 4 * sizeof(uint64_t)};
+
+enum class SiteEncoding : uint8_t { columnar = 0, cbor = 1 };
+
+/**
+ * How a column of numbers is stored.
+ */
+enum class NumberEncoding : uint8_t {
+  unsigned_ints = 0,   /**< varints, read back as unsigned integers */
+  integral_floats = 1, /**< varints, read back as floats */
+  single_floats = 2,   /**< float32, for floats that it represents exactly */
+  floats = 3           /**< float64 */
+};
+
+/**
+ * How a field that is not part of the columnar layout is stored.
+ */
+enum class FieldEncoding : uint8_t {
+  numbers = 0, /**< One number per sample */
+  cbor = 1
+};
+}  // namespace binary_jvcf
+
+/**
+ * Writes a binary jvcf one site at a time. Only the string table and one
+ * offset per site are held in memory.
+ */
+class Binary_Jvcf_Writer {
+ private:
+  std::ostream& out;
+  JSON header;
+  uint64_t bytes_written;
+  std::vector<uint64_t> site_offsets;
+  std::unordered_map<std::string, uint64_t> string_indices;
+  std::vector<std::string const*> strings;
+  std::string buffer;  // The site being encoded
+  bool closed;
+
+  uint64_t string_index(std::string const& str);
+  bool encode_columnar(JSON const& site);
+  void put_other_field(JSON const& field, std::size_t const num_samples);
+  void flush_buffer();
+
+ public:
+  /**
+   * @param header the jvcf, whose "Sites" (if any) are ignored
+   */
+  Binary_Jvcf_Writer(std::ostream& out, JSON const& header);
+  ~Binary_Jvcf_Writer() { close(); }
+  Binary_Jvcf_Writer(Binary_Jvcf_Writer const&) = delete;
+  Binary_Jvcf_Writer& operator=(Binary_Jvcf_Writer const&) = delete;
+
+  void add_site(JSON const& site);
+  /**
+   * Writes the string table, site offset table, header and footer.
+   */
+  void close();
+};
+
+/**
+ * Reads sites from a binary jvcf, in any order. Needs a seekable stream.
+ */
+class Binary_Jvcf_Reader {
+ private:
+  std::istream& in;
+  JSON header;
+  uint64_t num_sites, offsets_start;
+  std::vector<std::string> strings;
+
+  std::string const& read_string();
+  JSON read_columnar_site();
+  JSON read_other_field(std::size_t const num_samples);
+
+ public:
+  explicit Binary_Jvcf_Reader(std::istream& in);
+
+  /**
+   * The jvcf with an empty "Sites" array.
+   */
+  JSON const& get_header() const { return header; }
+  std::size_t size() const { return num_sites; }
+  JSON get_site(std::size_t site_index);
+};
+
+/**
+ * Convert between text and binary jvcfs, one site at a time.
+ */
+void json_to_binary_jvcf(std::istream& json_in, std::ostream& binary_out);
+void binary_to_json_jvcf(std::istream& binary_in, std::ostream& json_out);
+
+}  // namespace gram::json
+
+#endif  // BINARY_JVCF_HPP
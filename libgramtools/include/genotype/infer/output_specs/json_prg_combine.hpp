@@ -0,0 +1,40 @@
+/**
+ * @file Streaming combination of jvcf files.
+ */
+#ifndef PRG_JSON_COMBINE
+#define PRG_JSON_COMBINE
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "json_prg_spec.hpp"
+
+namespace gram::json {
+
+/**
+ * Merges the jvcfs in `fpaths`, in order, site by site: only one site per
+ * input file is held in memory at a time.
+ * All inputs are open at once, so their number is bounded by the open file
+ * limit; see `combine_json_prgs` for merging more files.
+ * With `force`, a sample name seen before gets the lowest "_<n>" suffix that
+ * no sample has; otherwise, it throws a JSONConsistencyException.
+ */
+void merge_json_prgs(std::vector<std::string> const& fpaths, std::ostream& out,
+                     bool force = false);
+
+/**
+ * Merges any number of jvcfs as a tree reduction: groups of at most `fan_in`
+ * files get merged in parallel into temporary files, which are merged in turn,
+ * until at most `fan_in` files remain and get merged into `out_fpath`.
+ * Sample order is that of `fpaths`; with `force`, duplicate sample names are
+ * made unique over all of `fpaths`, as `merge_json_prgs` does.
+ * @throws JSONCombineException if the output cannot be written.
+ */
+void combine_json_prgs(std::vector<std::string> const& fpaths,
+                       std::string const& out_fpath, std::size_t fan_in = 32,
+                       bool force = false);
+
+}  // namespace gram::json
+
+#endif  // PRG_JSON_COMBINE
@@ -1,6 +1,8 @@
 #ifndef PRG_JSON_SPEC
 #define PRG_JSON_SPEC
 
+#include <istream>
+#include <ostream>
 #include <utility>
 
 #include "fields.hpp"
@@ -16,14 +18,85 @@ class Json_Prg {
   Json_Prg() : json_prg(gram::json::spec::json_prg) {}
   explicit Json_Prg(JSON input_json);
   void add_samples(Json_Prg& other, bool force = false);
+  /**
+   * Throws if the header entries (model, prg structure, site fields) of
+   * `other` do not allow combining it with this.
+   */
+  void check_combinable(Json_Prg const& other) const;
   void combine_with(Json_Prg& other, bool force = false);
   void set_sample_info(std::string const& name, std::string const& desc);
 
   void add_site(json_site_ptr const& json_site);
   void add_header(vcf_meta_info_line header);
   JSON& get_prg() { return json_prg; }
+  JSON const& get_prg() const { return json_prg; }
   void set_prg(JSON const& input_json);
 };
+
+/**
+ * Writes a jvcf one site at a time, so that the serialised sites never all
+ * need to be held in memory.
+ * The header (all entries but "Sites") is written on construction, whatever
+ * its key order; "Sites" is then always written last, as each site is added.
+ */
+class Json_Prg_Writer {
+ private:
+  std::ostream& out;
+  bool first_site;
+  bool closed;
+
+ public:
+  Json_Prg_Writer(std::ostream& out, JSON const& header);
+  ~Json_Prg_Writer() { close(); }
+  Json_Prg_Writer(Json_Prg_Writer const&) = delete;
+  Json_Prg_Writer& operator=(Json_Prg_Writer const&) = delete;
+
+  void add_site(JSON const& site);
+  void close();
+};
+
+/**
+ * Reads a jvcf one site at a time.
+ * All entries but "Sites" (the header) are parsed on construction; sites are
+ * then only parsed on demand, so memory use is bounded by the largest site.
+ * The stream must be seekable if header entries come after "Sites", which does
+ * not happen in jvcfs written by gramtools.
+ */
+class Json_Prg_Reader {
+ private:
+  std::istream& in;
+  JSON header;
+  bool first_site;
+  bool sites_done;
+  bool trailing_entries_read;
+
+  void skip_whitespace();
+  char expect(std::string const& allowed);
+  /**
+   * Copies the next JSON value from the stream as text, without parsing it.
+   * If `out` is nullptr the value is skipped.
+   */
+  void read_raw_value(std::string* out);
+  /**
+   * Reads top-level "key":value entries into the header, up to the closing
+   * brace, or up to the start of the "Sites" array if `stop_at_sites`.
+   */
+  void read_entries(bool stop_at_sites);
+  void read_header();
+
+ public:
+  explicit Json_Prg_Reader(std::istream& in);
+
+  /**
+   * The jvcf with an empty "Sites" array.
+   */
+  JSON const& get_header() const { return header; }
+
+  /**
+   * Reads the next site into `site`. Returns false once all sites are read.
+   */
+  bool next_site(JSON& site);
+};
 }  // namespace gram::json
 
 #endif  // PRG_JSON_SPEC
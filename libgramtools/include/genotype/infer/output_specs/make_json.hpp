@@ -16,6 +16,14 @@ class SegmentTracker;
 
 json_prg_ptr make_json_prg(gtyper_ptr const& gtyper, SegmentTracker& tracker);
 
+/**
+ * Same output as make_json_prg, but each site is serialised to `out` as soon as
+ * it is made rather than accumulated in a Json_Prg.
+ */
+void write_json_prg(std::ostream& out, gtyper_ptr const& gtyper,
+                    SegmentTracker& tracker, std::string const& sample_id,
+                    std::string const& sample_desc);
+
 /**
  * Populates the PRG-related entries (Lvl1_sites, child map) of a Json_Prg
  * class.
@@ -24,4 +32,10 @@ void populate_json_prg(Json_Prg& json_prg, gtyper_ptr const& gtyper);
 
 json_site_ptr make_json_site(gt_site_ptr const& gt_site);
 
+/**
+ * Makes a json site and sets its segment and (1-based) position within it.
+ */
+json_site_ptr make_positioned_json_site(gt_site_ptr const& gt_site,
+                                        SegmentTracker& tracker);
+
 #endif  // GTYPE_MAKE_JSON_HPP
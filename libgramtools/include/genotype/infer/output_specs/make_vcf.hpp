@@ -4,6 +4,8 @@
 #include <htslib/synced_bcf_reader.h>
 #include <htslib/vcf.h>
 
+#include <optional>
+
 #include "genotype/infer/interfaces.hpp"
 #include "genotype/parameters.hpp"
 
@@ -23,15 +25,26 @@ class VcfWriteException : public std::exception {
   virtual char const *what() const throw() { return msg.c_str(); }
 };
 
+/**
+ * Writes the genotyped lvl1 sites to a bgzipped vcf, compressing with up to
+ * `maximum_threads` threads, then indexes it alongside (.tbi, or .csi if any
+ * segment is too large for tabix).
+ */
 void write_vcf(gram::GenotypeParams const &params, gtyper_ptr const &gtyper,
                SegmentTracker &tracker);
+
+/**
+ * The `min_shift` to build the vcf index with: 0 for tbi, 14 for csi.
+ * No index is built if segment sizes are unknown (no coordinates file).
+ */
+std::optional<int> vcf_index_min_shift(SegmentTracker const &tracker);
 void populate_vcf_hdr(bcf_hdr_t *hdr, gtyper_ptr gtyper,
                       gram::GenotypeParams const &params,
                       SegmentTracker &tracker);
 
 void write_sites(htsFile *fout, bcf_hdr_t *header, gtyper_ptr const &gtyper,
                  SegmentTracker &tracker);
-void populate_vcf_site(bcf_hdr_t *header, bcf1_t *record, gt_site_ptr site,
-                       SegmentTracker &tracker);
+void populate_vcf_site(bcf_hdr_t *header, bcf1_t *record,
+                       gt_site_ptr const &site, SegmentTracker &tracker);
 
 #endif  // MAKE_VCF_HPP
@@ -1,6 +1,7 @@
 #ifndef GRAM_PERSONALISED_REF_H
 #define GRAM_PERSONALISED_REF_H
 
+#include <set>
 #include <string>
 #include <vector>
 #include "genotype/infer/types.hpp"
@@ -17,12 +18,18 @@ class Fasta {
   std::string sequence;
 
  public:
-  std::string const& get_sequence() { return sequence; }
+  std::string const& get_sequence() const { return sequence; }
   void set_ID(std::string new_ID) { this->ID = new_ID; }
   void set_desc(std::string new_desc) { this->desc = new_desc; }
   void add_sequence(std::string const& seq) { sequence += seq; }
+  void add_sequence(std::string const& seq, std::size_t start,
+                    std::size_t length) {
+    sequence.append(seq, start, length);
+  }
+  void reserve(std::size_t size) { sequence.reserve(size); }
 
   friend bool operator<(const Fasta& first, const Fasta& second);
+  friend bool operator==(const Fasta& first, const Fasta& second);
   friend std::ostream& operator<<(std::ostream& out_stream, const Fasta& input);
 };
 
@@ -37,12 +44,33 @@ class InconsistentPloidyException : public std::exception {
   }
 };
 
+/**
+ * The indices of the alleles of `site` that go in each of `ploidy` personalised
+ * references: the genotyped ones, or the first (REF) one for null sites.
+ */
+GtypedIndices allele_indices_to_paste(gt_site_ptr const& site,
+                                      std::size_t ploidy);
 allele_vector get_all_alleles_to_paste(gt_site_ptr const& site,
                                        std::size_t ploidy);
+
+/**
+ * Builds one personalised reference per segment and haplotype.
+ * A serial pass over the graph splits it into segments, recording what to
+ * paste in each; segments are then built in parallel, as OpenMP tasks.
+ * @note Inside a parallel region, exactly one thread must call this (eg from
+ * a `single` construct or a task): each calling thread would generate all the
+ * segments' tasks.
+ */
 Fastas get_personalised_ref(covG_ptr graph_root,
                             gt_sites const& genotyped_records,
                             SegmentTracker& tracker);
 
+/**
+ * Writes each distinct personalised reference sequence once, ordered by
+ * sequence.
+ */
+void write_deduped_p_refs(Fastas const& p_refs, std::string const& fpath);
+
 void add_description(Fastas& p_refs, std::string const& desc);
 }  // namespace gram::genotype
 
@@ -6,13 +6,25 @@
 #ifndef GRAMTOOLS_QUASIMAP_PARAMETERS_HPP
 #define GRAMTOOLS_QUASIMAP_PARAMETERS_HPP
 
+#include <istream>
+
 #include "common/parameters.hpp"
 
 namespace gram {
 enum class Ploidy { Haploid, Diploid };
 using SeedSize = uint32_t;
 using Seed = std::optional<SeedSize>;
-using Seeds = std::vector<SeedSize>;
+using SelectionKey =
+    uint64_t; /**< Keys the random selection of a read's mapping instance */
+
+/**
+ * A sample to genotype in batch mode: its ID and its reads files.
+ */
+struct GenotypeSample {
+  std::string sample_id;
+  std::vector<std::string> reads_fpaths;
+};
+using GenotypeSamples = std::vector<GenotypeSample>;
 
 class GenotypeParams : public CommonParameters {
  public:
@@ -21,7 +33,11 @@ class GenotypeParams : public CommonParameters {
   std::string allele_sum_coverage_fpath;
   std::string allele_base_coverage_fpath;
   std::string grouped_allele_counts_fpath;
+  std::string coverage_snapshot_fpath;
+  bool coverage_json{false}; /**< Also export coverage as text and JSON */
   std::string read_stats_fpath;
+  std::string read_mappings_fpath;
+  bool write_read_mappings{false};
 
   Ploidy ploidy;
   std::string sample_id;
@@ -32,6 +48,22 @@ class GenotypeParams : public CommonParameters {
   std::string debug_fpath;
 
   Seed seed = std::nullopt;
+  uint64_t read_cache_size{0}; /**< Max distinct reads whose mapping is cached;
+                                  0 disables the cache */
+  bool paired{false}; /**< `reads_fpaths` are consecutive (mate 1, mate 2)
+                         files of paired-end reads */
+  uint64_t max_insert_size{1000}; /**< Paired mode: max distance between the
+                                     mates' mapping instances in the prg */
+  double subsample_fraction{1}; /**< Fraction of the reads (or pairs) mapped */
+  double max_mean_depth{0}; /**< Reads stop being mapped once the level 1
+                               sites' mean depth reaches this; 0 for no cap */
+  uint64_t read_batch_size{5000}; /**< Reads loaded in memory, and mapped in
+                                     parallel, at a time */
+
+  std::string genotype_dirpath;
+  GenotypeSamples samples; /**< Only populated in batch mode */
+  bool from_coverage{false}; /**< Genotype from the coverage snapshot of a
+                                previous run, instead of mapping reads */
 };
 
 namespace commands::genotype {
@@ -44,6 +76,33 @@ namespace commands::genotype {
  */
 GenotypeParams parse_parameters(po::variables_map &vm,
                                 const po::parsed_options &parsed);
+
+/**
+ * Parse a samples manifest: one sample per line, as a sample ID followed by
+ * one or more reads files, separated by tabs. Empty lines and lines starting
+ * with '#' are ignored. Relative reads paths are made absolute. In paired
+ * mode, a sample's reads files are consecutive (mate 1, mate 2) pairs.
+ * @param reads_required if false, lines may have a sample ID only
+ * @throws std::invalid_argument on a line with no reads file or a duplicate
+ * sample ID.
+ */
+GenotypeSamples parse_samples_manifest(std::istream &manifest,
+                                       bool reads_required = true);
+
+/**
+ * Set the parameters' per-sample output file paths, under `run_dirpath`
+ * (creating its "coverage" and "genotype" subdirectories).
+ */
+void set_sample_output_paths(GenotypeParams &parameters,
+                             std::string const &run_dirpath);
+
+/**
+ * The parameters for genotyping one sample of a batch: same as `parameters`,
+ * but with the sample's ID, reads, and outputs in
+ * `parameters.genotype_dirpath/<sample_id>`.
+ */
+GenotypeParams make_sample_parameters(GenotypeParams const &parameters,
+                                      GenotypeSample const &sample);
 }  // namespace commands::genotype
 }  // namespace gram
 
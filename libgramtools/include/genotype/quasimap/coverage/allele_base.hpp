@@ -31,7 +31,8 @@ namespace record {
  * `SearchStates`, can have different mapping instances going through the same
  * `VariantLocus`.
  */
-void allele_base(PRG_Info const& prg_info, SearchStates const& search_states,
+void allele_base(PRG_Info const& prg_info,
+                 SearchStateRefs const& search_states,
                  uint64_t const& read_length);
 }  // namespace record
 
@@ -44,6 +45,12 @@ void allele_base(const Coverage& coverage, const GenotypeParams& parameters);
 }  // namespace dump
 }  // namespace coverage
 
+/**
+ * Write all base-level coverages for all sites of the prg in JSON format, one
+ * site at a time.
+ */
+void dump_allele_base_coverage(std::ostream& out,
+                               const SitesAlleleBaseCoverage& sites);
 std::string dump_allele_base_coverage(const SitesAlleleBaseCoverage& sites);
 
 /**
@@ -191,6 +198,8 @@ class PbCovRecorder {
  public:
   PbCovRecorder(PRG_Info const& prg_info, SearchStates const& search_states,
                 std::size_t read_size);
+  PbCovRecorder(PRG_Info const& prg_info, SearchStateRefs const& search_states,
+                std::size_t read_size);
 
   // Testing-related constructors
   PbCovRecorder() = default;
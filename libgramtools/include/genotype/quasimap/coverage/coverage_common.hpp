@@ -8,12 +8,14 @@
 #ifndef GRAMTOOLS_TEST_RESOURCES_HPP
 #define GRAMTOOLS_TEST_RESOURCES_HPP
 
+#include "common/sorted_small_set.hpp"
 #include "genotype/parameters.hpp"
 #include "genotype/quasimap/coverage/types.hpp"
 #include "genotype/quasimap/search/types.hpp"
 #include "prg/prg_info.hpp"
 
 namespace gram {
+struct SelectedMapping;
 
 /**
  * Each type of coverage operation (record, generate, dump) operates on each
@@ -23,10 +25,13 @@ namespace coverage::record {
 /**
  * Selects read mappings and records all coverage information.
  * @see selection()
+ * @return the selected mapping, which refers into `search_states`
  */
-void search_states(Coverage &coverage, const SearchStates &search_states,
-                   const uint64_t &read_length, const PRG_Info &prg_info,
-                   SeedSize const &selection_seed = 0);
+SelectedMapping search_states(Coverage &coverage,
+                              const SearchStates &search_states,
+                              const uint64_t &read_length,
+                              const PRG_Info &prg_info,
+                              SelectionKey const selection_key = 0);
 }  // namespace coverage::record
 
 namespace coverage::generate {
@@ -39,12 +44,19 @@ Coverage empty_structure(const PRG_Info &prg_info);
 
 namespace coverage::dump {
 /**
- * Write coverage information to disk.
+ * Write coverage information to disk, in text and JSON formats.
+ * @see coverage::dump::snapshot() for the binary format.
  */
 void all(const Coverage &coverage, const GenotypeParams &parameters);
 }  // namespace coverage::dump
 
-using SitePath = std::set<Marker>;
+/**
+ * Reads mostly overlap a few sites, so the per-read sets below hold that many
+ * elements without heap allocation.
+ */
+constexpr std::size_t inline_sites{4};
+
+using SitePath = SortedSmallSet<Marker, inline_sites>;
 
 class RandomGenerator;
 
@@ -54,8 +66,8 @@ using rand_ptr = RandomGenerator *const;
  * A set of site marker IDs signalling non-nested bubbles. One set defines an
  * equivalence class.
  */
-using level0_Sites = std::set<Marker>;
-using uniqueLoci = std::set<VariantLocus>;
+using level0_Sites = SortedSmallSet<Marker, inline_sites>;
+using uniqueLoci = SortedSmallSet<VariantLocus, inline_sites>;
 
 using info_ptr = PRG_Info const *const;
 
@@ -70,16 +82,14 @@ using info_ptr = PRG_Info const *const;
  */
 class LocusFinder {
  public:
-  LocusFinder() : search_state(), prg_info(nullptr){};
+  LocusFinder() = default;
 
-  LocusFinder(SearchState search_state, info_ptr prg_info);
+  LocusFinder(SearchState const &search_state, info_ptr prg_info);
 
   /** Sanity check: are all variant site markers in the `SearchState` different?
    */
   void check_site_uniqueness(SearchState const &search_state);
 
-  void check_site_uniqueness() { check_site_uniqueness(this->search_state); }
-
   /**
    * Takes a `VariantLocus` and registers it as well as all sites it is nested
    * within, up to a level 0 site.
@@ -93,42 +103,39 @@ class LocusFinder {
   void assign_traversing_loci(SearchState const &search_state,
                               info_ptr prg_info);
 
-  void assign_traversing_loci() {
-    assign_traversing_loci(this->search_state, this->prg_info);
-  }
-
   void assign_traversed_loci(SearchState const &search_state,
                              info_ptr prg_info);
 
-  void assign_traversed_loci() {
-    assign_traversed_loci(this->search_state, this->prg_info);
-  }
-
   level0_Sites base_sites; /**< Form the basis for `SearchState` selection */
   SitePath used_sites;     /**< For remembering which sites have already been
                               processed */
   uniqueLoci unique_loci;  /**< For grouped allele counts coverage recording */
- private:
-  SearchState const search_state;
-  info_ptr prg_info;
 };
 
 /**
- * Models an equivalence class: a list of `SearchState`s that are all compatible
- * with the same level 0 sites. The second member, `uniqueLoci`, is the set of
- * all `VariantLocus` that the `SearchStates` are compatible with.
+ * Models an equivalence class: the `SearchState`s that are all compatible with
+ * the same level 0 sites, referred to by their position in the selector's
+ * input. `loci` is the set of all `VariantLocus` that they are compatible with.
  */
-using traversal_info = std::pair<SearchStates, uniqueLoci>;
+struct EquivalenceClass {
+  level0_Sites sites;
+  SearchStateRefs search_states;
+  uniqueLoci loci;
+};
 /**
- * Models a set of equivalence classes: each `level0_Sites` is a set of site
- * markers at level 0, ie non-nested bubbles. This data structure is the basis
- * for: -Dispatching `SearchState`s into their equivalence class -Random
+ * Models a set of equivalence classes, sorted by their `level0_Sites`: sets of
+ * site markers at level 0, ie non-nested bubbles. This data structure is the
+ * basis for: -Dispatching `SearchState`s into their equivalence class -Random
  * selection of one equivalence class.
  */
-using uniqueSitePaths = std::map<level0_Sites, traversal_info>;
+using uniqueSitePaths = boost::container::small_vector<EquivalenceClass, 1>;
 
+/**
+ * The selected `SearchState`s refer into those selected from, so a selection
+ * must not outlive them.
+ */
 struct SelectedMapping {
-  SearchStates
+  SearchStateRefs
       navigational_search_states;    /**< Use: recording per base coverage*/
   uniqueLoci equivalence_class_loci; /**< Use: recording grouped allele count
                                         and allele sum coverage*/
@@ -145,7 +152,7 @@ class MappingInstanceSelector {
   uniqueSitePaths usps; /**< Key dispatching and selection object.*/
 
   // Constructor
-  MappingInstanceSelector(SearchStates const search_states, info_ptr prg_info,
+  MappingInstanceSelector(SearchStates const &search_states, info_ptr prg_info,
                           rand_ptr rand_generator);
 
   // Constructors for testing
@@ -159,12 +166,14 @@ class MappingInstanceSelector {
 
   void process_searchstates(SearchStates const &all_ss);
 
-  void set_searchstates(SearchStates const &ss) { input_search_states = ss; }
+  /** The `SearchStates` must outlive the selector */
+  void set_searchstates(SearchStates const &ss) { input_search_states = &ss; }
 
   /**
-   * Dispatches a `SearchState` into `usps` using `LocusFinder`.
+   * Dispatches a `SearchState` into `usps` using `LocusFinder`. The
+   * `SearchState` must outlive the selector.
    */
-  void add_searchstate(SearchState const &ss);
+  void add_searchstate(SearchStates::const_iterator ss);
 
   uint32_t count_nonvar_search_states(SearchStates const &search_states);
 
@@ -177,12 +186,14 @@ class MappingInstanceSelector {
    */
   int32_t random_select_entry();
 
+  /** Moves out the `SearchState`s and loci of the selected class */
   void apply_selection(int32_t selected_index);
 
-  SelectedMapping get_selection() { return selected; }
+  /** Moves the selection out of the selector: call at most once */
+  SelectedMapping get_selection() { return std::move(selected); }
 
  private:
-  SearchStates input_search_states;
+  SearchStates const *input_search_states = nullptr;
   SelectedMapping selected; /**< stores the choice made*/
   info_ptr prg_info;
   rand_ptr rand_generator;
@@ -0,0 +1,93 @@
+/** @file
+ * Binary coverage format: all the coverage recorded by quasimap, so that a
+ * sample can be re-genotyped (e.g. with a different ploidy) without re-mapping
+ * its reads, and so that any one site's coverage can be read on its own.
+ *
+ * Layout (fixed-width integers are little-endian, `varint` is LEB128):
+ *  - magic, uint32 format version
+ *  - site records, one per variant site, in site order. Each holds the site's
+ * allele sum coverage (varint number of alleles, then one varint per allele),
+ * its grouped allele counts (varint number of groups, then for each group its
+ * varint number of alleles, the varint allele IDs and the varint count), and
+ * the per base coverage of the coverage graph nodes directly in the site
+ * (varint number of nodes, then for each node in PRG order its varint size and
+ * one varint per base)
+ *  - site offset table: one uint64 file offset per site record
+ *  - footer: uint64 number of sites, uint64 offset of the site offset table,
+ * then the magic again
+ *
+ * Nested sites' nodes are stored with the innermost site they are in.
+ */
+
+#ifndef GRAMTOOLS_COVERAGE_SNAPSHOT_HPP
+#define GRAMTOOLS_COVERAGE_SNAPSHOT_HPP
+
+#include <istream>
+#include <ostream>
+
+#include "genotype/parameters.hpp"
+#include "genotype/quasimap/coverage/types.hpp"
+#include "prg/prg_info.hpp"
+
+namespace gram {
+
+class CoverageSnapshotException : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+namespace coverage {
+namespace snapshot {
+constexpr char magic[8] = {'G', 'R', 'A', 'M', 'C', 'O', 'V', 'S'};
+constexpr uint32_t version{2};
+constexpr std::size_t footer_size{sizeof(magic) + 2 * sizeof(uint64_t)};
+
+/**
+ * The coverage recorded in one variant site.
+ */
+struct SiteCoverage {
+  PerAlleleCoverage allele_sums;
+  GroupedAlleleCounts grouped_allele_counts;
+  std::vector<PerBaseCoverage> nodes_coverage;
+};
+}  // namespace snapshot
+
+namespace dump {
+/**
+ * Write `coverage`, and the per base coverage held in the coverage graph, to
+ * `parameters.coverage_snapshot_fpath`, in one streaming pass over the sites.
+ */
+void snapshot(Coverage const& coverage, PRG_Info const& prg_info,
+              GenotypeParams const& parameters);
+void snapshot(Coverage const& coverage, coverage_Graph const& coverage_graph,
+              std::ostream& out);
+}  // namespace dump
+
+namespace load {
+/**
+ * Read back a coverage snapshot made against the same prg. Per base coverage
+ * is restored onto the coverage graph.
+ * @throws CoverageSnapshotException if the snapshot is malformed, or was made
+ * against a different prg.
+ */
+Coverage snapshot(PRG_Info const& prg_info, GenotypeParams const& parameters);
+Coverage snapshot(std::istream& in, PRG_Info const& prg_info);
+}  // namespace load
+}  // namespace coverage
+
+/**
+ * Reads sites from a coverage snapshot, in any order. Needs a seekable stream.
+ */
+class CoverageSnapshotReader {
+ private:
+  std::istream& in;
+  uint64_t num_sites, offsets_start;
+
+ public:
+  explicit CoverageSnapshotReader(std::istream& in);
+
+  std::size_t size() const { return num_sites; }
+  coverage::snapshot::SiteCoverage get_site(std::size_t site_index);
+};
+}  // namespace gram
+
+#endif  // GRAMTOOLS_COVERAGE_SNAPSHOT_HPP
@@ -0,0 +1,64 @@
+/** @file
+ * The read-only indices reads are mapped against, replicated per NUMA node so
+ * that mapping threads read local memory.
+ */
+
+#ifndef GRAMTOOLS_INDEX_REPLICAS_HPP
+#define GRAMTOOLS_INDEX_REPLICAS_HPP
+
+#include <memory>
+#include <vector>
+
+#include "build/kmer_index/kmer_index_types.hpp"
+#include "common/numa.hpp"
+#include "prg/prg_info.hpp"
+
+namespace gram {
+
+/**
+ * The PRG's and kmer indices. With `NumaPolicy::replicate` on several NUMA
+ * nodes, each node gets a copy, made by a thread pinned to it so that the copy
+ * is allocated in the node's memory; mapping threads then use their node's
+ * copy. Otherwise, all threads use the original indices.
+ * @note Mapping threads must be pinned to nodes (see `PinnedThreads`) for their
+ * copy to stay local.
+ */
+class IndexReplicas {
+ public:
+  /**
+   * @param huge_pages back the copies with huge pages, as `load_prg_info` does
+   * the original.
+   */
+  IndexReplicas(PRG_Info const &prg_info, KmerIndex const &kmer_index,
+                NumaPolicy policy = NumaPolicy::none, bool huge_pages = false);
+
+  /** The original indices: coverage is recorded against these */
+  PRG_Info const &prg_info() const { return original_prg_info; }
+  KmerIndex const &kmer_index() const { return original_kmer_index; }
+
+  /** The copy of the node the calling thread runs on */
+  PRG_Info const &local_prg_info() const;
+  KmerIndex const &local_kmer_index() const;
+
+  std::size_t num_replicas() const { return replicas.size(); }
+
+ private:
+  struct Replica {
+    Replica(PRG_Info const &prg_info, KmerIndex const &kmer_index)
+        : prg_info(copy_prg_info_for_mapping(prg_info)),
+          kmer_index(kmer_index) {}
+
+    PRG_Info prg_info;
+    KmerIndex kmer_index;
+  };
+
+  Replica const *local_replica() const;
+
+  PRG_Info const &original_prg_info;
+  KmerIndex const &original_kmer_index;
+  std::vector<std::unique_ptr<Replica>> replicas; /**< Indexed as
+                                                     `numa_nodes()` */
+};
+}  // namespace gram
+
+#endif  // GRAMTOOLS_INDEX_REPLICAS_HPP
@@ -5,9 +5,16 @@
 #ifndef GRAMTOOLS_QUASIMAP_HPP
 #define GRAMTOOLS_QUASIMAP_HPP
 
+#include <array>
+#include <vector>
+
 #include "build/kmer_index/kmer_index_types.hpp"
 #include "genotype/parameters.hpp"
 #include "genotype/quasimap/coverage/coverage_common.hpp"
+#include "genotype/quasimap/index_replicas.hpp"
+#include "genotype/quasimap/read_cache.hpp"
+#include "genotype/quasimap/read_mappings.hpp"
+#include "genotype/quasimap/read_view.hpp"
 #include "genotype/read_stats.hpp"
 #include "search/encapsulated_search.hpp"
 #include "sequence_read/seqread.hpp"
@@ -20,37 +27,178 @@ struct QuasimapReadsStats {
   uint64_t missing_kmer_reads_count = 0;
   uint64_t no_extension_reads_count = 0;
   uint64_t exact_mapped_reads_count = 0;
+  uint64_t unpaired_reads_count = 0; /**< Paired mode: mates not recorded, or
+                                        not searched, because the other mate
+                                        did not map concordantly */
+  uint64_t unpaired_repetitive_reads_count = 0; /**< Paired mode: mates
+                                                   recorded independently, as
+                                                   too repetitive to pair */
+  uint64_t subsampled_out_reads_count = 0; /**< Not mapped: not subsampled */
   Coverage coverage = {};
+  std::vector<ReadTally> read_tallies; /**< One per mapping thread */
+};
+
+/**
+ * Estimates, as reads are mapped, the mean depth of coverage of the level 1
+ * (non-nested) sites: the mean of their alleles' summed coverage. Reads
+ * compatible with several alleles of a site count once for each.
+ */
+class DepthEstimator {
+ public:
+  explicit DepthEstimator(const PRG_Info &prg_info);
+  double mean_depth(AlleleSumCoverage const &allele_sum_coverage) const;
+
+ private:
+  std::vector<std::size_t> level1_site_indices;
 };
 
 /**
  * For each read file, quasimap reads.
+ * @param indices each node's threads map against their node's copy of the
+ * indices. They are built, and mapping threads pinned to NUMA nodes (see
+ * `PinnedThreads`), once by the caller for all the samples it maps.
  */
 QuasimapReadsStats quasimap_reads(const GenotypeParams &parameters,
-                                  const KmerIndex &kmer_index,
-                                  const PRG_Info &prg_info,
+                                  IndexReplicas const &indices,
                                   ReadStats &readstats);
 
 /**
  * Load and process (ie map) reads from a given read file using a buffer to
- * reduce disk I/O calls
+ * reduce disk I/O calls. The reads are also tallied, in
+ * `quasimap_stats.read_tallies`, for computing `ReadStats`.
+ * @param read_index the index, among all the reads of the run, of the file's
+ * first read; advanced past the file's reads.
+ * @param indices each read is mapped against the indices of the NUMA node its
+ * thread runs on.
+ * @return false if reads stopped being mapped before the end of the file, as
+ * `parameters.max_mean_depth` was reached.
  */
-void handle_read_file(QuasimapReadsStats &quasimap_stats,
+bool handle_read_file(QuasimapReadsStats &quasimap_stats,
                       const std::string &reads_fpath,
                       const GenotypeParams &parameters,
-                      const KmerIndex &kmer_index, const PRG_Info &prg_info,
-                      RandomGenerator *const seed_generator);
+                      IndexReplicas const &indices,
+                      SeedSize const master_seed, uint64_t &read_index,
+                      ReadMappingCache *const read_cache = nullptr,
+                      ReadMappingWriter *const mapping_writer = nullptr);
+
+/**
+ * As `handle_read_file`, for paired-end reads: the mates of each pair, the
+ * reads at the same index in the two files, are read in lock-step and mapped
+ * jointly by `quasimap_pair`.
+ * @param pair_index the index, among all the pairs of the run, of the files'
+ * first pair; advanced past the files' pairs.
+ * @return false if reads stopped being mapped before the end of the files.
+ * @throws std::runtime_error if the files have different numbers of reads.
+ */
+bool handle_read_pair_files(QuasimapReadsStats &quasimap_stats,
+                            const std::string &mate1_fpath,
+                            const std::string &mate2_fpath,
+                            const GenotypeParams &parameters,
+                            IndexReplicas const &indices,
+                            SeedSize const master_seed, uint64_t &pair_index,
+                            ReadMappingCache *const read_cache = nullptr,
+                            ReadMappingWriter *const mapping_writer = nullptr);
 
 /**
  * Calls quasimapping routine on a given read (forward mapping), and its reverse
- * complement (reverse mapping)
+ * complement (reverse mapping). Each orientation's mapping instance is selected
+ * using the random stream keyed by `master_seed`, `read_index` and the strand.
+ * @param mapping_writer if not null, the read's selected mappings are written
+ * to it, under `read_name`.
  */
 void quasimap_forward_reverse(QuasimapReadsStats &quasimap_stats,
-                              const Sequence &read,
+                              ReadView const &read,
                               const GenotypeParams &parameters,
                               const KmerIndex &kmer_index,
                               const PRG_Info &prg_info,
-                              SeedSize const &selection_seed);
+                              SeedSize const master_seed,
+                              uint64_t const read_index,
+                              ReadMappingCache *const read_cache = nullptr,
+                              std::string_view const read_name = {},
+                              ReadMappingWriter *const mapping_writer = nullptr);
+
+/**
+ * Maps the two mates of a read pair jointly, in both of the pair's
+ * orientations: mate 1 forward and mate 2 reverse complemented, and the
+ * converse. In each orientation:
+ *  - If either mate's seeding kmer is not indexed, the pair is dropped before
+ *  extending either mate; if mate 1 does not map, mate 2 is not extended.
+ *  - The pairs of mapping instances, one per mate, within
+ *  `parameters.max_insert_size` of one another are listed (see
+ *  `concordant_pairs`).
+ *  - One of them is drawn at random, keyed by `master_seed`, `pair_index` and
+ *  the orientation, and coverage is recorded for both of its mates' instances.
+ * Mates dropped with their pair are counted as `unpaired_reads_count`. If
+ * either mate has more than `max_located_instances` mapping instances, the
+ * mates are not paired but each recorded independently, as in single-end mode,
+ * and counted as `unpaired_repetitive_reads_count`.
+ */
+void quasimap_pair(QuasimapReadsStats &quasimap_stats, ReadView const &mate1,
+                   ReadView const &mate2, const GenotypeParams &parameters,
+                   const KmerIndex &kmer_index, const PRG_Info &prg_info,
+                   SeedSize const master_seed, uint64_t const pair_index,
+                   ReadMappingCache *const read_cache = nullptr,
+                   std::string_view const mate1_name = {},
+                   std::string_view const mate2_name = {},
+                   ReadMappingWriter *const mapping_writer = nullptr);
+
+/**
+ * Mates with more mapping instances than this are not located in the prg, and
+ * so are not paired: listing all their pairs would cost too much.
+ */
+constexpr uint64_t max_located_instances{64};
+
+/** The number of mapping instances, ie SA indices, of the search states */
+uint64_t count_instances(SearchStates const &search_states);
+
+/** One mapping instance of a mate: an SA index of one of its search states */
+struct MateInstance {
+  SearchState const *search_state;
+  SA_Index sa_index;
+  uint64_t position; /**< Of the instance in the linearised prg */
+};
+using ConcordantPair = std::array<MateInstance, 2>;
+
+/**
+ * Lists the pairs of mapping instances, one of each mate, within
+ * `max_insert_size` of one another in the linearised prg. Its coordinates also
+ * count site markers and the alleles of the sites in between, so
+ * `max_insert_size` should allow for them.
+ * @return the pairs, ordered by mate 1's then mate 2's instance position;
+ * none if either mate has more than `max_located_instances` instances.
+ */
+std::vector<ConcordantPair> concordant_pairs(SearchStates const &mate1_states,
+                                             SearchStates const &mate2_states,
+                                             const PRG_Info &prg_info,
+                                             uint64_t const max_insert_size);
+
+/** A read's mapping: computed, or shared with the read cache */
+struct FoundMapping {
+  ReadMapping_ptr cached;
+  std::optional<ReadMapping> computed;
+
+  ReadMapping const &get() const {
+    return cached != nullptr ? *cached : *computed;
+  }
+};
+
+/**
+ * A mapped read's selected mapping instance(s), kept with the mapping they
+ * were selected from, which the selection refers into. Moving it keeps the
+ * selection valid, as the search states' list nodes move with it; copying
+ * would not, so is disallowed.
+ */
+struct MappedRead {
+  MappedRead(FoundMapping mapping, SelectedMapping selected)
+      : mapping(std::move(mapping)), selected(std::move(selected)) {}
+  MappedRead(MappedRead &&) = default;
+  MappedRead &operator=(MappedRead &&) = default;
+  MappedRead(MappedRead const &) = delete;
+  MappedRead &operator=(MappedRead const &) = delete;
+
+  FoundMapping mapping;
+  SelectedMapping selected;
+};
 
 /**
  * Map a read to the prg, starting from the precomputed set of search states
@@ -60,12 +208,26 @@ void quasimap_forward_reverse(QuasimapReadsStats &quasimap_stats,
  * first kmer in the read will be seeded this way.
  * @param prg_info object holding all data structures necessary for vBWT,
  * including `gram::FM_Index`.
- * @return
+ * @param read_cache if not null, the read's `ReadMapping` is looked up in it,
+ * and added to it if absent.
+ * @return the selected mapping instance(s), or std::nullopt if the read did
+ * not map.
  */
-void quasimap_read(const Sequence &read, Coverage &coverage,
-                   const KmerIndex &kmer_index, const PRG_Info &prg_info,
-                   const GenotypeParams &parameters, QuasimapReadsStats &stats,
-                   SeedSize const &selection_seed = 42);
+std::optional<MappedRead> quasimap_read(
+    ReadView const &read, Coverage &coverage, const KmerIndex &kmer_index,
+    const PRG_Info &prg_info, const GenotypeParams &parameters,
+    QuasimapReadsStats &stats, SelectionKey const selection_key = 42,
+    ReadMappingCache *const read_cache = nullptr);
+
+/**
+ * Search a read in the prg, without recording any coverage.
+ * A read is `missing_kmer` if its seeding (last) kmer, or any kmer the search
+ * extended through, is not in the index; `no_extension` if the search fails
+ * first.
+ */
+ReadMapping map_read(ReadView const &read, const KmerIndex &kmer_index,
+                     const PRG_Info &prg_info,
+                     const GenotypeParams &parameters);
 
 /**
  * Fetches a kmer of size `kmer_size`, starting from `offset` (0-based)
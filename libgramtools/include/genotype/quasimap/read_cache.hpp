@@ -0,0 +1,81 @@
+/** @file
+ * A cache of read mapping results, so that duplicate reads (PCR/optical
+ * duplicates, amplicons) are only searched in the prg once.
+ */
+
+#ifndef GRAMTOOLS_READ_CACHE_HPP
+#define GRAMTOOLS_READ_CACHE_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "common/data_types.hpp"
+#include "genotype/quasimap/read_view.hpp"
+#include "genotype/quasimap/search/types.hpp"
+
+namespace gram {
+
+enum class ReadMappingOutcome { missing_kmer, no_extension, mapped };
+
+/**
+ * The result of searching a read in the prg, before any mapping instance
+ * selection: that selection is random, so is redone for each read.
+ */
+struct ReadMapping {
+  ReadMappingOutcome outcome;
+  SearchStates search_states;  // Empty unless the read mapped
+};
+using ReadMapping_ptr = std::shared_ptr<ReadMapping const>;
+
+/**
+ * A read's sequence packed at 2 bits per base, preceded by its length.
+ */
+using PackedRead = std::string;
+
+/**
+ * A concurrent cache from reads to their `ReadMapping`. Reads are spread over
+ * shards, each with its own lock. Holds at most `max_num_reads` reads, over
+ * all shards: once it is full, new reads are not cached.
+ */
+class ReadMappingCache {
+ private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<PackedRead, ReadMapping_ptr> mappings;
+  };
+
+  std::vector<Shard> shards;
+  std::size_t const max_num_reads;
+  std::atomic<std::size_t> num_reads{0};
+  std::atomic<uint64_t> num_hits{0};
+
+  /** @return false if the cache is full */
+  bool reserve_read();
+
+  Shard& get_shard(PackedRead const& key);
+
+ public:
+  explicit ReadMappingCache(std::size_t max_num_reads,
+                            std::size_t num_shards = 64);
+
+  /**
+   * @return std::nullopt if the read has a base other than A, C, G or T.
+   */
+  static std::optional<PackedRead> pack(ReadView const& read);
+
+  /**
+   * @return nullptr if the read is not in the cache.
+   */
+  ReadMapping_ptr find(PackedRead const& key);
+  void insert(PackedRead key, ReadMapping_ptr mapping);
+
+  std::size_t size();
+  uint64_t get_num_hits() const { return num_hits; }
+};
+}  // namespace gram
+
+#endif  // GRAMTOOLS_READ_CACHE_HPP
@@ -0,0 +1,215 @@
+/** @file
+ * Reads sequencing reads from FASTQ and FASTA files, plain or gzip/BGZF
+ * compressed, decompressing them off the thread that parses them. Other formats
+ * (SAM/BAM/CRAM) are read through `SeqRead`. Reads are parsed in batches,
+ * encoded straight into contiguous storage.
+ */
+
+#ifndef GRAMTOOLS_READ_INPUT_HPP
+#define GRAMTOOLS_READ_INPUT_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common/data_types.hpp"
+#include "genotype/quasimap/read_view.hpp"
+#include "sequence_read/seqread.hpp"
+
+struct BGZF;
+
+namespace gram {
+
+enum class InputCompression { none, gzip, bgzf };
+
+using InputChunk = std::vector<char>;
+
+/**
+ * A read file's decompressed contents, delivered in chunks:
+ *  - BGZF input is decompressed by htslib's thread pool, several blocks at a
+ *  time and ahead of the reader.
+ *  - Plain gzip input, whose blocks cannot be inflated independently, is
+ *  inflated by a dedicated thread, ahead of the reader.
+ *  - Uncompressed input is read directly.
+ */
+class DecompressedStream {
+ public:
+  static constexpr std::size_t chunk_size{1 << 22};
+  static constexpr std::size_t max_queued_chunks{4};
+
+  /**
+   * @param num_threads the number of threads decompressing BGZF input.
+   * @throws std::runtime_error if the file cannot be opened.
+   */
+  DecompressedStream(std::string const &fpath, int num_threads);
+  ~DecompressedStream();
+  DecompressedStream(DecompressedStream const &) = delete;
+  DecompressedStream &operator=(DecompressedStream const &) = delete;
+
+  /**
+   * Replaces `chunk` by the next chunk of decompressed input; its previous
+   * contents are recycled.
+   * @return false, with `chunk` empty, at the end of the input.
+   * @throws std::runtime_error if the input cannot be decompressed.
+   */
+  bool next_chunk(InputChunk &chunk);
+
+  InputCompression get_compression() const { return compression; }
+
+ private:
+  std::string fpath;
+  BGZF *file;
+  InputCompression compression;
+
+  // Dedicated inflate thread, for gzip input
+  std::thread inflater;
+  std::mutex mutex;
+  std::condition_variable chunk_ready, chunk_taken;
+  std::deque<InputChunk> full_chunks;
+  std::vector<InputChunk> free_chunks;
+  bool inflated_all{false};
+  bool stopping{false};
+  std::exception_ptr inflate_error;
+
+  /** Reads one chunk from the file, in the calling thread */
+  bool read_chunk(InputChunk &chunk);
+  void inflate_ahead();
+};
+
+/**
+ * A batch of reads stored contiguously, so that parsing them allocates nothing
+ * per read: each read's encoded bases, qualities and name are ranges of shared
+ * buffers, delimited by offsets. The buffers are reused by the next batch.
+ * As for `encode_dna_bases`, a read with non-ACGT bases has no encoded bases.
+ */
+class ReadBatch {
+ public:
+  ReadBatch() { clear(); }
+
+  void clear();
+  std::size_t size() const { return lengths.size(); }
+  bool empty() const { return lengths.empty(); }
+
+  ReadView read(std::size_t i) const {
+    return ReadView(bases.data() + base_ends[i],
+                    base_ends[i + 1] - base_ends[i]);
+  }
+  /** The read's length, including any non-ACGT bases */
+  std::size_t length(std::size_t i) const { return lengths[i]; }
+  std::string_view qualities(std::size_t i) const {
+    return std::string_view(all_qualities).substr(
+        quality_ends[i], quality_ends[i + 1] - quality_ends[i]);
+  }
+  std::string_view name(std::size_t i) const {
+    return std::string_view(names).substr(name_ends[i],
+                                          name_ends[i + 1] - name_ends[i]);
+  }
+
+  /**
+   * A read is added by starting it, then appending its bases and qualities,
+   * possibly over several calls, and ending it.
+   */
+  void start_read(std::string_view name);
+  void append_bases(std::string_view read_bases);
+  void append_qualities(std::string_view read_qualities);
+  void end_read();
+  /** Number of bases and qualities appended to the read being added */
+  std::size_t current_length() const { return read_length; }
+  std::size_t current_num_qualities() const {
+    return all_qualities.size() - quality_ends.back();
+  }
+
+  void add(GenomicRead const &read);
+
+ private:
+  Sequence bases;
+  std::string all_qualities;
+  std::string names;
+  std::vector<std::size_t> base_ends, quality_ends, name_ends;
+  std::vector<std::size_t> lengths;
+
+  std::size_t read_length{0};
+  bool read_is_dna{true};
+};
+
+enum class FastxFormat { fastq, fasta };
+
+/**
+ * Parses FASTQ or FASTA records out of a `DecompressedStream` into
+ * `ReadBatch`es. Lines are found with `memchr`, which is vectorised, and are
+ * only copied when they span two chunks. Sequence and quality strings may span
+ * several lines.
+ */
+class FastxParser {
+ public:
+  /**
+   * @param first_chunk the stream's first chunk, already read for detecting
+   * the format.
+   */
+  FastxParser(std::unique_ptr<DecompressedStream> stream,
+              InputChunk first_chunk, FastxFormat format);
+
+  /**
+   * @return the format of `chunk`, the start of a file, or std::nullopt if it
+   * is neither FASTQ nor FASTA.
+   */
+  static std::optional<FastxFormat> detect_format(InputChunk const &chunk);
+
+  /**
+   * Parses up to `max_reads` records into `batch`, after clearing it.
+   * @return false if there were no records left.
+   * @throws std::runtime_error if a record is malformed.
+   */
+  bool next_batch(ReadBatch &batch, std::size_t max_reads);
+
+ private:
+  std::unique_ptr<DecompressedStream> stream;
+  InputChunk chunk;
+  std::size_t position{0};
+  FastxFormat format;
+  std::string_view line; /**< Into `chunk`, or into `split_line` */
+  std::string split_line;
+  bool has_line{false}; /**< `line` was read ahead and not yet parsed */
+
+  /**
+   * Points `line` to the next line, without its line ending. It is valid until
+   * the following call.
+   */
+  bool next_line();
+  bool parse_fastq(ReadBatch &batch);
+  bool parse_fasta(ReadBatch &batch);
+};
+
+/**
+ * Reads the reads of one file, whatever its format.
+ */
+class ReadFileReader {
+ public:
+  /**
+   * @param num_threads the number of threads decompressing BGZF input.
+   */
+  ReadFileReader(std::string const &fpath, int num_threads);
+
+  /**
+   * Reads up to `max_reads` reads into `batch`, after clearing it.
+   * @return false if there were no reads left.
+   */
+  bool next_batch(ReadBatch &batch, std::size_t max_reads);
+
+ private:
+  std::optional<FastxParser> fastx_parser;
+
+  // Formats other than FASTQ and FASTA
+  std::unique_ptr<SeqRead> seq_read;
+  std::optional<SeqRead::SeqIterator> seq_read_it;
+};
+}  // namespace gram
+
+#endif  // GRAMTOOLS_READ_INPUT_HPP
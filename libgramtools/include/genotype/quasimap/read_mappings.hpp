@@ -0,0 +1,103 @@
+/** @file
+ * Per-read mapping output: where each read got mapped in the prg.
+ *
+ * One line per mapped read strand, tab separated:
+ *  - read name
+ *  - strand: '+' for the read as given, '-' for its reverse complement
+ *  - read length
+ *  - the loci of the selected equivalence class, as site:allele, comma
+ * separated
+ *  - the selected `SearchState`s, semicolon separated. Each is: the SA
+ * interval as start-end, its PRG positions (comma separated), its traversed
+ * path and its traversing path (as loci), separated by '|'. Only the first
+ * `max_listed_positions` positions are listed, followed by "..." if there are
+ * more: the others can be located from the SA interval.
+ * A read whose selected mapping does not overlap any variant site has '.' in
+ * the last two columns. Empty lists are written as '.'.
+ */
+
+#ifndef GRAMTOOLS_READ_MAPPINGS_HPP
+#define GRAMTOOLS_READ_MAPPINGS_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include "genotype/quasimap/coverage/coverage_common.hpp"
+
+namespace gram {
+
+/** The most PRG positions listed for one `SearchState` */
+constexpr std::size_t max_listed_positions{8};
+
+/**
+ * Writes read mappings from concurrent mapping threads. Each thread formats
+ * its lines into its own buffer; full buffers are written to disk by a
+ * dedicated writer thread, so mapping threads only wait on I/O when the disk
+ * falls `max_queued_buffers` behind.
+ */
+class ReadMappingWriter {
+ private:
+  struct alignas(64) ThreadBuffer {
+    std::string lines;
+  };
+
+  std::string fpath;
+  std::ofstream out;
+  std::vector<ThreadBuffer> thread_buffers;
+
+  std::mutex mutex;
+  std::condition_variable buffer_available;
+  std::condition_variable buffer_written;
+  std::deque<std::string> full_buffers;
+  std::size_t const max_queued_buffers;
+  bool closed;
+  bool write_failed;
+  std::thread writer;
+
+  void hand_off(std::string& buffer);
+  void write_buffers();
+
+ public:
+  static constexpr std::size_t buffer_size{1 << 20};
+
+  /**
+   * @param num_threads the number of threads that will call `add`, which are
+   * identified by their OpenMP thread number.
+   */
+  ReadMappingWriter(std::string const& fpath, std::size_t num_threads);
+  /** Closes the file, if not already closed; write errors are then ignored */
+  ~ReadMappingWriter();
+  ReadMappingWriter(ReadMappingWriter const&) = delete;
+  ReadMappingWriter& operator=(ReadMappingWriter const&) = delete;
+
+  void add(std::string_view read_name, bool reverse_complement,
+           std::size_t read_length, SelectedMapping const& selection,
+           PRG_Info const& prg_info);
+
+  /**
+   * Hands all threads' buffered lines to the writer thread. Must not be
+   * called concurrently with `add`.
+   */
+  void flush();
+  /**
+   * Writes all buffered lines and stops the writer thread.
+   * @throws std::runtime_error if any lines could not be written, eg on a full
+   * disk.
+   */
+  void close();
+};
+
+/**
+ * Formats one line of read mapping output, without the trailing newline.
+ */
+void format_read_mapping(std::string& out, std::string_view read_name,
+                         bool reverse_complement, std::size_t read_length,
+                         SelectedMapping const& selection,
+                         PRG_Info const& prg_info);
+}  // namespace gram
+
+#endif  // GRAMTOOLS_READ_MAPPINGS_HPP
@@ -0,0 +1,71 @@
+/** @file
+ * A read seen in either orientation, without copying it.
+ */
+
+#ifndef GRAMTOOLS_READ_VIEW_HPP
+#define GRAMTOOLS_READ_VIEW_HPP
+
+#include <algorithm>
+
+#include "common/data_types.hpp"
+#include "common/dna_kernels.hpp"
+
+namespace gram {
+
+/**
+ * Produce integer-encoded Watson-Crick base complement.
+ */
+inline int_Base complement_encoded_base(int_Base const encoded_base) {
+  return (encoded_base >= 1 && encoded_base <= 4) ? 5 - encoded_base : 0;
+}
+
+/**
+ * An integer-encoded read, or its reverse complement. The viewed read must
+ * outlive the view.
+ */
+class ReadView {
+ private:
+  int_Base const *bases;
+  std::size_t length;
+  bool is_reverse_complement;
+
+ public:
+  ReadView(Sequence const &read, bool reverse_complement = false)
+      : ReadView(read.data(), read.size(), reverse_complement) {}
+
+  /** Views `length` bases stored contiguously from `bases` */
+  ReadView(int_Base const *bases, std::size_t length,
+           bool reverse_complement = false)
+      : bases(bases),
+        length(length),
+        is_reverse_complement(reverse_complement) {}
+
+  std::size_t size() const { return length; }
+  bool empty() const { return length == 0; }
+
+  int_Base operator[](std::size_t const pos) const {
+    return is_reverse_complement
+               ? complement_encoded_base(bases[length - 1 - pos])
+               : bases[pos];
+  }
+
+  ReadView reverse_complement() const {
+    return ReadView(bases, length, !is_reverse_complement);
+  }
+
+  /**
+   * Copies `num_bases` bases starting at `pos` into `out`, reusing its memory.
+   */
+  void copy(std::size_t const pos, std::size_t const num_bases,
+            Sequence &out) const {
+    out.resize(num_bases);
+    if (is_reverse_complement)
+      reverse_complement_bases(bases + length - pos - num_bases, num_bases,
+                               out.data());
+    else
+      std::copy(bases + pos, bases + pos + num_bases, out.begin());
+  }
+};
+}  // namespace gram
+
+#endif  // GRAMTOOLS_READ_VIEW_HPP
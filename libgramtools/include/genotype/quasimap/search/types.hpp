@@ -6,6 +6,8 @@
 
 #include <list>
 
+#include <boost/container/small_vector.hpp>
+
 #include "common/data_types.hpp"
 
 namespace gram {
@@ -55,6 +57,13 @@ struct SearchState {
 };
 
 using SearchStates = std::list<SearchState>;
+
+/**
+ * Refers to some of the elements of a `SearchStates`, which must outlive it.
+ * They are usually few, so are held without heap allocation.
+ */
+using SearchStateRefs =
+    boost::container::small_vector<SearchStates::const_iterator, 2>;
 }  // namespace gram
 
 #endif  // GRAMTOOLS_SEARCH_TYPES_HPP
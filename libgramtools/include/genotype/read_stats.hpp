@@ -5,16 +5,51 @@
  * recording that, as well as some other usable metrics, such as max read length
  * and number of sites with no coverage.
  */
+#include <array>
+#include <map>
+#include <string_view>
+
 #include "genotype/quasimap/coverage/types.hpp"
+#include "genotype/quasimap/read_view.hpp"
 #include "prg/types.hpp"
 
 #ifndef GRAMTOOLS_READSTATS_HPP
 #define GRAMTOOLS_READSTATS_HPP
 
-#define NUM_READS_USED 10000
-
 namespace gram {
 
+/**
+ * Read lengths, base qualities and GC content, tallied as the reads are mapped
+ * so that the read files are only read once. Each mapping thread fills its own
+ * `ReadTally`; they are then merged, and `ReadStats` computed from the result.
+ */
+class ReadTally {
+ public:
+  static constexpr std::size_t num_quality_scores{94}; /**< Phred+33: !..~ */
+  static constexpr std::size_t num_gc_bins{101};       /**< 0..100 percent */
+
+  using QualityHistogram = std::array<uint64_t, num_quality_scores>;
+  using LengthHistogram = std::map<std::size_t, uint64_t>;
+  using GcHistogram = std::array<uint64_t, num_gc_bins>;
+
+  /**
+   * @param length the read's length, including any non-ACGT bases
+   * @param read the encoded read; empty if it had non-ACGT bases, in which case
+   * its GC content is not tallied
+   * @param qualities Phred+33 base qualities; empty for FASTA reads
+   */
+  void add_read(std::size_t length, ReadView const& read,
+                std::string_view qualities);
+
+  void merge(ReadTally const& other);
+
+  uint64_t num_reads{0};
+  uint64_t no_qual_reads{0}; /**< Reads with no base qualities */
+  QualityHistogram quality_histogram{};
+  LengthHistogram length_histogram;
+  GcHistogram gc_histogram{}; /**< Reads binned by percent of G and C bases */
+};
+
 class AbstractReadStats {
  public:
   AbstractReadStats()
@@ -67,20 +102,16 @@ class ReadStats : public AbstractReadStats {
         mean_pb_error(-1) {}
 
   /**
-   * From a file
+   * Compute the read statistics, including the probability of erroneous base
+   * from base Phred scores, from reads tallied while mapping them.
    */
-  void compute_base_error_rate(const std::string& reads_fpath);
+  void compute_read_stats(ReadTally const& tally);
 
   /**
    * From random access memory
    */
   void compute_base_error_rate(GenomicRead_vector const& reads);
 
-  /**
-   * Compute probability of erroneous base from base Phred scores.
-   */
-  void process_read_perbase_error_rates(AbstractGenomicReadIterator& reads_it);
-
   using haplogroup_cov = std::pair<AlleleId, CovCount>;
 
   static haplogroup_cov get_max_cov_haplogroup(
@@ -91,17 +122,24 @@ class ReadStats : public AbstractReadStats {
       covG_ptr end_node) override;
 
   void serialise(const std::string& json_output_fpath);
+  /**
+   * Restore the statistics written by `serialise`.
+   * @throws std::runtime_error if the file cannot be read.
+   */
+  void deserialise(const std::string& json_input_fpath);
 
   double const& get_mean_pb_error() const { return mean_pb_error; }
   int64_t const& get_num_bases_processed() const { return num_bases_processed; }
   std::size_t const& get_max_read_len() const { return max_read_length; }
   int64_t const& get_num_no_qual_reads() const { return no_qual_reads; }
+  ReadTally const& get_read_tally() const { return read_tally; }
 
  private:
   double mean_pb_error;  // Pb sequencing error rate
   int64_t no_qual_reads;
   std::size_t max_read_length;
   int64_t num_bases_processed;
+  ReadTally read_tally; /**< Histograms the statistics were computed from */
 };
 
 }  // namespace gram
@@ -20,6 +20,7 @@
 #ifndef COV_GRAPH_HPP
 #define COV_GRAPH_HPP
 
+#include <algorithm>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/make_shared.hpp>
@@ -74,7 +75,7 @@ class coverage_Node {
    * Getters
    */
   std::size_t get_pos() const { return pos; }
-  std::string get_sequence() const { return sequence; }
+  std::string const& get_sequence() const { return sequence; }
   std::size_t get_sequence_size() const { return sequence.size(); }
   int get_coverage_space() const { return coverage.size(); }
   PerBaseCoverage const& get_coverage() const { return coverage; }
@@ -94,6 +95,7 @@ class coverage_Node {
            new_cov.size() == sequence.size());
     coverage = new_cov;
   }
+  void clear_coverage() { std::fill(coverage.begin(), coverage.end(), 0); }
 
   void add_sequence(std::string const& new_seq);
   void add_edge(covG_ptr const target) { next.emplace_back(target); }
@@ -208,6 +210,12 @@ class coverage_Graph {
    */
   target_m target_map;
 
+  /**
+   * Zero the per base coverage of all nodes, eg before mapping another
+   * sample's reads to the same graph.
+   */
+  void clear_coverage();
+
   bool is_nested{false}; /**< Upon construction, gets set to true if graph has
                             nested bubbles */
 
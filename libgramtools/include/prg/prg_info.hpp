@@ -67,6 +67,26 @@ struct PRG_Info {
  */
 PRG_Info load_prg_info(CommonParameters const &parameters);
 
+/**
+ * Advises the kernel to back the large, randomly accessed structures of
+ * backward search with huge pages: the FM index's suffix array samples and
+ * wavelet tree, the BWT masks, and the coverage graph's random access vector.
+ * The bytes collapsed into huge pages (see `advise_huge_pages`) are recorded
+ * in the instrumentation, per structure.
+ * @return the total bytes collapsed.
+ */
+uint64_t back_with_huge_pages(PRG_Info const &prg_info);
+
+/**
+ * Deep copies the structures reads are mapped against, so that the copy's
+ * memory is allocated by (and, by default, local to) the calling thread.
+ * The copy's coverage graph shares its nodes with `prg_info`'s, so per base
+ * coverage recorded through either is recorded once. It has no bubble map:
+ * destroying a graph disconnects its bubbles' nodes, which the copy must not
+ * do while `prg_info` is in use.
+ */
+PRG_Info copy_prg_info_for_mapping(PRG_Info const &prg_info);
+
 }  // namespace gram
 
 #endif  // GRAMTOOLS_PRG_INFO_HPP
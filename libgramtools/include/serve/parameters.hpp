@@ -0,0 +1,24 @@
+/**
+ * @file
+ * Command-line argument processing for `serve` command.
+ */
+
+#ifndef GRAMTOOLS_SERVE_PARAMETERS_HPP
+#define GRAMTOOLS_SERVE_PARAMETERS_HPP
+
+#include "common/parameters.hpp"
+
+namespace gram {
+
+class ServeParams : public CommonParameters {
+ public:
+  std::string socket_fpath;
+};
+
+namespace commands::serve {
+ServeParams parse_parameters(po::variables_map &vm,
+                             const po::parsed_options &parsed);
+}
+}  // namespace gram
+
+#endif  // GRAMTOOLS_SERVE_PARAMETERS_HPP
@@ -0,0 +1,137 @@
+/**
+ * @file
+ * A long-lived genotyping process: the PRG and kmer index are loaded once, and
+ * genotyping jobs are received over a unix domain socket.
+ *
+ * Clients send requests as JSON objects, one per line, and get one JSON line
+ * back per request. A genotyping job request looks like:
+ *   {"sample_id": "s1", "reads": ["/data/s1.fq.gz"], "ploidy": "haploid",
+ *    "output_dir": "/out/s1", "seed": 42}
+ * where "seed" is optional. With "paired": true, "reads" are consecutive
+ * (mate 1, mate 2) files, and "max_insert_size" may be given.
+ * "subsample_fraction" and "max_mean_depth" may also be given, as on the
+ * command line. With "from_coverage": true and no "reads", the sample is
+ * re-genotyped from the coverage saved in "output_dir" by a previous
+ * job. Its response is sent once the job has completed:
+ *   {"status": "ok", "sample_id": "s1", "output_dir": "/out/s1",
+ *    "stats": {"all_reads_count": ..., ...}}
+ * or {"status": "error", "message": ...}. Relative paths are resolved against
+ * the server's working directory. Each job's instrumentation report is written
+ * to its "output_dir".
+ * {"command": "shutdown"} stops the server once all queued jobs have run.
+ */
+
+#ifndef GRAMTOOLS_SERVE_HPP
+#define GRAMTOOLS_SERVE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <thread>
+#include <unordered_set>
+
+#include "genotype/parameters.hpp"
+#include "genotype/quasimap/quasimap.hpp"
+#include "serve/parameters.hpp"
+
+namespace gram::serve {
+using JSON = nlohmann::json;
+
+class ServeRequestException : public std::invalid_argument {
+  using std::invalid_argument::invalid_argument;
+};
+
+/**
+ * Make a job's genotyping parameters from its request, on top of the server's
+ * parameters (gram_dir paths, kmer size, threads). Creates the job's output
+ * directories.
+ * @throws ServeRequestException if the request is missing or has invalid
+ * entries.
+ */
+GenotypeParams make_job_parameters(JSON const& request,
+                                   CommonParameters const& server_parameters);
+
+JSON make_job_response(GenotypeParams const& job_parameters,
+                       QuasimapReadsStats const& stats);
+JSON make_error_response(std::string const& message);
+
+struct GenotypeJob {
+  GenotypeParams parameters;
+  std::promise<JSON> response;
+};
+
+/**
+ * A blocking queue of jobs, filled by the client connections and emptied by
+ * the job runner.
+ */
+class JobQueue {
+ private:
+  std::deque<GenotypeJob> jobs;
+  std::mutex mutex;
+  std::condition_variable job_available;
+  bool closed{false};
+
+ public:
+  /**
+   * @return the future response, or std::nullopt if the queue is closed.
+   */
+  std::optional<std::future<JSON>> push(GenotypeParams job_parameters);
+  /**
+   * Waits for a job. Returns false if the queue is closed and has no jobs left.
+   */
+  bool pop(GenotypeJob& job);
+  /**
+   * Stops accepting jobs. Queued jobs can still be popped.
+   */
+  void close();
+};
+
+/**
+ * Accepts client connections on a unix domain socket, each served on its own
+ * thread: requests are parsed and queued, and responses written back once
+ * their job has run. Only the server's user can connect.
+ */
+class SocketServer {
+ private:
+  std::string socket_fpath;
+  CommonParameters const& server_parameters;
+  JobQueue& queue;
+  int listen_fd;
+  std::thread accept_thread;
+
+  std::mutex clients_mutex;
+  std::condition_variable clients_done;
+  std::unordered_set<int> client_fds;
+  bool stopping{false};
+
+  void accept_clients();
+  void serve_client(int client_fd);
+  JSON handle_request(std::string const& line);
+  void stop_accepting();
+
+ public:
+  /**
+   * @throws std::runtime_error if the socket cannot be listened on, including
+   * if `socket_fpath` exists and is not a socket.
+   */
+  SocketServer(std::string const& socket_fpath,
+               CommonParameters const& server_parameters, JobQueue& queue);
+
+  /**
+   * Stops accepting connections, and waits for connected clients to be sent
+   * their outstanding responses.
+   */
+  ~SocketServer();
+
+  SocketServer(SocketServer const&) = delete;
+  SocketServer& operator=(SocketServer const&) = delete;
+};
+}  // namespace gram::serve
+
+namespace gram::commands::serve {
+void run(ServeParams const& parameters, bool const& debug);
+}
+
+#endif  // GRAMTOOLS_SERVE_HPP
@@ -2,6 +2,7 @@
 #include "build/check_ref.hpp"
 #include "build/parameters.hpp"
 #include "common/file_read.hpp"
+#include "common/instrumentation.hpp"
 
 using namespace gram;
 
@@ -69,4 +70,5 @@ void commands::build::run(BuildParams const &parameters) {
   timer.stop();
 
   timer.report();
+  instrumentation::write_report(parameters.instrumentation_fpath);
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "common/dna_kernels.hpp"
+
+#include <array>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define GRAM_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace gram;
+
+namespace {
+/** As by `encode_dna_base`: 0 for any character but ACGT/acgt */
+constexpr std::array<int_Base, 256> encodings = [] {
+  std::array<int_Base, 256> encodings{};
+  for (int_Base i = 0; i < 4; ++i) {
+    encodings[static_cast<unsigned char>("ACGT"[i])] = i + 1;
+    encodings[static_cast<unsigned char>("acgt"[i])] = i + 1;
+  }
+  return encodings;
+}();
+
+/** Indexed by an encoded base clamped to 5 */
+constexpr char decodings[16] = {'N', 'A', 'C', 'G', 'T', 'N', 'N', 'N',
+                                'N', 'N', 'N', 'N', 'N', 'N', 'N', 'N'};
+constexpr int_Base complements[16] = {0, 4, 3, 2, 1, 0, 0, 0,
+                                      0, 0, 0, 0, 0, 0, 0, 0};
+
+int_Base clamp(int_Base const base) { return base < 5 ? base : 5; }
+
+namespace scalar {
+bool encode(char const *bases, std::size_t num_bases, int_Base *out) {
+  bool is_dna = true;
+  for (std::size_t i = 0; i < num_bases; ++i) {
+    out[i] = encodings[static_cast<unsigned char>(bases[i])];
+    is_dna &= out[i] != 0;
+  }
+  return is_dna;
+}
+
+void decode(int_Base const *bases, std::size_t num_bases, char *out) {
+  for (std::size_t i = 0; i < num_bases; ++i)
+    out[i] = decodings[clamp(bases[i])];
+}
+
+void reverse_complement(int_Base const *bases, std::size_t num_bases,
+                        int_Base *out) {
+  for (std::size_t i = 0; i < num_bases; ++i)
+    out[i] = complements[clamp(bases[num_bases - 1 - i])];
+}
+
+DnaKernels const kernels{encode, decode, reverse_complement};
+}  // namespace scalar
+
+#ifdef GRAM_X86_KERNELS
+/*
+ * Bases are encoded by comparing their lower case, obtained by setting bit 5,
+ * with each of "acgt": only 'A' and 'a' become 'a', and so on. Lookups into the
+ * 16-entry tables are byte shuffles, of bases clamped to 5.
+ */
+namespace sse4 {
+__attribute__((target("sse4.1"))) bool encode(char const *bases,
+                                              std::size_t num_bases,
+                                              int_Base *out) {
+  std::size_t i = 0;
+  __m128i non_dna = _mm_setzero_si128();
+  for (; i + 16 <= num_bases; i += 16) {
+    auto const block = _mm_or_si128(
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(bases + i)),
+        _mm_set1_epi8(0x20));
+    auto encoded = _mm_setzero_si128();
+    int_Base encoding = 1;
+    for (char const base : {'a', 'c', 'g', 't'})
+      encoded = _mm_or_si128(
+          encoded, _mm_and_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(base)),
+                                 _mm_set1_epi8(encoding++)));
+    non_dna = _mm_or_si128(non_dna,
+                           _mm_cmpeq_epi8(encoded, _mm_setzero_si128()));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), encoded);
+  }
+  bool const is_dna = _mm_testz_si128(non_dna, non_dna);
+  return scalar::encode(bases + i, num_bases - i, out + i) && is_dna;
+}
+
+__attribute__((target("sse4.1"))) void decode(int_Base const *bases,
+                                              std::size_t num_bases,
+                                              char *out) {
+  auto const table =
+      _mm_loadu_si128(reinterpret_cast<__m128i const *>(decodings));
+  std::size_t i = 0;
+  for (; i + 16 <= num_bases; i += 16) {
+    auto const block = _mm_min_epu8(
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(bases + i)),
+        _mm_set1_epi8(5));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                     _mm_shuffle_epi8(table, block));
+  }
+  scalar::decode(bases + i, num_bases - i, out + i);
+}
+
+__attribute__((target("sse4.1"))) void reverse_complement(
+    int_Base const *bases, std::size_t num_bases, int_Base *out) {
+  auto const table =
+      _mm_loadu_si128(reinterpret_cast<__m128i const *>(complements));
+  auto const reversal =
+      _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+  std::size_t i = 0;
+  for (; i + 16 <= num_bases; i += 16) {
+    auto const block = _mm_min_epu8(
+        _mm_loadu_si128(
+            reinterpret_cast<__m128i const *>(bases + num_bases - i - 16)),
+        _mm_set1_epi8(5));
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(out + i),
+        _mm_shuffle_epi8(table, _mm_shuffle_epi8(block, reversal)));
+  }
+  scalar::reverse_complement(bases, num_bases - i, out + i);
+}
+
+DnaKernels const kernels{encode, decode, reverse_complement};
+}  // namespace sse4
+
+namespace avx2 {
+__attribute__((target("avx2"))) bool encode(char const *bases,
+                                            std::size_t num_bases,
+                                            int_Base *out) {
+  std::size_t i = 0;
+  __m256i non_dna = _mm256_setzero_si256();
+  for (; i + 32 <= num_bases; i += 32) {
+    auto const block = _mm256_or_si256(
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(bases + i)),
+        _mm256_set1_epi8(0x20));
+    auto encoded = _mm256_setzero_si256();
+    int_Base encoding = 1;
+    for (char const base : {'a', 'c', 'g', 't'})
+      encoded = _mm256_or_si256(
+          encoded,
+          _mm256_and_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(base)),
+                           _mm256_set1_epi8(encoding++)));
+    non_dna = _mm256_or_si256(
+        non_dna, _mm256_cmpeq_epi8(encoded, _mm256_setzero_si256()));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), encoded);
+  }
+  bool const is_dna = _mm256_testz_si256(non_dna, non_dna);
+  return sse4::encode(bases + i, num_bases - i, out + i) && is_dna;
+}
+
+__attribute__((target("avx2"))) void decode(int_Base const *bases,
+                                            std::size_t num_bases, char *out) {
+  auto const table = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<__m128i const *>(decodings)));
+  std::size_t i = 0;
+  for (; i + 32 <= num_bases; i += 32) {
+    auto const block = _mm256_min_epu8(
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(bases + i)),
+        _mm256_set1_epi8(5));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                        _mm256_shuffle_epi8(table, block));
+  }
+  sse4::decode(bases + i, num_bases - i, out + i);
+}
+
+__attribute__((target("avx2"))) void reverse_complement(
+    int_Base const *bases, std::size_t num_bases, int_Base *out) {
+  auto const table = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<__m128i const *>(complements)));
+  // Byte shuffles stay within 128-bit lanes: the lanes are swapped after
+  auto const reversal = _mm256_setr_epi8(
+      15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11,
+      10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+  std::size_t i = 0;
+  for (; i + 32 <= num_bases; i += 32) {
+    auto const block = _mm256_min_epu8(
+        _mm256_loadu_si256(
+            reinterpret_cast<__m256i const *>(bases + num_bases - i - 32)),
+        _mm256_set1_epi8(5));
+    auto const reversed =
+        _mm256_permute4x64_epi64(_mm256_shuffle_epi8(block, reversal), 0x4E);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                        _mm256_shuffle_epi8(table, reversed));
+  }
+  sse4::reverse_complement(bases, num_bases - i, out + i);
+}
+
+DnaKernels const kernels{encode, decode, reverse_complement};
+}  // namespace avx2
+#endif
+}  // namespace
+
+SimdLevel gram::best_simd_level() {
+#ifdef GRAM_X86_KERNELS
+  if (__builtin_cpu_supports("avx2")) return SimdLevel::avx2;
+  if (__builtin_cpu_supports("sse4.1")) return SimdLevel::sse4;
+#endif
+  return SimdLevel::scalar;
+}
+
+DnaKernels const &gram::get_dna_kernels(SimdLevel const level) {
+  if (static_cast<int>(level) > static_cast<int>(best_simd_level()))
+    throw std::invalid_argument("SIMD level not supported by this CPU");
+  switch (level) {
+#ifdef GRAM_X86_KERNELS
+    case SimdLevel::avx2:
+      return avx2::kernels;
+    case SimdLevel::sse4:
+      return sse4::kernels;
+#endif
+    default:
+      return scalar::kernels;
+  }
+}
@@ -0,0 +1,41 @@
+#include "common/huge_pages.hpp"
+
+#ifdef __linux__
+#include <sys/mman.h>
+
+#include <cerrno>
+#endif
+
+using namespace gram;
+
+#if defined(__linux__) && !defined(MADV_COLLAPSE)
+#define MADV_COLLAPSE 25  // Linux 6.1; older kernels reject it with EINVAL
+#endif
+
+uint64_t gram::advise_huge_pages(void const *data, std::size_t num_bytes) {
+#ifdef __linux__
+  uintptr_t const alignment_mask = ~(uintptr_t{huge_page_size} - 1);
+  auto const start = reinterpret_cast<uintptr_t>(data);
+  auto const aligned_start = (start + huge_page_size - 1) & alignment_mask;
+  auto const aligned_end = (start + num_bytes) & alignment_mask;
+  if (aligned_end <= aligned_start) return 0;
+
+  auto *const range = reinterpret_cast<void *>(aligned_start);
+  auto const range_size = aligned_end - aligned_start;
+  if (madvise(range, range_size, MADV_HUGEPAGE) != 0) return 0;
+  // Without collapsing, the range is only backed by huge pages once the
+  // kernel's background daemon gets to it. Huge pages are collapsed one at a
+  // time, so that those the kernel fails to collapse are not counted.
+  uint64_t num_collapsed_bytes = 0;
+  for (auto page = aligned_start; page < aligned_end; page += huge_page_size) {
+    if (madvise(reinterpret_cast<void *>(page), huge_page_size,
+                MADV_COLLAPSE) == 0)
+      num_collapsed_bytes += huge_page_size;
+    else if (errno == EINVAL)
+      break;  // Collapsing is not supported
+  }
+  return num_collapsed_bytes;
+#else
+  return 0;
+#endif
+}
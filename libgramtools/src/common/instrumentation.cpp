@@ -0,0 +1,203 @@
+#include "common/instrumentation.hpp"
+
+#include <sys/resource.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace gram;
+using namespace gram::instrumentation;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct alignas(64) ThreadCounters {
+  // Only written by the owning thread; atomic so that reports can be made
+  // while other threads are counting
+  std::array<std::atomic<uint64_t>, num_counters> counts{};
+};
+
+struct SpanRecord {
+  std::string name;
+  Clock::time_point wall_start;
+  double cpu_start;
+  double wall_seconds{0};
+  double cpu_seconds{0};
+  uint64_t peak_rss_bytes{0};
+  std::vector<SpanRecord> children;
+};
+
+/**
+ * Counters of all threads that ever counted, and spans completed with no open
+ * parent span.
+ */
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadCounters>> thread_counters;
+  std::vector<SpanRecord> completed_spans;
+  std::map<std::string, uint64_t> huge_page_bytes;
+};
+
+Registry& registry() {
+  static Registry instance;
+  return instance;
+}
+
+ThreadCounters& thread_counters() {
+  thread_local ThreadCounters* counters = [] {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.thread_counters.push_back(std::make_unique<ThreadCounters>());
+    return reg.thread_counters.back().get();
+  }();
+  return *counters;
+}
+
+thread_local std::vector<SpanRecord> open_spans;
+
+double process_cpu_seconds() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  auto const seconds = [](timeval const& time) {
+    return time.tv_sec + time.tv_usec * 1e-6;
+  };
+  return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+nlohmann::json span_json(SpanRecord const& span) {
+  nlohmann::json result{{"name", span.name},
+                        {"wall_seconds", span.wall_seconds},
+                        {"cpu_seconds", span.cpu_seconds},
+                        {"peak_rss_bytes", span.peak_rss_bytes}};
+  if (!span.children.empty()) {
+    result["children"] = nlohmann::json::array();
+    for (auto const& child : span.children)
+      result["children"].push_back(span_json(child));
+  }
+  return result;
+}
+}  // namespace
+
+std::string instrumentation::counter_name(Counter counter) {
+  switch (counter) {
+    case Counter::reads_seeded:
+      return "reads_seeded";
+    case Counter::bases_extended:
+      return "bases_extended";
+    case Counter::vbwt_jumps:
+      return "vbwt_jumps";
+    case Counter::sa_positions_located:
+      return "sa_positions_located";
+    case Counter::coverage_records:
+      return "coverage_records";
+  }
+  return "unknown";
+}
+
+void instrumentation::count(Counter counter, uint64_t amount) {
+  auto& value = thread_counters().counts[static_cast<std::size_t>(counter)];
+  value.store(value.load(std::memory_order_relaxed) + amount,
+              std::memory_order_relaxed);
+}
+
+void instrumentation::record_huge_pages(std::string const& structure,
+                                        uint64_t num_bytes) {
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.huge_page_bytes[structure] += num_bytes;
+}
+
+uint64_t instrumentation::peak_rss_bytes() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // Linux: kilobytes
+}
+
+void instrumentation::begin_span(std::string name) {
+  SpanRecord span;
+  span.name = std::move(name);
+  span.wall_start = Clock::now();
+  span.cpu_start = process_cpu_seconds();
+  open_spans.push_back(std::move(span));
+}
+
+void instrumentation::end_span() {
+  if (open_spans.empty()) {
+    std::cerr << "Instrumentation span ended with none open" << std::endl;
+    return;
+  }
+  auto span = std::move(open_spans.back());
+  open_spans.pop_back();
+  span.wall_seconds =
+      std::chrono::duration<double>(Clock::now() - span.wall_start).count();
+  span.cpu_seconds = process_cpu_seconds() - span.cpu_start;
+  span.peak_rss_bytes = peak_rss_bytes();
+
+  if (!open_spans.empty()) {
+    open_spans.back().children.push_back(std::move(span));
+    return;
+  }
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.completed_spans.push_back(std::move(span));
+}
+
+nlohmann::json instrumentation::report() {
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+
+  nlohmann::json spans = nlohmann::json::array();
+  for (auto const& span : reg.completed_spans) spans.push_back(span_json(span));
+
+  std::array<uint64_t, num_counters> totals{};
+  nlohmann::json per_thread = nlohmann::json::array();
+  for (auto const& counters : reg.thread_counters) {
+    nlohmann::json thread_counts;
+    for (std::size_t i = 0; i < num_counters; ++i) {
+      auto const value = counters->counts[i].load(std::memory_order_relaxed);
+      thread_counts[counter_name(static_cast<Counter>(i))] = value;
+      totals[i] += value;
+    }
+    per_thread.push_back(thread_counts);
+  }
+  nlohmann::json counters;
+  for (std::size_t i = 0; i < num_counters; ++i)
+    counters[counter_name(static_cast<Counter>(i))] = totals[i];
+
+  nlohmann::json huge_page_bytes = nlohmann::json::object();
+  for (auto const& [structure, num_bytes] : reg.huge_page_bytes)
+    huge_page_bytes[structure] = num_bytes;
+
+  return nlohmann::json{{"spans", spans},
+                        {"counters", counters},
+                        {"per_thread_counters", per_thread},
+                        {"huge_page_bytes", huge_page_bytes},
+                        {"peak_rss_bytes", peak_rss_bytes()}};
+}
+
+void instrumentation::write_report(std::string const& fpath) {
+  std::ofstream out(fpath);
+  if (!out.is_open()) {
+    std::cerr << "Could not write instrumentation report to " << fpath
+              << std::endl;
+    return;
+  }
+  out << report().dump(2) << std::endl;
+}
+
+void instrumentation::reset() {
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.completed_spans.clear();
+  // Threads keep pointers to their counters, which are so zeroed, not freed
+  for (auto const& counters : reg.thread_counters)
+    for (auto& value : counters->counts)
+      value.store(0, std::memory_order_relaxed);
+}
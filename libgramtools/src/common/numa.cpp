@@ -0,0 +1,215 @@
+#include "common/numa.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace gram;
+namespace fs = std::filesystem;
+
+NumaPolicy gram::parse_numa_policy(std::string const &policy) {
+  if (policy == "none") return NumaPolicy::none;
+  if (policy == "interleave") return NumaPolicy::interleave;
+  if (policy == "replicate") return NumaPolicy::replicate;
+  throw std::invalid_argument("Invalid NUMA policy: " + policy +
+                              " (expected none, interleave or replicate)");
+}
+
+namespace {
+/** @throws std::invalid_argument unless all of `number` is a CPU number */
+int parse_cpu(std::string const &number) {
+  std::size_t end = 0;
+  auto const cpu = std::stoi(number, &end);
+  if (end != number.size() || cpu < 0) throw std::invalid_argument(number);
+  return cpu;
+}
+}  // namespace
+
+std::vector<int> gram::parse_cpu_list(std::string const &cpu_list) {
+  std::vector<int> cpus;
+  std::istringstream ranges(cpu_list);
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    range.erase(std::remove_if(range.begin(), range.end(), ::isspace),
+                range.end());
+    if (range.empty()) continue;
+    auto const dash = range.find('-');
+    try {
+      auto const first = parse_cpu(range.substr(0, dash));
+      auto const last = dash == std::string::npos
+                            ? first
+                            : parse_cpu(range.substr(dash + 1));
+      if (last < first) throw std::invalid_argument(range);
+      for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    } catch (std::logic_error const &) {  // Also thrown by std::stoi
+      throw std::invalid_argument("Malformed CPU list: " + cpu_list);
+    }
+  }
+  return cpus;
+}
+
+NumaNodes gram::read_numa_nodes(std::string const &node_dirpath) {
+  NumaNodes nodes;
+  std::error_code error;
+  for (auto const &entry : fs::directory_iterator(node_dirpath, error)) {
+    auto const name = entry.path().filename().string();
+    if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+        !std::all_of(name.begin() + 4, name.end(), ::isdigit))
+      continue;
+    std::ifstream cpulist_fhandle(entry.path() / "cpulist");
+    std::string cpu_list;
+    std::getline(cpulist_fhandle, cpu_list);
+    auto cpus = parse_cpu_list(cpu_list);
+    if (!cpus.empty()) nodes.push_back({std::stoi(name.substr(4)), cpus});
+  }
+  std::sort(nodes.begin(), nodes.end(),
+            [](auto const &a, auto const &b) { return a.id < b.id; });
+  return nodes;
+}
+
+namespace {
+std::vector<int> current_thread_cpus() {
+  std::vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      if (CPU_ISSET(cpu, &cpu_set)) cpus.push_back(cpu);
+#endif
+  return cpus;
+}
+
+void set_current_thread_cpus(std::vector<int> const &cpus) {
+#ifdef __linux__
+  if (cpus.empty()) return;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (auto const cpu : cpus)
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpu_set);
+  // Best effort: an affinity the OS refuses leaves the thread unpinned
+  sched_setaffinity(0, sizeof(cpu_set), &cpu_set);
+#endif
+}
+
+struct Topology {
+  NumaNodes nodes;
+  std::vector<std::size_t> cpu_to_node_index;
+};
+
+Topology const &topology() {
+  static Topology const topology = [] {
+    Topology topology;
+    auto const allowed_cpus = current_thread_cpus();
+    auto is_allowed = [&allowed_cpus](int const cpu) {
+      return std::binary_search(allowed_cpus.begin(), allowed_cpus.end(), cpu);
+    };
+    for (auto node : read_numa_nodes("/sys/devices/system/node")) {
+      auto &cpus = node.cpus;
+      cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+                                [&](int cpu) { return !is_allowed(cpu); }),
+                 cpus.end());
+      if (!cpus.empty()) topology.nodes.push_back(node);
+    }
+    if (topology.nodes.empty()) topology.nodes.push_back({0, allowed_cpus});
+
+    for (std::size_t i = 0; i < topology.nodes.size(); ++i)
+      for (auto const cpu : topology.nodes[i].cpus) {
+        if (topology.cpu_to_node_index.size() <= std::size_t(cpu))
+          topology.cpu_to_node_index.resize(cpu + 1, 0);
+        topology.cpu_to_node_index[cpu] = i;
+      }
+    return topology;
+  }();
+  return topology;
+}
+}  // namespace
+
+NumaNodes const &gram::numa_nodes() { return topology().nodes; }
+
+std::size_t gram::current_numa_node_index() {
+  auto const &cpu_to_node_index = topology().cpu_to_node_index;
+#ifdef __linux__
+  auto const cpu = sched_getcpu();
+  if (cpu >= 0 && std::size_t(cpu) < cpu_to_node_index.size())
+    return cpu_to_node_index[cpu];
+#endif
+  return 0;
+}
+
+void gram::pin_current_thread(NumaNode const &node) {
+  set_current_thread_cpus(node.cpus);
+}
+
+ScopedInterleave::ScopedInterleave(bool const enabled) {
+#ifdef __linux__
+  auto const &nodes = numa_nodes();
+  if (!enabled || nodes.size() <= 1) return;
+  constexpr std::size_t bits_per_word = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> node_mask(nodes.back().id / bits_per_word + 1);
+  for (auto const &node : nodes)
+    node_mask[node.id / bits_per_word] |= 1UL << (node.id % bits_per_word);
+  // The kernel reads one bit less than the given maximum node
+  interleaving =
+      syscall(SYS_set_mempolicy, MPOL_INTERLEAVE, node_mask.data(),
+              node_mask.size() * bits_per_word + 1) == 0;
+#endif
+}
+
+ScopedInterleave::~ScopedInterleave() {
+#ifdef __linux__
+  if (interleaving) syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+#endif
+}
+
+ScopedUnpinned::ScopedUnpinned() {
+  auto const &nodes = numa_nodes();
+  if (nodes.size() <= 1) return;
+  previous_cpus = current_thread_cpus();
+  std::vector<int> all_cpus;
+  for (auto const &node : nodes)
+    all_cpus.insert(all_cpus.end(), node.cpus.begin(), node.cpus.end());
+  set_current_thread_cpus(all_cpus);
+}
+
+ScopedUnpinned::~ScopedUnpinned() { set_current_thread_cpus(previous_cpus); }
+
+std::size_t PinnedThreads::node_index(std::size_t const thread_num,
+                                      std::size_t const num_threads,
+                                      std::size_t const num_nodes) {
+  return thread_num * num_nodes / num_threads;
+}
+
+PinnedThreads::PinnedThreads() {
+  auto const &nodes = numa_nodes();
+  if (nodes.size() <= 1) return;
+  previous_cpus.resize(omp_get_max_threads());
+#pragma omp parallel
+  {
+    std::size_t const thread_num = omp_get_thread_num();
+    previous_cpus[thread_num] = current_thread_cpus();
+    pin_current_thread(
+        nodes[node_index(thread_num, omp_get_num_threads(), nodes.size())]);
+  }
+}
+
+PinnedThreads::~PinnedThreads() {
+  if (previous_cpus.empty()) return;
+#pragma omp parallel
+  {
+    std::size_t const thread_num = omp_get_thread_num();
+    if (thread_num < previous_cpus.size())
+      set_current_thread_cpus(previous_cpus[thread_num]);
+  }
+}
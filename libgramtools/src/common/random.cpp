@@ -17,4 +17,50 @@ uint32_t RandomInclusiveInt::generate(uint32_t min, uint32_t max) {
   std::uniform_int_distribution<uint32_t> range(min, max);
   return range(random_number_generator);
 }
+
+namespace {
+constexpr uint64_t golden_gamma{0x9e3779b97f4a7c15};
+
+uint64_t mix(uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+}  // namespace
+
+uint64_t CounterRandomInt::next() {
+  state += golden_gamma;
+  return mix(state);
+}
+
+/**
+ * Unbiased, with (almost always) no division: Lemire's multiply and reject.
+ */
+uint32_t CounterRandomInt::generate(uint32_t min, uint32_t max) {
+  uint64_t const range = static_cast<uint64_t>(max) - min + 1;
+  uint64_t product = (next() >> 32) * range;
+  if ((product & 0xffffffff) < range) {
+    uint64_t const threshold = ((uint64_t{1} << 32) - range) % range;
+    while ((product & 0xffffffff) < threshold)
+      product = (next() >> 32) * range;
+  }
+  return min + static_cast<uint32_t>(product >> 32);
+}
+
+SelectionKey read_selection_key(SeedSize const master_seed,
+                                uint64_t const read_index,
+                                bool const reverse_complement) {
+  return mix(mix(master_seed + golden_gamma) + 2 * read_index +
+             reverse_complement);
+}
+
+bool read_is_subsampled(SeedSize const master_seed, uint64_t const read_index,
+                        double const fraction) {
+  if (fraction >= 1) return true;
+  // A different stream from the selection keys': keyed by the mixed seed
+  uint64_t const hash =
+      mix(mix(mix(master_seed) + golden_gamma) + read_index * golden_gamma);
+  // Uniform in [0, 1), from the top 53 bits
+  return (hash >> 11) * 0x1.0p-53 < fraction;
+}
 }  // namespace gram
@@ -5,10 +5,13 @@
 
 #include "common/timer_report.hpp"
 
+#include "common/instrumentation.hpp"
+
 using namespace gram;
 
 void gram::TimerReport::start(std::string note) {
   this->note = note;
+  instrumentation::begin_span(note);
   timer.start();
 }
 
@@ -17,32 +20,39 @@ void TimerReport::stop() {
     std::cerr << "TimerReport stop called with empty note" << std::endl;
   boost::timer::cpu_times times = timer.elapsed();
   double elapsed_time = (times.user + times.system) * 1e-9;
-  Entry entry = std::make_pair(note, elapsed_time);
+  double wall_time = times.wall * 1e-9;
+  Entry entry = std::make_tuple(note, elapsed_time, wall_time);
   logger.push_back(entry);
+  instrumentation::end_span();
   this->note = "";
 }
 
 void TimerReport::report() const {
   std::cout << "\nTimer report:" << std::endl;
-  cout_row(" ", "seconds");
+  cout_row(" ", "CPU s", "wall s");
 
   double total_elapsed_time = 0;
+  double total_wall_time = 0;
 
   for (const auto &entry : TimerReport::logger) {
     Note note;
-    double elapsed_time;
-    std::tie(note, elapsed_time) = entry;
+    double elapsed_time, wall_time;
+    std::tie(note, elapsed_time, wall_time) = entry;
 
-    cout_row(note, elapsed_time);
+    cout_row(note, elapsed_time, wall_time);
     total_elapsed_time += elapsed_time;
+    total_wall_time += wall_time;
   }
 
   std::cout << std::endl
-            << "Total elapsed time: " << total_elapsed_time << std::endl;
+            << "Total elapsed time: " << total_elapsed_time << std::endl
+            << "Total wall clock time: " << total_wall_time << std::endl;
 }
 
-template <typename TypeCol1, typename TypeCol2>
-void TimerReport::cout_row(TypeCol1 col1, TypeCol2 col2) const {
+template <typename TypeCol1, typename TypeCol2, typename TypeCol3>
+void TimerReport::cout_row(TypeCol1 col1, TypeCol2 col2,
+                           TypeCol3 col3) const {
   std::cout << std::setw(20) << std::right << col1 << std::setw(10)
-            << std::right << col2 << std::endl;
+            << std::right << col2 << std::setw(10) << std::right << col3
+            << std::endl;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <string>
 
+#include "common/dna_kernels.hpp"
 #include "common/utils.hpp"
 #include "sequence_read/seqread.hpp"
 
@@ -71,22 +72,18 @@ std::string gram::decode_dna_base(const int_Base &base) {
 }
 
 Sequence gram::encode_dna_bases(const std::string &dna_str) {
-  Sequence pattern;
-  for (const auto &base_str : dna_str) {
-    int_Base encoded_base = encode_dna_base(base_str);
-    if (encoded_base == 0) return Sequence{};
-    pattern.emplace_back(encoded_base);
-  }
+  Sequence pattern(dna_str.size());
+  if (!encode_bases(dna_str.data(), dna_str.size(), pattern.data()))
+    return Sequence{};
   return pattern;
 }
 
 Sequence gram::encode_dna_bases(const GenomicRead &read_sequence) {
-  const auto sequence_length = read_sequence.seq.size();
-  Sequence pattern;
-  for (uint64_t i = 0; i < sequence_length; i++) {
-    int_Base encoded_base = encode_dna_base(read_sequence.seq[i]);
-    if (encoded_base == 0) return Sequence{};
-    pattern.emplace_back(encoded_base);
-  }
-  return pattern;
+  return encode_dna_bases(read_sequence.seq);
+}
+
+std::string gram::decode_dna_bases(const Sequence &bases) {
+  std::string dna_str(bases.size(), 'N');
+  decode_bases(bases.data(), bases.size(), dna_str.data());
+  return dna_str;
 }
@@ -1,49 +1,80 @@
 #include "genotype/genotype.hpp"
 
 #include "build/kmer_index/load.hpp"
-#include "common/timer_report.hpp"
+#include "common/instrumentation.hpp"
+#include "common/numa.hpp"
 #include "genotype/infer/level_genotyping/runner.hpp"
 #include "genotype/infer/output_specs/make_json.hpp"
 #include "genotype/infer/output_specs/make_vcf.hpp"
 #include "genotype/infer/output_specs/segment_tracker.hpp"
 #include "genotype/infer/personalised_reference.hpp"
-#include "genotype/quasimap/quasimap.hpp"
+#include "genotype/quasimap/coverage/snapshot.hpp"
 
 using namespace gram;
 using namespace gram::genotype;
 
 namespace gram::genotype {
-void write_deduped_p_refs(Fastas const& p_refs, std::string const& fpath) {
-  unique_Fastas deduped_p_refs{p_refs.begin(), p_refs.end()};
-  std::ofstream pers_ref_fhandle(fpath);
-  for (auto& p_ref : deduped_p_refs) pers_ref_fhandle << p_ref << std::endl;
-  pers_ref_fhandle.close();
+void write_genotyping_outputs(GenotypeParams const& parameters,
+                              gtyper_ptr const& gtyper, covG_ptr graph_root,
+                              SegmentTracker const& tracker) {
+  // The outputs only read the genotyped sites, so are produced concurrently,
+  // as OpenMP tasks: the personalised reference spawns its own tasks, which
+  // idle threads pick up. Each output gets its own tracker, as trackers hold
+  // a position cursor.
+  std::exception_ptr errors[3];
+#pragma omp parallel
+#pragma omp single
+  {
+#pragma omp task
+    {
+      try {
+        SegmentTracker json_tracker{tracker};
+        json_tracker.reset();
+        std::ofstream geno_json_fhandle(parameters.genotyped_json_fpath);
+        write_json_prg(geno_json_fhandle, gtyper, json_tracker,
+                       parameters.sample_id, "made by gramtools genotype");
+      } catch (...) {
+        errors[0] = std::current_exception();
+      }
+    }
+#pragma omp task
+    {
+      try {
+        SegmentTracker vcf_tracker{tracker};
+        vcf_tracker.reset();
+        write_vcf(parameters, gtyper, vcf_tracker);
+      } catch (...) {
+        errors[1] = std::current_exception();
+      }
+    }
+    try {
+      SegmentTracker p_ref_tracker{tracker};
+      p_ref_tracker.reset();
+      auto p_refs = get_personalised_ref(
+          graph_root, gtyper->get_genotyped_records(), p_ref_tracker);
+      std::string desc = parameters.sample_id +
+                         " personalised reference made by gramtools genotype";
+      add_description(p_refs, desc);
+      write_deduped_p_refs(p_refs, parameters.personalised_ref_fpath);
+    } catch (...) {
+      errors[2] = std::current_exception();
+    }
+  }
+  for (auto const& error : errors)
+    if (error) std::rethrow_exception(error);
 }
 }  // namespace gram::genotype
 
-void gram::commands::genotype::run(GenotypeParams const& parameters,
-                                   bool const& debug) {
-  auto timer = TimerReport();
-  /**
-   * Quasimap
-   */
-  std::cout << "Executing genotype command" << std::endl;
-
-  ReadStats readstats;
-  std::string first_reads_fpath = parameters.reads_fpaths[0];
-  readstats.compute_base_error_rate(first_reads_fpath);
-
-  timer.start("Load data");
-  std::cout << "Loading PRG data" << std::endl;
-  const auto prg_info = load_prg_info(parameters);
-  std::cout << "Loading kmer index data" << std::endl;
-  const auto kmer_index = kmer_index::load(parameters);
-  timer.stop();
-
+namespace gram::genotype {
+/**
+ * Map the sample's reads, recording their coverage, and compute read stats.
+ */
+QuasimapReadsStats map_sample(GenotypeParams const& parameters,
+                              IndexReplicas const& indices,
+                              ReadStats& readstats, TimerReport& timer) {
   std::cout << "Running quasimap" << std::endl;
   timer.start("Quasimap");
-  auto quasimap_stats =
-      quasimap_reads(parameters, kmer_index, prg_info, readstats);
+  auto quasimap_stats = quasimap_reads(parameters, indices, readstats);
 
   // Commit the read stats into quasimap output dir.
   std::cout << "Writing read stats to " << parameters.read_stats_fpath
@@ -64,7 +95,48 @@ void gram::commands::genotype::run(GenotypeParams const& parameters,
             << quasimap_stats.no_extension_reads_count << std::endl;
   std::cout << "Count exact mapped reads: "
             << quasimap_stats.exact_mapped_reads_count << std::endl;
+  if (parameters.paired)
+    std::cout << "Count mates dropped as their pair did not map concordantly: "
+              << quasimap_stats.unpaired_reads_count << std::endl
+              << "Count mates mapped unpaired as too repetitive to pair: "
+              << quasimap_stats.unpaired_repetitive_reads_count << std::endl;
+  if (parameters.subsample_fraction < 1)
+    std::cout << "Count reads not mapped as not subsampled: "
+              << quasimap_stats.subsampled_out_reads_count << std::endl;
+  timer.stop();
+  return quasimap_stats;
+}
+
+/**
+ * Load the coverage and read stats saved by a previous run of the sample,
+ * restoring per base coverage onto the coverage graph.
+ */
+QuasimapReadsStats load_sample(GenotypeParams const& parameters,
+                               PRG_Info const& prg_info, ReadStats& readstats,
+                               TimerReport& timer) {
+  timer.start("Load coverage");
+  std::cout << "Loading coverage from " << parameters.coverage_snapshot_fpath
+            << std::endl;
+  QuasimapReadsStats quasimap_stats{};
+  quasimap_stats.coverage = coverage::load::snapshot(prg_info, parameters);
+  if (parameters.coverage_json)
+    coverage::dump::all(quasimap_stats.coverage, parameters);
+  std::cout << "Loading read stats from " << parameters.read_stats_fpath
+            << std::endl;
+  readstats.deserialise(parameters.read_stats_fpath);
   timer.stop();
+  return quasimap_stats;
+}
+
+QuasimapReadsStats genotype_sample(GenotypeParams const& parameters,
+                                   IndexReplicas const& indices,
+                                   bool const& debug, TimerReport& timer) {
+  auto const& prg_info = indices.prg_info();
+  ReadStats readstats;
+  auto const quasimap_stats =
+      parameters.from_coverage
+          ? load_sample(parameters, prg_info, readstats, timer)
+          : map_sample(parameters, indices, readstats, timer);
 
   /**
    * Infer
@@ -82,41 +154,78 @@ void gram::commands::genotype::run(GenotypeParams const& parameters,
   }
 
   std::cout << "Running genotyping model" << std::endl;
-  LevelGenotyper genotyper{prg_info.coverage_graph,
-                           quasimap_stats.coverage.grouped_allele_counts,
-                           readstats,
-                           parameters.ploidy,
-                           true,
-                           debug_file};
+  instrumentation::begin_span("Genotyping model");
+  gtyper_ptr gtyper = std::make_shared<LevelGenotyper>(
+      prg_info.coverage_graph, quasimap_stats.coverage.grouped_allele_counts,
+      readstats, parameters.ploidy, true, debug_file);
+  instrumentation::end_span();
 
   std::ifstream coords_file(parameters.prg_coords_fpath);
   SegmentTracker tracker(coords_file);
   coords_file.close();
 
-  std::cout << "Producing json vcf" << std::endl;
-  std::ofstream geno_json_fhandle(parameters.genotyped_json_fpath);
-  auto gtyper = std::make_shared<LevelGenotyper>(genotyper);
-  auto sample_json = make_json_prg(gtyper, tracker);
-  sample_json->set_sample_info(parameters.sample_id,
-                               "made by gramtools genotype");
-  geno_json_fhandle << sample_json->get_prg() << std::endl;
-  geno_json_fhandle.close();
-
-  std::cout << "Producing personalised reference" << std::endl;
-  auto sites = genotyper.get_genotyped_records();
-  tracker.reset();
-  auto p_refs =
-      get_personalised_ref(prg_info.coverage_graph.root, sites, tracker);
-  std::string desc = parameters.sample_id +
-                     " personalised reference made by gramtools genotype";
-  add_description(p_refs, desc);
-
-  write_deduped_p_refs(p_refs, parameters.personalised_ref_fpath);
-
-  std::cout << "Producing vcf" << std::endl;
-  tracker.reset();
-  write_vcf(parameters, gtyper, tracker);
+  std::cout << "Producing json vcf, vcf and personalised reference"
+            << std::endl;
+  instrumentation::begin_span("Write outputs");
+  write_genotyping_outputs(parameters, gtyper, prg_info.coverage_graph.root,
+                           tracker);
+  instrumentation::end_span();
+
+  timer.stop();
+  return quasimap_stats;
+}
+}  // namespace gram::genotype
+
+void gram::commands::genotype::run(GenotypeParams const& parameters,
+                                   bool const& debug) {
+  auto timer = TimerReport();
+  std::cout << "Executing genotype command" << std::endl;
 
+  timer.start("Load data");
+  // With `--numa interleave`, the indices' pages are spread over the NUMA
+  // nodes as they are loaded; later allocations are placed by the OS
+  std::optional<ScopedInterleave> interleave;
+  interleave.emplace(parameters.numa_policy == NumaPolicy::interleave);
+  std::cout << "Loading PRG data" << std::endl;
+  auto prg_info = load_prg_info(parameters);
+  // Genotyping from saved coverage maps no reads, so needs no kmer index
+  KmerIndex kmer_index;
+  if (!parameters.from_coverage) {
+    std::cout << "Loading kmer index data" << std::endl;
+    kmer_index = kmer_index::load(parameters);
+  }
+  interleave.reset();
+  // Mapping threads are pinned to NUMA nodes, and the indices replicated on
+  // them, once for all samples; threads stay pinned until the run ends
+  auto const numa_policy =
+      parameters.from_coverage ? NumaPolicy::none : parameters.numa_policy;
+  std::optional<PinnedThreads> pinned_threads;
+  if (numa_policy != NumaPolicy::none) pinned_threads.emplace();
+  IndexReplicas const indices(prg_info, kmer_index, numa_policy,
+                              parameters.huge_pages);
   timer.stop();
+
+  if (parameters.samples.empty()) {
+    genotype_sample(parameters, indices, debug, timer);
+    timer.report();
+    instrumentation::write_report(parameters.instrumentation_fpath);
+    return;
+  }
+
+  // Batch mode: the PRG and kmer index are loaded once for all samples.
+  // Samples are processed one after the other, each using all threads, as
+  // per base coverage is recorded in the shared coverage graph.
+  auto const num_samples = parameters.samples.size();
+  for (std::size_t i = 0; i < num_samples; ++i) {
+    auto const& sample = parameters.samples[i];
+    std::cout << "====================" << std::endl
+              << "Genotyping sample " << sample.sample_id << " (" << i + 1
+              << "/" << num_samples << ")" << std::endl;
+    if (i > 0) prg_info.coverage_graph.clear_coverage();
+    auto const sample_parameters = make_sample_parameters(parameters, sample);
+    instrumentation::Span sample_span("Sample " + sample.sample_id);
+    genotype_sample(sample_parameters, indices, debug, timer);
+  }
   timer.report();
+  instrumentation::write_report(parameters.instrumentation_fpath);
 }
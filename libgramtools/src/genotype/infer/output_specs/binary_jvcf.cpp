@@ -0,0 +1,510 @@
+#include "genotype/infer/output_specs/binary_jvcf.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "genotype/infer/output_specs/json_prg_spec.hpp"
+
+using namespace gram::json;
+using namespace gram::json::binary_jvcf;
+
+namespace {
+strings const columnar_fields{"POS",  "SEG", "ALS", "GT",
+                              "HAPG", "COV", "DP",  "FT"};
+
+void put_varint(std::string& buf, uint64_t value) {
+  while (value >= 0x80) {
+    buf.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  buf.push_back(static_cast<char>(value));
+}
+
+void put_u64(std::string& buf, uint64_t value) {
+  for (int i{0}; i < 8; i++)
+    buf.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+void put_double(std::string& buf, double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  put_u64(buf, bits);
+}
+
+void put_float(std::string& buf, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  for (int i{0}; i < 4; i++)
+    buf.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+}
+
+void put_cbor(std::string& buf, JSON const& value) {
+  auto const cbor = JSON::to_cbor(value);
+  put_varint(buf, cbor.size());
+  buf.append(cbor.begin(), cbor.end());
+}
+
+uint8_t get_byte(std::istream& in) {
+  auto const next = in.get();
+  if (next == std::char_traits<char>::eof())
+    throw BinaryJvcfException("Truncated binary jvcf");
+  return static_cast<uint8_t>(next);
+}
+
+uint64_t get_varint(std::istream& in) {
+  uint64_t result{0};
+  for (int shift{0}; shift < 64; shift += 7) {
+    auto const byte = get_byte(in);
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return result;
+  }
+  throw BinaryJvcfException("Malformed varint in binary jvcf");
+}
+
+uint64_t get_u64(std::istream& in) {
+  uint64_t result{0};
+  for (int i{0}; i < 8; i++)
+    result |= static_cast<uint64_t>(get_byte(in)) << (8 * i);
+  return result;
+}
+
+double get_double(std::istream& in) {
+  auto const bits = get_u64(in);
+  double result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+float get_float(std::istream& in) {
+  uint32_t bits{0};
+  for (int i{0}; i < 4; i++)
+    bits |= static_cast<uint32_t>(get_byte(in)) << (8 * i);
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+std::string get_bytes(std::istream& in, std::size_t size) {
+  std::string result(size, '\0');
+  if (!in.read(result.data(), size))
+    throw BinaryJvcfException("Truncated binary jvcf");
+  return result;
+}
+
+JSON get_cbor(std::istream& in) {
+  auto const bytes = get_bytes(in, get_varint(in));
+  return JSON::from_cbor(bytes.begin(), bytes.end());
+}
+
+bool is_index(JSON const& value) {
+  return value.is_number_integer() && value >= 0;
+}
+
+bool is_array_of(JSON const& value, bool (*predicate)(JSON const&)) {
+  if (!value.is_array()) return false;
+  for (auto const& element : value)
+    if (!predicate(element)) return false;
+  return true;
+}
+
+bool is_string(JSON const& value) { return value.is_string(); }
+
+bool is_nullable_index(JSON const& value) {
+  return value.is_null() || is_index(value);
+}
+
+bool is_single_precision(JSON const& value) {
+  double const val = value;
+  return static_cast<double>(static_cast<float>(val)) == val;
+}
+
+bool is_integral_float(JSON const& value) {
+  if (!value.is_number_float()) return false;
+  double const val = value;
+  return val >= 0 && val < 9007199254740992. && std::floor(val) == val;
+}
+
+/**
+ * Picks how to store a column of numbers, such that decoding gives back
+ * numbers of the same type (unsigned or float) and value.
+ */
+bool number_encoding(std::vector<JSON const*> const& numbers,
+                     NumberEncoding& encoding) {
+  bool all_indices{true}, all_floats{true}, all_integral{true},
+      all_single{true};
+  for (auto const number : numbers) {
+    all_indices &= is_index(*number);
+    all_floats &= number->is_number_float();
+    if (!all_floats) continue;
+    all_integral &= is_integral_float(*number);
+    all_single &= is_single_precision(*number);
+  }
+  if (all_indices)
+    encoding = NumberEncoding::unsigned_ints;
+  else if (all_floats && all_integral)
+    encoding = NumberEncoding::integral_floats;
+  else if (all_floats && all_single)
+    encoding = NumberEncoding::single_floats;
+  else if (all_floats)
+    encoding = NumberEncoding::floats;
+  else
+    return false;
+  return true;
+}
+
+void put_number(std::string& buf, JSON const& number,
+                NumberEncoding const encoding) {
+  switch (encoding) {
+    case NumberEncoding::unsigned_ints:
+      put_varint(buf, number.get<uint64_t>());
+      break;
+    case NumberEncoding::integral_floats:
+      put_varint(buf, static_cast<uint64_t>(number.get<double>()));
+      break;
+    case NumberEncoding::single_floats:
+      put_float(buf, number.get<double>());
+      break;
+    case NumberEncoding::floats:
+      put_double(buf, number.get<double>());
+      break;
+  }
+}
+
+JSON get_number(std::istream& in, NumberEncoding const encoding) {
+  switch (encoding) {
+    case NumberEncoding::unsigned_ints:
+      return JSON(get_varint(in));
+    case NumberEncoding::integral_floats:
+      return JSON(static_cast<double>(get_varint(in)));
+    case NumberEncoding::single_floats:
+      return JSON(static_cast<double>(get_float(in)));
+    case NumberEncoding::floats:
+      return JSON(get_double(in));
+  }
+  throw BinaryJvcfException("Unknown number encoding in binary jvcf");
+}
+
+NumberEncoding get_number_encoding(std::istream& in) {
+  auto const encoding = get_byte(in);
+  if (encoding > static_cast<uint8_t>(NumberEncoding::floats))
+    throw BinaryJvcfException("Unknown number encoding in binary jvcf");
+  return static_cast<NumberEncoding>(encoding);
+}
+}  // namespace
+
+Binary_Jvcf_Writer::Binary_Jvcf_Writer(std::ostream& out, JSON const& header)
+    : out(out), header(header), bytes_written(0), closed(false) {
+  this->header.erase("Sites");
+  buffer.append(magic, sizeof(magic));
+  for (int i{0}; i < 4; i++)
+    buffer.push_back(static_cast<char>((version >> (8 * i)) & 0xff));
+  flush_buffer();
+}
+
+uint64_t Binary_Jvcf_Writer::string_index(std::string const& str) {
+  auto const found = string_indices.find(str);
+  if (found != string_indices.end()) return found->second;
+  auto const inserted = string_indices.emplace(str, strings.size()).first;
+  strings.push_back(&inserted->first);
+  return inserted->second;
+}
+
+void Binary_Jvcf_Writer::flush_buffer() {
+  out.write(buffer.data(), buffer.size());
+  bytes_written += buffer.size();
+  buffer.clear();
+}
+
+bool Binary_Jvcf_Writer::encode_columnar(JSON const& site) {
+  if (!site.is_object()) return false;
+  for (auto const& field : columnar_fields)
+    if (!site.contains(field)) return false;
+
+  auto const& GTs = site.at("GT");
+  auto const& HAPGs = site.at("HAPG");
+  auto const& COVs = site.at("COV");
+  auto const& DPs = site.at("DP");
+  auto const& FTs = site.at("FT");
+  if (!is_index(site.at("POS")) || !site.at("SEG").is_string() ||
+      !is_array_of(site.at("ALS"), is_string) || !GTs.is_array())
+    return false;
+  auto const num_samples = GTs.size();
+  for (auto const field : {&HAPGs, &COVs, &DPs, &FTs})
+    if (!field->is_array() || field->size() != num_samples) return false;
+
+  std::vector<JSON const*> covs, dps;
+  for (std::size_t sample{0}; sample < num_samples; sample++) {
+    if (!is_array_of(GTs.at(sample), is_nullable_index) ||
+        !is_array_of(HAPGs.at(sample), is_index) ||
+        !COVs.at(sample).is_array() || !is_array_of(FTs.at(sample), is_string))
+      return false;
+    for (auto const& cov : COVs.at(sample)) covs.push_back(&cov);
+    dps.push_back(&DPs.at(sample));
+  }
+  NumberEncoding cov_encoding, dp_encoding;
+  if (!number_encoding(covs, cov_encoding) ||
+      !number_encoding(dps, dp_encoding))
+    return false;
+
+  buffer.push_back(static_cast<char>(SiteEncoding::columnar));
+  put_varint(buffer, site.at("POS").get<uint64_t>());
+  put_varint(buffer,
+             string_index(site.at("SEG").get_ref<std::string const&>()));
+  put_varint(buffer, site.at("ALS").size());
+  for (auto const& allele : site.at("ALS"))
+    put_varint(buffer, string_index(allele.get_ref<std::string const&>()));
+
+  put_varint(buffer, num_samples);
+  for (auto const& GT : GTs) {
+    put_varint(buffer, GT.size());
+    for (auto const& allele_index : GT)
+      put_varint(buffer, allele_index.is_null()
+                             ? 0
+                             : allele_index.get<uint64_t>() + 1);
+  }
+  for (auto const& HAPG : HAPGs) {
+    put_varint(buffer, HAPG.size());
+    for (auto const& hapg : HAPG) put_varint(buffer, hapg.get<uint64_t>());
+  }
+  buffer.push_back(static_cast<char>(cov_encoding));
+  for (auto const& COV : COVs) {
+    put_varint(buffer, COV.size());
+    for (auto const& cov : COV) put_number(buffer, cov, cov_encoding);
+  }
+  buffer.push_back(static_cast<char>(dp_encoding));
+  for (auto const& DP : DPs) put_number(buffer, DP, dp_encoding);
+  for (auto const& FT : FTs) {
+    put_varint(buffer, FT.size());
+    for (auto const& filter : FT)
+      put_varint(buffer, string_index(filter.get_ref<std::string const&>()));
+  }
+
+  put_varint(buffer, site.size() - columnar_fields.size());
+  for (auto const& entry : site.items()) {
+    if (std::find(columnar_fields.begin(), columnar_fields.end(),
+                  entry.key()) != columnar_fields.end())
+      continue;
+    put_varint(buffer, string_index(entry.key()));
+    put_other_field(entry.value(), num_samples);
+  }
+  return true;
+}
+
+void Binary_Jvcf_Writer::put_other_field(JSON const& field,
+                                         std::size_t const num_samples) {
+  // Model-specific fields normally hold one number per sample
+  std::vector<JSON const*> numbers;
+  bool is_number_column{field.is_array() && field.size() == num_samples};
+  if (is_number_column) {
+    for (auto const& value : field) {
+      is_number_column &= value.is_number();
+      numbers.push_back(&value);
+    }
+  }
+  NumberEncoding encoding;
+  if (is_number_column && number_encoding(numbers, encoding)) {
+    buffer.push_back(static_cast<char>(FieldEncoding::numbers));
+    buffer.push_back(static_cast<char>(encoding));
+    for (auto const number : numbers) put_number(buffer, *number, encoding);
+  } else {
+    buffer.push_back(static_cast<char>(FieldEncoding::cbor));
+    put_cbor(buffer, field);
+  }
+}
+
+void Binary_Jvcf_Writer::add_site(JSON const& site) {
+  if (closed) throw BinaryJvcfException("Adding a site to a closed jvcf");
+  site_offsets.push_back(bytes_written);
+  if (!encode_columnar(site)) {
+    buffer.clear();
+    buffer.push_back(static_cast<char>(SiteEncoding::cbor));
+    put_cbor(buffer, site);
+  }
+  flush_buffer();
+}
+
+void Binary_Jvcf_Writer::close() {
+  if (closed) return;
+  closed = true;
+
+  uint64_t const strings_start{bytes_written};
+  put_varint(buffer, strings.size());
+  for (auto const str : strings) {
+    put_varint(buffer, str->size());
+    buffer.append(*str);
+  }
+  flush_buffer();
+
+  uint64_t const offsets_start{bytes_written};
+  for (auto const offset : site_offsets) put_u64(buffer, offset);
+  flush_buffer();
+
+  uint64_t const header_start{bytes_written};
+  auto const cbor_header = JSON::to_cbor(header);
+  buffer.append(cbor_header.begin(), cbor_header.end());
+
+  put_u64(buffer, site_offsets.size());
+  put_u64(buffer, strings_start);
+  put_u64(buffer, offsets_start);
+  put_u64(buffer, header_start);
+  buffer.append(magic, sizeof(magic));
+  flush_buffer();
+  out.flush();
+}
+
+Binary_Jvcf_Reader::Binary_Jvcf_Reader(std::istream& in) : in(in) {
+  in.seekg(0, std::ios::end);
+  uint64_t const file_size = in.tellg();
+  auto const header_size = sizeof(magic) + sizeof(version);
+  if (!in || file_size < header_size + footer_size)
+    throw BinaryJvcfException("Not a binary jvcf: too small");
+
+  in.seekg(0);
+  if (get_bytes(in, sizeof(magic)) != std::string(magic, sizeof(magic)))
+    throw BinaryJvcfException("Not a binary jvcf: bad magic");
+  uint32_t file_version{0};
+  for (int i{0}; i < 4; i++)
+    file_version |= static_cast<uint32_t>(get_byte(in)) << (8 * i);
+  if (file_version != version)
+    throw BinaryJvcfException("Unsupported binary jvcf version " +
+                              std::to_string(file_version));
+
+  in.seekg(file_size - footer_size);
+  num_sites = get_u64(in);
+  auto const strings_start = get_u64(in);
+  offsets_start = get_u64(in);
+  auto const header_start = get_u64(in);
+  if (get_bytes(in, sizeof(magic)) != std::string(magic, sizeof(magic)))
+    throw BinaryJvcfException("Truncated binary jvcf: bad footer");
+  if (header_start > file_size - footer_size ||
+      offsets_start + num_sites * sizeof(uint64_t) != header_start)
+    throw BinaryJvcfException("Malformed binary jvcf footer");
+
+  in.seekg(header_start);
+  auto const cbor_header =
+      get_bytes(in, file_size - footer_size - header_start);
+  header = JSON::from_cbor(cbor_header.begin(), cbor_header.end());
+  header["Sites"] = JSON::array();
+
+  in.seekg(strings_start);
+  auto const num_strings = get_varint(in);
+  strings.reserve(num_strings);
+  for (uint64_t i{0}; i < num_strings; i++)
+    strings.push_back(get_bytes(in, get_varint(in)));
+}
+
+std::string const& Binary_Jvcf_Reader::read_string() {
+  auto const index = get_varint(in);
+  if (index >= strings.size())
+    throw BinaryJvcfException("Bad string index in binary jvcf");
+  return strings[index];
+}
+
+JSON Binary_Jvcf_Reader::read_columnar_site() {
+  JSON site = JSON::object();
+  site["POS"] = get_varint(in);
+  site["SEG"] = read_string();
+  auto& alleles = site["ALS"] = JSON::array();
+  auto const num_alleles = get_varint(in);
+  for (uint64_t i{0}; i < num_alleles; i++) alleles.push_back(read_string());
+
+  auto const num_samples = get_varint(in);
+  auto& GTs = site["GT"] = JSON::array();
+  for (uint64_t sample{0}; sample < num_samples; sample++) {
+    GTs.push_back(JSON::array());
+    auto& GT = GTs.back();
+    auto const ploidy = get_varint(in);
+    for (uint64_t i{0}; i < ploidy; i++) {
+      auto const allele_index = get_varint(in);
+      if (allele_index == 0)
+        GT.push_back(nullptr);
+      else
+        GT.push_back(allele_index - 1);
+    }
+  }
+  auto& HAPGs = site["HAPG"] = JSON::array();
+  for (uint64_t sample{0}; sample < num_samples; sample++) {
+    HAPGs.push_back(JSON::array());
+    auto& HAPG = HAPGs.back();
+    auto const num_hapgs = get_varint(in);
+    for (uint64_t i{0}; i < num_hapgs; i++) HAPG.push_back(get_varint(in));
+  }
+  auto const cov_encoding = get_number_encoding(in);
+  auto& COVs = site["COV"] = JSON::array();
+  for (uint64_t sample{0}; sample < num_samples; sample++) {
+    COVs.push_back(JSON::array());
+    auto& COV = COVs.back();
+    auto const num_covs = get_varint(in);
+    for (uint64_t i{0}; i < num_covs; i++)
+      COV.push_back(get_number(in, cov_encoding));
+  }
+  auto const dp_encoding = get_number_encoding(in);
+  auto& DPs = site["DP"] = JSON::array();
+  for (uint64_t sample{0}; sample < num_samples; sample++)
+    DPs.push_back(get_number(in, dp_encoding));
+  auto& FTs = site["FT"] = JSON::array();
+  for (uint64_t sample{0}; sample < num_samples; sample++) {
+    FTs.push_back(JSON::array());
+    auto& FT = FTs.back();
+    auto const num_filters = get_varint(in);
+    for (uint64_t i{0}; i < num_filters; i++) FT.push_back(read_string());
+  }
+
+  auto const num_other_fields = get_varint(in);
+  for (uint64_t i{0}; i < num_other_fields; i++) {
+    auto const& key = read_string();
+    site[key] = read_other_field(num_samples);
+  }
+  return site;
+}
+
+JSON Binary_Jvcf_Reader::read_other_field(std::size_t const num_samples) {
+  switch (static_cast<FieldEncoding>(get_byte(in))) {
+    case FieldEncoding::numbers: {
+      auto const encoding = get_number_encoding(in);
+      JSON field = JSON::array();
+      for (std::size_t sample{0}; sample < num_samples; sample++)
+        field.push_back(get_number(in, encoding));
+      return field;
+    }
+    case FieldEncoding::cbor:
+      return get_cbor(in);
+  }
+  throw BinaryJvcfException("Unknown field encoding in binary jvcf");
+}
+
+JSON Binary_Jvcf_Reader::get_site(std::size_t site_index) {
+  if (site_index >= num_sites)
+    throw BinaryJvcfException("Site index " + std::to_string(site_index) +
+                              " out of range");
+  in.clear();
+  in.seekg(offsets_start + site_index * sizeof(uint64_t));
+  in.seekg(get_u64(in));
+
+  switch (static_cast<SiteEncoding>(get_byte(in))) {
+    case SiteEncoding::columnar:
+      return read_columnar_site();
+    case SiteEncoding::cbor:
+      return get_cbor(in);
+  }
+  throw BinaryJvcfException("Unknown site encoding in binary jvcf");
+}
+
+void gram::json::json_to_binary_jvcf(std::istream& json_in,
+                                     std::ostream& binary_out) {
+  Json_Prg_Reader reader(json_in);
+  Binary_Jvcf_Writer writer(binary_out, reader.get_header());
+  JSON site;
+  while (reader.next_site(site)) writer.add_site(site);
+  writer.close();
+}
+
+void gram::json::binary_to_json_jvcf(std::istream& binary_in,
+                                     std::ostream& json_out) {
+  Binary_Jvcf_Reader reader(binary_in);
+  Json_Prg_Writer writer(json_out, reader.get_header());
+  for (std::size_t i{0}; i < reader.size(); i++)
+    writer.add_site(reader.get_site(i));
+  writer.close();
+}
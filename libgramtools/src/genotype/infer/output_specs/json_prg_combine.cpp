@@ -0,0 +1,219 @@
+#include "genotype/infer/output_specs/json_prg_combine.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <set>
+
+#include "genotype/infer/output_specs/json_site_spec.hpp"
+
+namespace fs = std::filesystem;
+using namespace gram::json;
+
+namespace {
+void check_num_samples(JSON const& site, std::size_t const num_samples,
+                       std::string const& fpath) {
+  if (site.at("GT").size() != num_samples)
+    throw JSONConsistencyException(
+        "JSON " + fpath +
+        " does not have number of GT arrays consistent with its number of "
+        "Samples");
+}
+
+std::vector<std::unique_ptr<std::ifstream>> open_jsons(
+    std::vector<std::string> const& fpaths) {
+  std::vector<std::unique_ptr<std::ifstream>> streams;
+  for (auto const& fpath : fpaths) {
+    streams.push_back(std::make_unique<std::ifstream>(fpath));
+    if (!streams.back()->good())
+      throw JSONCombineException("Could not open JSON file " + fpath);
+  }
+  return streams;
+}
+
+/** The names of each jvcf's samples */
+std::vector<std::vector<std::string>> read_sample_names(
+    std::vector<std::string> const& fpaths) {
+  std::vector<std::vector<std::string>> names;
+  for (auto const& stream : open_jsons(fpaths)) {
+    Json_Prg_Reader reader(*stream);
+    names.emplace_back();
+    for (auto const& sample : reader.get_header().at("Samples"))
+      names.back().push_back(sample.at("Name"));
+  }
+  return names;
+}
+
+/**
+ * The names of the samples of all the jvcfs, in order, once combined: with
+ * `force`, a name seen before gets the lowest "_<n>" suffix that no sample
+ * has.
+ * @throws JSONConsistencyException on a name seen before, without `force`.
+ */
+std::vector<std::string> combined_sample_names(
+    std::vector<std::vector<std::string>> const& file_sample_names,
+    bool const force) {
+  std::vector<std::string> names;
+  for (auto const& file_names : file_sample_names)
+    names.insert(names.end(), file_names.begin(), file_names.end());
+
+  std::set<std::string> taken(names.begin(), names.end());
+  std::set<std::string> seen;
+  for (auto& name : names) {
+    if (seen.insert(name).second) continue;
+    if (!force)
+      throw JSONConsistencyException("Duplicate sample name found: " + name);
+    std::size_t suffix{1};
+    while (taken.count(name + "_" + std::to_string(suffix)) > 0) suffix++;
+    name += "_" + std::to_string(suffix);
+    taken.insert(name);
+  }
+  return names;
+}
+
+/**
+ * Merges the jvcfs in `fpaths`, naming their samples, in order, `names`.
+ */
+void merge_renamed_json_prgs(std::vector<std::string> const& fpaths,
+                             std::vector<std::string> const& names,
+                             std::ostream& out) {
+  auto const streams = open_jsons(fpaths);
+  std::vector<std::unique_ptr<Json_Prg_Reader>> readers;
+  for (auto const& stream : streams)
+    readers.push_back(std::make_unique<Json_Prg_Reader>(*stream));
+
+  // Combine headers
+  auto next_name = names.begin();
+  std::vector<std::size_t> num_samples;
+  std::optional<Json_Prg> combined;
+  for (auto const& reader : readers) {
+    auto header = reader->get_header();
+    for (auto& sample : header.at("Samples")) sample.at("Name") = *next_name++;
+    num_samples.push_back(header.at("Samples").size());
+    Json_Prg next(std::move(header));
+    if (!combined) {
+      combined.emplace(std::move(next));
+      continue;
+    }
+    combined->check_combinable(next);
+    // Names are already unique
+    combined->add_samples(next, false);
+  }
+  std::string const gtyping_model = combined->get_prg().at("Model");
+
+  // Combine sites
+  Json_Prg_Writer writer(out, combined->get_prg());
+  JSON site_json;
+  while (readers.at(0)->next_site(site_json)) {
+    check_num_samples(site_json, num_samples.at(0), fpaths.at(0));
+    Json_Site combined_site(std::move(site_json));
+    for (std::size_t i{1}; i < readers.size(); i++) {
+      if (!readers.at(i)->next_site(site_json))
+        throw JSONCombineException(
+            "JSONs do not have the same number of sites");
+      check_num_samples(site_json, num_samples.at(i), fpaths.at(i));
+      Json_Site next_site(std::move(site_json));
+      combined_site.combine_with(next_site, gtyping_model);
+    }
+    writer.add_site(combined_site.get_site());
+  }
+  for (std::size_t i{1}; i < readers.size(); i++) {
+    if (readers.at(i)->next_site(site_json))
+      throw JSONCombineException("JSONs do not have the same number of sites");
+  }
+  writer.close();
+  if (!out) throw JSONCombineException("Failed to write the combined JSON");
+}
+
+/** Merges into a file, checking that it got fully written */
+void merge_renamed_json_prgs(std::vector<std::string> const& fpaths,
+                             std::vector<std::string> const& names,
+                             std::string const& out_fpath) {
+  std::ofstream out(out_fpath);
+  if (!out.good())
+    throw JSONCombineException("Could not open output file " + out_fpath);
+  merge_renamed_json_prgs(fpaths, names, out);
+  out.close();
+  if (!out) throw JSONCombineException("Failed to write " + out_fpath);
+}
+}  // namespace
+
+void gram::json::merge_json_prgs(std::vector<std::string> const& fpaths,
+                                 std::ostream& out, bool force) {
+  if (fpaths.empty()) throw JSONCombineException("No JSONs to combine");
+  merge_renamed_json_prgs(
+      fpaths, combined_sample_names(read_sample_names(fpaths), force), out);
+}
+
+void gram::json::combine_json_prgs(std::vector<std::string> const& fpaths,
+                                   std::string const& out_fpath,
+                                   std::size_t fan_in, bool force) {
+  if (fan_in < 2) throw JSONCombineException("Merge fan-in must be at least 2");
+  if (fpaths.empty()) throw JSONCombineException("No JSONs to combine");
+
+  // Samples are renamed over all the files at once: renaming within each group
+  // could give samples of different groups the same name
+  auto const file_sample_names = read_sample_names(fpaths);
+  auto const names = combined_sample_names(file_sample_names, force);
+  fs::path tmp_dir{out_fpath + "_combine_tmp"};
+  std::vector<std::string> to_merge{fpaths};
+  // The index, in `names`, of the first sample of each file to merge
+  std::vector<std::size_t> first_sample{0};
+  for (auto const& file_names : file_sample_names)
+    first_sample.push_back(first_sample.back() + file_names.size());
+  auto const names_of = [&](std::size_t const first, std::size_t const last) {
+    return std::vector<std::string>(names.begin() + first_sample.at(first),
+                                    names.begin() + first_sample.at(last));
+  };
+
+  std::size_t level{0};
+  while (to_merge.size() > fan_in) {
+    fs::create_directories(tmp_dir);
+    std::size_t const num_groups{(to_merge.size() + fan_in - 1) / fan_in};
+    std::vector<std::string> merged(num_groups);
+    std::vector<std::exception_ptr> errors(num_groups);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (std::size_t group = 0; group < num_groups; group++) {
+      try {
+        auto const first = group * fan_in;
+        auto const last = std::min((group + 1) * fan_in, to_merge.size());
+        merged.at(group) = (tmp_dir / ("level" + std::to_string(level) +
+                                       "_group" + std::to_string(group) +
+                                       ".json"))
+                               .string();
+        merge_renamed_json_prgs(
+            {to_merge.begin() + first, to_merge.begin() + last},
+            names_of(first, last), merged.at(group));
+      } catch (...) {
+        errors.at(group) = std::current_exception();
+      }
+    }
+
+    for (auto const& error : errors) {
+      if (error) {
+        fs::remove_all(tmp_dir);
+        std::rethrow_exception(error);
+      }
+    }
+    if (level > 0)
+      for (auto const& fpath : to_merge) fs::remove(fpath);
+    std::vector<std::size_t> merged_first_sample;
+    for (std::size_t group = 0; group <= num_groups; group++)
+      merged_first_sample.push_back(first_sample.at(
+          std::min(group * fan_in, first_sample.size() - 1)));
+    to_merge = std::move(merged);
+    first_sample = std::move(merged_first_sample);
+    level++;
+  }
+
+  try {
+    merge_renamed_json_prgs(to_merge, names, out_fpath);
+  } catch (...) {
+    fs::remove_all(tmp_dir);
+    throw;
+  }
+  fs::remove_all(tmp_dir);
+}
@@ -40,8 +40,9 @@ void Json_Prg::add_header(vcf_meta_info_line header) {
 
 void Json_Prg::add_samples(Json_Prg& other, const bool force) {
   auto& other_prg = other.get_prg();
-  if (other_prg.at("Sites").at(0).at("GT").size() !=
-      other_prg.at("Samples").size())
+  if (!other_prg.at("Sites").empty() &&
+      other_prg.at("Sites").at(0).at("GT").size() !=
+          other_prg.at("Samples").size())
     throw JSONConsistencyException(
         "Merged in JSON does not have number of GT arrays"
         " consistent with its number of Samples");
@@ -70,8 +71,8 @@ void Json_Prg::add_samples(Json_Prg& other, const bool force) {
   }
 }
 
-void Json_Prg::combine_with(Json_Prg& other, bool force) {
-  auto other_prg = other.get_prg();
+void Json_Prg::check_combinable(Json_Prg const& other) const {
+  auto const& other_prg = other.get_prg();
   if (json_prg.at("Model") != other_prg.at("Model"))
     throw JSONCombineException("JSONs have different models");
 
@@ -84,6 +85,10 @@ void Json_Prg::combine_with(Json_Prg& other, bool force) {
 
   if (json_prg.at("Site_Fields") != other_prg.at("Site_Fields"))
     throw JSONCombineException("Incompatible Site Fields");
+}
+
+void Json_Prg::combine_with(Json_Prg& other, bool force) {
+  check_combinable(other);
 
   if (sites.size() != other.sites.size())
     throw JSONCombineException("JSONs do not have the same number of sites");
@@ -96,3 +101,176 @@ void Json_Prg::combine_with(Json_Prg& other, bool force) {
     json_prg.at("Sites").at(j) = sites.at(j)->get_site();
   }
 }
+
+Json_Prg_Writer::Json_Prg_Writer(std::ostream& out, JSON const& header)
+    : out(out), first_site(true), closed(false) {
+  JSON no_sites = header;
+  no_sites.erase("Sites");
+  std::string serialised = no_sites.dump();
+  serialised.pop_back();  // Closing brace, written by close()
+  out << serialised;
+  if (!no_sites.empty()) out << ",";
+  out << "\"Sites\":[";
+}
+
+void Json_Prg_Writer::add_site(JSON const& site) {
+  if (closed) throw JSONConsistencyException("Adding a site to a closed jvcf");
+  if (!first_site) out << ",";
+  out << site;
+  first_site = false;
+}
+
+void Json_Prg_Writer::close() {
+  if (closed) return;
+  out << "]}" << std::endl;
+  closed = true;
+}
+
+Json_Prg_Reader::Json_Prg_Reader(std::istream& in)
+    : in(in),
+      first_site(true),
+      sites_done(false),
+      trailing_entries_read(false) {
+  read_header();
+}
+
+void Json_Prg_Reader::skip_whitespace() {
+  while (std::isspace(in.peek())) in.get();
+}
+
+char Json_Prg_Reader::expect(std::string const& allowed) {
+  skip_whitespace();
+  auto const next = in.get();
+  if (next == std::char_traits<char>::eof() ||
+      allowed.find(static_cast<char>(next)) == std::string::npos)
+    throw JSONConsistencyException("Malformed jvcf: expected one of '" +
+                                   allowed + "'");
+  return static_cast<char>(next);
+}
+
+void Json_Prg_Reader::read_raw_value(std::string* out) {
+  skip_whitespace();
+  std::size_t depth{0};
+  bool in_string{false}, escaped{false};
+  auto streambuf = in.rdbuf();
+  while (true) {
+    auto const next = streambuf->sgetc();
+    if (next == std::char_traits<char>::eof()) {
+      if (depth > 0 || in_string)
+        throw JSONConsistencyException("Malformed jvcf: truncated value");
+      in.setstate(std::ios::eofbit);
+      return;
+    }
+    auto const c = static_cast<char>(next);
+    if (in_string) {
+      if (escaped)
+        escaped = false;
+      else if (c == '\\')
+        escaped = true;
+      else if (c == '"') {
+        in_string = false;
+        if (depth == 0) {  // A top-level string value ends here
+          if (out != nullptr) out->push_back(c);
+          streambuf->sbumpc();
+          return;
+        }
+      }
+    } else if (c == '"')
+      in_string = true;
+    else if (c == '{' || c == '[')
+      depth++;
+    else if (c == '}' || c == ']') {
+      if (depth == 0) return;  // Closes the enclosing container
+      depth--;
+      if (depth == 0) {
+        if (out != nullptr) out->push_back(c);
+        streambuf->sbumpc();
+        return;
+      }
+    } else if (depth == 0 && (c == ',' || std::isspace(next)))
+      return;  // End of a scalar value
+    if (out != nullptr) out->push_back(c);
+    streambuf->sbumpc();
+  }
+}
+
+void Json_Prg_Reader::read_entries(bool stop_at_sites) {
+  std::string raw;
+  while (true) {
+    raw.clear();
+    read_raw_value(&raw);
+    std::string const key = JSON::parse(raw);
+    expect(":");
+    if (key == "Sites") {
+      expect("[");
+      header["Sites"] = JSON::array();
+      if (stop_at_sites) return;
+      // Skip over the sites, they get read by next_site()
+      skip_whitespace();
+      if (in.peek() == ']')
+        in.get();
+      else {
+        read_raw_value(nullptr);
+        while (expect(",]") == ',') read_raw_value(nullptr);
+      }
+    } else {
+      raw.clear();
+      read_raw_value(&raw);
+      header[key] = JSON::parse(raw);
+    }
+    if (expect(",}") == '}') return;
+  }
+}
+
+void Json_Prg_Reader::read_header() {
+  expect("{");
+  read_entries(true);
+  if (!header.contains("Sites"))
+    throw JSONConsistencyException("Malformed jvcf: no Sites entry");
+
+  // Sites are normally the last entry, as keys get serialised sorted. If not,
+  // the entries after them are read now and the stream rewound to the sites.
+  bool header_complete{true};
+  for (auto const& entry : gram::json::spec::json_prg.items())
+    header_complete &= header.contains(entry.key());
+  if (header_complete) return;
+
+  auto const sites_start = in.tellg();
+  if (sites_start == std::streampos(-1))
+    throw JSONConsistencyException(
+        "Malformed jvcf: cannot read past Sites of a non-seekable stream");
+  skip_whitespace();
+  if (in.peek() == ']')
+    in.get();
+  else {
+    read_raw_value(nullptr);
+    while (expect(",]") == ',') read_raw_value(nullptr);
+  }
+  if (expect(",}") == ',') read_entries(false);
+  in.clear();
+  in.seekg(sites_start);
+  trailing_entries_read = true;
+}
+
+bool Json_Prg_Reader::next_site(JSON& site) {
+  if (sites_done) return false;
+  bool no_more_sites;
+  if (first_site) {
+    skip_whitespace();
+    no_more_sites = in.peek() == ']';
+    if (no_more_sites) in.get();
+  } else
+    no_more_sites = expect(",]") == ']';
+
+  if (no_more_sites) {
+    sites_done = true;
+    if (!trailing_entries_read && expect(",}") == ',') read_entries(false);
+    return false;
+  }
+
+  first_site = false;
+  std::string raw;
+  read_raw_value(&raw);
+  site = JSON::parse(raw);
+  return true;
+}
@@ -7,23 +7,29 @@ using namespace gram::genotype;
 json_prg_ptr make_json_prg(gtyper_ptr const& gtyper, SegmentTracker& tracker) {
   auto result = std::make_shared<Json_Prg>();
   populate_json_prg(*result, gtyper);
-  auto genotyped_records = gtyper->get_genotyped_records();
-  for (auto const& site : genotyped_records) {
-    auto json_site = make_json_site(site);
-    auto site_pos = site->get_pos();
-    json_site->set_segment(tracker.get_ID(site_pos));
-    json_site->set_pos(tracker.get_relative_pos(site_pos) +
-                       1);  // 0-based to 1-based
-    result->add_site(json_site);
-  }
+  for (auto const& site : gtyper->get_genotyped_records())
+    result->add_site(make_positioned_json_site(site, tracker));
   return result;
 }
 
+void write_json_prg(std::ostream& out, gtyper_ptr const& gtyper,
+                    SegmentTracker& tracker, std::string const& sample_id,
+                    std::string const& sample_desc) {
+  Json_Prg header;
+  populate_json_prg(header, gtyper);
+  header.set_sample_info(sample_id, sample_desc);
+
+  Json_Prg_Writer writer(out, header.get_prg());
+  for (auto const& site : gtyper->get_genotyped_records())
+    writer.add_site(make_positioned_json_site(site, tracker)->get_site());
+  writer.close();
+}
+
 void populate_json_prg(Json_Prg& json_prg, gtyper_ptr const& gtyper) {
   auto& cur_json = json_prg.get_prg();
-  auto cov_graph = gtyper->get_cov_g();
-  auto child_m = gtyper->get_child_m();
-  auto genotyped_records = gtyper->get_genotyped_records();
+  auto const& cov_graph = gtyper->get_cov_g();
+  auto const& child_m = gtyper->get_child_m();
+  auto const& genotyped_records = gtyper->get_genotyped_records();
   if (!cov_graph->is_nested)
     cur_json.at("Lvl1_Sites").push_back("all");
   else {
@@ -80,3 +86,13 @@ json_site_ptr make_json_site(gt_site_ptr const& gt_site) {
 
   return result;
 }
+
+json_site_ptr make_positioned_json_site(gt_site_ptr const& gt_site,
+                                        SegmentTracker& tracker) {
+  auto json_site = make_json_site(gt_site);
+  auto site_pos = gt_site->get_pos();
+  json_site->set_segment(tracker.get_ID(site_pos));
+  json_site->set_pos(tracker.get_relative_pos(site_pos) +
+                     1);  // 0-based to 1-based
+  return json_site;
+}
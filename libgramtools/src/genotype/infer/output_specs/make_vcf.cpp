@@ -1,22 +1,65 @@
 #include "genotype/infer/output_specs/make_vcf.hpp"
 #include <htslib/synced_bcf_reader.h>
+#include <htslib/tbx.h>
+
+#include <memory>
+
 #include "genotype/infer/output_specs/fields.hpp"
 #include "genotype/infer/output_specs/segment_tracker.hpp"
 #include "prg/coverage_graph.hpp"
 
+namespace {
+using VcfFile = std::unique_ptr<htsFile, decltype(&hts_close)>;
+using VcfHeader = std::unique_ptr<bcf_hdr_t, decltype(&bcf_hdr_destroy)>;
+using VcfRecord = std::unique_ptr<bcf1_t, decltype(&bcf_destroy)>;
+}  // namespace
+
 void write_vcf(gram::GenotypeParams const& params, gtyper_ptr const& gtyper,
                SegmentTracker& tracker) {
-  auto fout = bcf_open(params.genotyped_vcf_fpath.c_str(), "wz");  // Writer
+  // Closed, and the header freed, if writing throws
+  VcfFile fout{bcf_open(params.genotyped_vcf_fpath.c_str(), "wz"), &hts_close};
+  if (fout == nullptr)
+    throw VcfWriteException("Failed to open " + params.genotyped_vcf_fpath);
+  // BGZF compression runs on a thread pool
+  if (params.maximum_threads > 1)
+    hts_set_threads(fout.get(), static_cast<int>(params.maximum_threads));
 
   // Set up and write header
-  bcf_hdr_t* header = bcf_hdr_init("w");
-  populate_vcf_hdr(header, gtyper, params, tracker);
-  if (bcf_hdr_write(fout, header) != 0)
+  VcfHeader header{bcf_hdr_init("w"), &bcf_hdr_destroy};
+  populate_vcf_hdr(header.get(), gtyper, params, tracker);
+  if (bcf_hdr_write(fout.get(), header.get()) != 0)
     throw VcfWriteException("Failed to write vcf header");
 
-  write_sites(fout, header, gtyper, tracker);
+  write_sites(fout.get(), header.get(), gtyper, tracker);
 
-  bcf_close(fout);
+  header.reset();
+  if (bcf_close(fout.release()) != 0)
+    throw VcfWriteException("Failed to close vcf");
+
+  // Indexed once closed: htslib 1.10 only indexes bcf files on the fly. The
+  // vcf is decompressed on as many threads as it was compressed.
+  auto const min_shift = vcf_index_min_shift(tracker);
+  if (!min_shift.has_value()) {
+    std::cout << "Segment sizes are unknown, not indexing the vcf" << std::endl;
+    return;
+  }
+  if (tbx_index_build3(params.genotyped_vcf_fpath.c_str(), nullptr,
+                       min_shift.value(),
+                       static_cast<int>(params.maximum_threads),
+                       &tbx_conf_vcf) != 0)
+    throw VcfWriteException("Failed to index " + params.genotyped_vcf_fpath);
+}
+
+std::optional<int> vcf_index_min_shift(SegmentTracker const& tracker) {
+  constexpr std::size_t max_tbi_segment_size{1ULL << 29};
+  bool use_tbi{true};
+  for (auto const& segment : tracker.get_segments()) {
+    if (segment.size == std::numeric_limits<std::size_t>::max())
+      return std::nullopt;
+    if (segment.size >= max_tbi_segment_size) use_tbi = false;
+  }
+  if (use_tbi) return 0;
+  return 14;
 }
 
 void populate_vcf_hdr(bcf_hdr_t* hdr, gtyper_ptr gtyper,
@@ -61,19 +104,20 @@ std::size_t next_valid_idx(std::size_t idx, std::size_t max_size,
 
 void write_sites(htsFile* fout, bcf_hdr_t* header, gtyper_ptr const& gtyper,
                  SegmentTracker& tracker) {
-  auto p_map = gtyper->get_cov_g()->par_map;
-  auto genotyped_records = gtyper->get_genotyped_records();
+  auto const& p_map = gtyper->get_cov_g()->par_map;
+  auto const& genotyped_records = gtyper->get_genotyped_records();
   std::size_t site_idx{0}, max_size{genotyped_records.size()};
   // Set up and write records
-  bcf1_t* record = bcf_init();
+  VcfRecord record{bcf_init(), &bcf_destroy};
 
   while (true) {
     site_idx = next_valid_idx(site_idx, max_size, p_map);
     if (site_idx >= max_size) break;
 
-    bcf_empty(record);
-    populate_vcf_site(header, record, genotyped_records[site_idx], tracker);
-    if (bcf_write(fout, header, record) != 0)
+    bcf_empty(record.get());
+    populate_vcf_site(header, record.get(), genotyped_records[site_idx],
+                      tracker);
+    if (bcf_write(fout, header, record.get()) != 0)
       throw VcfWriteException("Failed to write vcf record");
     site_idx++;
   }
@@ -89,8 +133,8 @@ void add_model_specific_entries(bcf_hdr_t* hdr, bcf1_t* record,
   }
 }
 
-void populate_vcf_site(bcf_hdr_t* header, bcf1_t* record, gt_site_ptr site,
-                       SegmentTracker& tracker) {
+void populate_vcf_site(bcf_hdr_t* header, bcf1_t* record,
+                       gt_site_ptr const& site, SegmentTracker& tracker) {
   using str_vec = std::vector<std::string>;
 
   // Set CHROM
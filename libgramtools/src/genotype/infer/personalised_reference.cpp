@@ -1,22 +1,26 @@
 #include "genotype/infer/personalised_reference.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <fstream>
 #include <genotype/infer/output_specs/segment_tracker.hpp>
 #include "genotype/infer/interfaces.hpp"
 #include "prg/coverage_graph.hpp"
 
 namespace gram::genotype {
 
+GtypedIndices allele_indices_to_paste(gt_site_ptr const& site,
+                                      std::size_t ploidy) {
+  if (site->is_null()) return GtypedIndices(ploidy, 0);
+  auto const& gts = site->get_genotype();
+  if (gts.size() != ploidy) throw InconsistentPloidyException();
+  return gts;
+}
+
 allele_vector get_all_alleles_to_paste(gt_site_ptr const& site,
                                        std::size_t ploidy) {
   allele_vector result(ploidy);
-  auto all_site_alleles = site->get_alleles();
-  GtypedIndices gts;
-  if (site->is_null())
-    gts = GtypedIndices(ploidy, 0);
-  else
-    gts = site->get_genotype();
-
-  if (gts.size() != ploidy) throw InconsistentPloidyException();
-
+  auto const& all_site_alleles = site->get_alleles();
+  auto const gts = allele_indices_to_paste(site, ploidy);
   for (int j{0}; j < ploidy; j++) result.at(j) = all_site_alleles.at(gts.at(j));
 
   return result;
@@ -48,63 +52,65 @@ void add_segment_IDs(Fastas& p_refs, std::size_t const offset,
   }
 }
 
+namespace {
+/**
+ * A stretch of a personalised reference: either invariant sequence from a
+ * node, or the genotyped alleles of a (level 1) site.
+ */
+struct p_ref_piece {
+  covG_ptr node;  // nullptr for a site
+  std::size_t site_index, start, length;
+};
+using segment_pieces = std::vector<p_ref_piece>;
+
 // Helper function for get_personalised_ref()
-std::size_t switch_segment(Fastas& p_refs, std::size_t& offset,
+std::size_t switch_segment(Fastas& p_refs, std::size_t& segment,
                            std::size_t const& ploidy, SegmentTracker& tracker) {
   if (tracker.edge() != tracker.global_edge()) {
     auto new_ID = tracker.get_ID(tracker.edge() + 1);
-    offset += ploidy;
-    add_segment_IDs(p_refs, offset, ploidy, new_ID);
+    segment++;
+    add_segment_IDs(p_refs, segment * ploidy, ploidy, new_ID);
   }
   return tracker.edge();
 }
 
-// Helper function for get_personalised_ref()
-void add_invariant_sequence(Fastas& p_refs, std::size_t const offset,
-                            std::size_t const ploidy, std::string const seq) {
-  for (int i{0}; i < ploidy; i++) p_refs.at(i + offset).add_sequence(seq);
-}
-
-Fastas get_personalised_ref(covG_ptr graph_root,
-                            gt_sites const& genotyped_records,
-                            SegmentTracker& tracker) {
-  auto ploidy = get_ploidy(genotyped_records);
-  auto num_segments = tracker.num_segments();
-  Fastas p_refs(num_segments * ploidy);
+/**
+ * Walks the graph, skipping over sites, to record the pieces making up each
+ * segment. Also sets the personalised references' IDs.
+ */
+std::vector<segment_pieces> split_into_segments(
+    covG_ptr graph_root, gt_sites const& genotyped_records,
+    SegmentTracker& tracker, Fastas& p_refs, std::size_t const ploidy) {
+  std::vector<segment_pieces> segments(tracker.num_segments());
   gram::covG_ptr cur_Node{graph_root};
 
-  std::size_t offset{0};
+  std::size_t segment{0};
   auto cur_edge = tracker.edge();
-  add_segment_IDs(p_refs, offset, ploidy, tracker.get_ID(cur_edge));
+  add_segment_IDs(p_refs, 0, ploidy, tracker.get_ID(cur_edge));
 
   while (cur_Node->get_edges().size() > 0) {
     if (cur_Node->is_bubble_start()) {
       auto site_index = siteID_to_index(cur_Node->get_site_ID());
-      auto site = genotyped_records.at(site_index);
-      auto to_paste_alleles = get_all_alleles_to_paste(site, ploidy);
-      for (int i{0}; i < ploidy; i++)
-        p_refs.at(i + offset).add_sequence(to_paste_alleles.at(i).sequence);
+      segments.at(segment).push_back({nullptr, site_index, 0, 0});
 
-      cur_Node = site->get_site_end_node();
+      cur_Node = genotyped_records.at(site_index)->get_site_end_node();
       if (cur_edge == cur_Node->get_pos() - 1)
-        cur_edge = switch_segment(p_refs, offset, ploidy, tracker);
+        cur_edge = switch_segment(p_refs, segment, ploidy, tracker);
     }
 
     if (cur_Node->has_sequence()) {
       std::size_t cur_pos = cur_Node->get_pos();
       std::size_t end_pos = cur_pos + cur_Node->get_sequence_size() - 1;
-      auto sequence = cur_Node->get_sequence();
       while (cur_pos <= end_pos) {
+        auto const start = cur_pos - cur_Node->get_pos();
         if (cur_edge <= end_pos) {
-          add_invariant_sequence(p_refs, offset, ploidy,
-                                 sequence.substr(cur_pos - cur_Node->get_pos(),
-                                                 cur_edge - cur_pos + 1));
+          segments.at(segment).push_back(
+              {cur_Node, 0, start, cur_edge - cur_pos + 1});
           cur_pos = cur_edge + 1;
-          cur_edge = switch_segment(p_refs, offset, ploidy, tracker);
+          cur_edge = switch_segment(p_refs, segment, ploidy, tracker);
         } else {
-          add_invariant_sequence(
-              p_refs, offset, ploidy,
-              sequence.substr(cur_pos - cur_Node->get_pos()));
+          segments.at(segment).push_back(
+              {cur_Node, 0, start, end_pos - cur_pos + 1});
           cur_pos = end_pos + 1;
         }
       }
@@ -113,6 +119,87 @@ Fastas get_personalised_ref(covG_ptr graph_root,
     assert(cur_Node->get_edges().size() == 1);
     cur_Node = cur_Node->get_edges().at(0);
   }
+  return segments;
+}
+
+/**
+ * Pastes the pieces of one segment into its `ploidy` personalised references,
+ * which start at `offset`.
+ */
+void build_segment(Fastas& p_refs, std::size_t const offset,
+                   std::size_t const ploidy, segment_pieces const& pieces,
+                   gt_sites const& genotyped_records) {
+  std::vector<GtypedIndices> site_gts;
+  std::vector<std::size_t> sizes(ploidy, 0);
+  for (auto const& piece : pieces) {
+    if (piece.node != nullptr) {
+      for (auto& size : sizes) size += piece.length;
+      continue;
+    }
+    auto const& site = genotyped_records.at(piece.site_index);
+    site_gts.push_back(allele_indices_to_paste(site, ploidy));
+    for (int i{0}; i < ploidy; i++)
+      sizes.at(i) +=
+          site->get_alleles().at(site_gts.back().at(i)).sequence.size();
+  }
+  for (int i{0}; i < ploidy; i++) p_refs.at(i + offset).reserve(sizes.at(i));
+
+  auto gts = site_gts.begin();
+  for (auto const& piece : pieces) {
+    if (piece.node != nullptr) {
+      for (int i{0}; i < ploidy; i++)
+        p_refs.at(i + offset).add_sequence(piece.node->get_sequence(),
+                                           piece.start, piece.length);
+      continue;
+    }
+    auto const& alleles =
+        genotyped_records.at(piece.site_index)->get_alleles();
+    for (int i{0}; i < ploidy; i++)
+      p_refs.at(i + offset).add_sequence(alleles.at(gts->at(i)).sequence);
+    gts++;
+  }
+}
+
+void build_segments(Fastas& p_refs, std::size_t const ploidy,
+                    std::vector<segment_pieces> const& segments,
+                    gt_sites const& genotyped_records,
+                    std::vector<std::exception_ptr>& errors) {
+#pragma omp taskloop grainsize(1) \
+    shared(p_refs, segments, genotyped_records, errors)
+  for (std::size_t segment = 0; segment < segments.size(); segment++) {
+    try {
+      build_segment(p_refs, segment * ploidy, ploidy, segments.at(segment),
+                    genotyped_records);
+    } catch (...) {
+      errors.at(segment) = std::current_exception();
+    }
+  }
+}
+}  // namespace
+
+Fastas get_personalised_ref(covG_ptr graph_root,
+                            gt_sites const& genotyped_records,
+                            SegmentTracker& tracker) {
+  auto ploidy = get_ploidy(genotyped_records);
+  auto num_segments = tracker.num_segments();
+  Fastas p_refs(num_segments * ploidy);
+
+  auto const segments = split_into_segments(graph_root, genotyped_records,
+                                            tracker, p_refs, ploidy);
+
+  // Segments are built as tasks, so that this can run within an enclosing
+  // parallel region (e.g. alongside other outputs) and still use idle threads.
+  // There, only the one calling thread generates them.
+  std::vector<std::exception_ptr> errors(num_segments);
+  if (omp_in_parallel())
+    build_segments(p_refs, ploidy, segments, genotyped_records, errors);
+  else {
+#pragma omp parallel
+#pragma omp single
+    build_segments(p_refs, ploidy, segments, genotyped_records, errors);
+  }
+  for (auto const& error : errors)
+    if (error) std::rethrow_exception(error);
 
   return p_refs;
 }
@@ -121,6 +208,10 @@ bool operator<(const Fasta& first, const Fasta& second) {
   return first.sequence < second.sequence;
 }
 
+bool operator==(const Fasta& first, const Fasta& second) {
+  return first.sequence == second.sequence;
+}
+
 std::ostream& operator<<(std::ostream& out_stream, const Fasta& input) {
   out_stream << '>' << input.ID << " " << input.desc;
   if (input.desc.back() != '\n') {
@@ -140,6 +231,27 @@ std::ostream& operator<<(std::ostream& out_stream, const Fasta& input) {
   return out_stream;
 }
 
+void write_deduped_p_refs(Fastas const& p_refs, std::string const& fpath) {
+  // Sorted as a `unique_Fastas` would be, keeping the first of equal
+  // sequences, but through pointers so that sequences are not copied
+  std::vector<Fasta const*> sorted_p_refs;
+  sorted_p_refs.reserve(p_refs.size());
+  for (auto const& p_ref : p_refs) sorted_p_refs.push_back(&p_ref);
+  std::stable_sort(sorted_p_refs.begin(), sorted_p_refs.end(),
+                   [](Fasta const* first, Fasta const* second) {
+                     return *first < *second;
+                   });
+
+  std::ofstream pers_ref_fhandle(fpath);
+  Fasta const* previous = nullptr;
+  for (auto const p_ref : sorted_p_refs) {
+    if (previous == nullptr || !(*previous == *p_ref))
+      pers_ref_fhandle << *p_ref << std::endl;
+    previous = p_ref;
+  }
+  pers_ref_fhandle.close();
+}
+
 void add_description(Fastas& p_refs, std::string const& desc) {
   int ref_number{1};
   for (auto& p_ref : p_refs) {
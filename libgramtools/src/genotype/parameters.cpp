@@ -2,7 +2,10 @@
 
 #include <omp.h>
 
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <unordered_set>
 
 using namespace gram;
 using namespace gram::commands::genotype;
@@ -47,18 +50,23 @@ GenotypeParams commands::genotype::parse_parameters(
   GenotypeParams parameters = {};
   std::vector<std::string> reads_fpaths;
   std::string run_dirpath;
+  std::string samples_fpath;
   ploidy_argument ploidy;
   Seed::value_type seed;
+  std::string numa_policy;
 
   po::options_description genotype_description("genotype options");
   genotype_description.add_options()(
       "gram_dir", po::value<std::string>(&parameters.gram_dirpath)->required(),
-      "gramtools directory")("reads",
-                             po::value<std::vector<std::string>>(&reads_fpaths)
-                                 ->multitoken()
-                                 ->required(),
-                             "file containing reads (FASTA or FASTQ)")(
-      "sample_id", po::value<std::string>(&parameters.sample_id)->required())(
+      "gramtools directory")(
+      "reads", po::value<std::vector<std::string>>(&reads_fpaths)->multitoken(),
+      "file containing reads (FASTA or FASTQ)")(
+      "sample_id", po::value<std::string>(&parameters.sample_id))(
+      "samples", po::value<std::string>(&samples_fpath),
+      "manifest of samples to genotype in one run, instead of --reads and "
+      "--sample_id. One sample per line: sample ID, then reads files, tab "
+      "separated. Each sample's outputs go in genotype_dir/<sample ID>. Not "
+      "offered by the python genotype command, which reports on one sample")(
       "ploidy", po::value<ploidy_argument>(&ploidy)->required(),
       "expected ploidy of the sample. Choices: {haploid, diploid}")(
       "kmer_size", po::value<uint32_t>(&parameters.kmers_size)->required(),
@@ -69,7 +77,46 @@ GenotypeParams commands::genotype::parse_parameters(
                           "maximum number of threads used")(
       "seed", po::value<SeedSize>(&seed),
       "seed for pseudo-random selection of multi-mapping reads. "
-      "a random seed is generated if this option is not used.");
+      "a random seed is generated if this option is not used.")(
+      "read_cache_size",
+      po::value<uint64_t>(&parameters.read_cache_size)->default_value(0),
+      "maximum number of distinct reads whose mapping is cached, so that "
+      "duplicate reads are only searched once. 0 disables the cache.")(
+      "numa", po::value<std::string>(&numa_policy)->default_value("none"),
+      "placement of the PRG and kmer indices on multi-socket (NUMA) machines. "
+      "Choices: {none, interleave (spread their memory over the nodes), "
+      "replicate (copy them to each node)}. Mapping threads are then pinned "
+      "to nodes.")(
+      "huge_pages",
+      po::bool_switch(&parameters.huge_pages)->default_value(false),
+      "back the PRG indices with 2 MB transparent huge pages, for fewer TLB "
+      "misses in read mapping")(
+      "paired", po::bool_switch(&parameters.paired)->default_value(false),
+      "reads are paired-end: reads files are given as consecutive mate 1 and "
+      "mate 2 files, whose mates are mapped jointly")(
+      "max_insert_size",
+      po::value<uint64_t>(&parameters.max_insert_size)->default_value(1000),
+      "in paired mode, the maximum distance between the mapping positions of "
+      "two mates in the prg")(
+      "subsample_fraction",
+      po::value<double>(&parameters.subsample_fraction)->default_value(1),
+      "map only this fraction of the reads (or pairs), chosen at random "
+      "using the seed")(
+      "max_mean_depth",
+      po::value<double>(&parameters.max_mean_depth)->default_value(0),
+      "stop mapping reads once the mean depth of coverage of the sites, "
+      "estimated as reads are mapped, reaches this. 0 maps all reads.")(
+      "read_mappings",
+      po::bool_switch(&parameters.write_read_mappings)->default_value(false),
+      "write where each read mapped to coverage/read_mappings.tsv")(
+      "coverage_json",
+      po::bool_switch(&parameters.coverage_json)->default_value(false),
+      "also write coverage in text and JSON formats, next to the binary "
+      "coverage/coverage.bin")(
+      "from_coverage",
+      po::bool_switch(&parameters.from_coverage)->default_value(false),
+      "genotype from the coverage saved in genotype_dir by a previous run, "
+      "without mapping reads. --reads is then not used.");
 
   std::vector<std::string> opts =
       po::collect_unrecognized(parsed.options, po::include_positional);
@@ -79,6 +126,26 @@ GenotypeParams commands::genotype::parse_parameters(
     po::store(po::command_line_parser(opts).options(genotype_description).run(),
               vm);
     po::notify(vm);
+    bool const batch_mode = vm.count("samples") > 0;
+    if (batch_mode && (vm.count("reads") || vm.count("sample_id")))
+      throw std::invalid_argument(
+          "--samples cannot be used with --reads or --sample_id");
+    if (parameters.from_coverage && vm.count("reads"))
+      throw std::invalid_argument(
+          "--from_coverage cannot be used with --reads");
+    bool const has_reads = vm.count("reads") || parameters.from_coverage;
+    if (!batch_mode && !(has_reads && vm.count("sample_id")))
+      throw std::invalid_argument(
+          "--reads and --sample_id are required unless --samples is used");
+    if (parameters.paired && reads_fpaths.size() % 2 != 0)
+      throw std::invalid_argument(
+          "--paired requires an even number of --reads files");
+    if (!(parameters.subsample_fraction > 0 &&
+          parameters.subsample_fraction <= 1))
+      throw std::invalid_argument("--subsample_fraction must be in (0, 1]");
+    if (parameters.max_mean_depth < 0)
+      throw std::invalid_argument("--max_mean_depth cannot be negative");
+    parameters.numa_policy = parse_numa_policy(numa_policy);
   } catch (const std::exception& e) {
     std::cout << e.what() << std::endl;
     std::cout << genotype_description << std::endl;
@@ -86,11 +153,91 @@ GenotypeParams commands::genotype::parse_parameters(
   }
 
   fill_common_parameters(parameters, parameters.gram_dirpath);
-  for (auto& elem : reads_fpaths) elem = fs::absolute(fs::path(elem)).string();
-  parameters.reads_fpaths = reads_fpaths;
-
   parameters.ploidy = ploidy.get();
+  parameters.genotype_dirpath = fs::absolute(fs::path(run_dirpath)).string();
+  parameters.instrumentation_fpath =
+      full_path(parameters.genotype_dirpath, "instrumentation.json");
+
+  if (vm.count("samples")) {
+    std::ifstream manifest(samples_fpath);
+    if (!manifest.is_open()) {
+      std::cout << "Cannot open samples manifest " << samples_fpath
+                << std::endl;
+      exit(1);
+    }
+    try {
+      parameters.samples =
+          parse_samples_manifest(manifest, !parameters.from_coverage);
+    } catch (const std::invalid_argument& e) {
+      std::cout << "Invalid samples manifest " << samples_fpath << ": "
+                << e.what() << std::endl;
+      exit(1);
+    }
+    if (parameters.samples.empty()) {
+      std::cout << "No samples in manifest " << samples_fpath << std::endl;
+      exit(1);
+    }
+    for (auto const& sample : parameters.samples) {
+      if (parameters.paired && sample.reads_fpaths.size() % 2 != 0) {
+        std::cout << "Invalid samples manifest " << samples_fpath
+                  << ": with --paired, sample " << sample.sample_id
+                  << " needs an even number of reads files" << std::endl;
+        exit(1);
+      }
+    }
+  } else {
+    for (auto& elem : reads_fpaths)
+      elem = fs::absolute(fs::path(elem)).string();
+    parameters.reads_fpaths = reads_fpaths;
+    set_sample_output_paths(parameters, run_dirpath);
+  }
+
+  parameters.maximum_threads = vm["max_threads"].as<uint32_t>();
+  omp_set_num_threads(parameters.maximum_threads);
+
+  if (vm.count("seed")) parameters.seed = seed;
+  return parameters;
+}
+
+GenotypeSamples commands::genotype::parse_samples_manifest(
+    std::istream& manifest, bool reads_required) {
+  GenotypeSamples samples;
+  std::unordered_set<std::string> seen_ids;
+  std::string line;
+  std::size_t line_num{0};
+  while (std::getline(manifest, line)) {
+    ++line_num;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.empty() || line[0] == '#') continue;
 
+    std::istringstream fields(line);
+    std::string field;
+    GenotypeSample sample;
+    std::getline(fields, sample.sample_id, '\t');
+    while (std::getline(fields, field, '\t')) {
+      if (field.empty()) continue;
+      sample.reads_fpaths.push_back(fs::absolute(fs::path(field)).string());
+    }
+
+    if (sample.sample_id.empty() ||
+        (reads_required && sample.reads_fpaths.empty()))
+      throw std::invalid_argument(
+          "line " + std::to_string(line_num) +
+          " does not have a sample ID followed by reads files");
+    // Each sample's outputs go in a directory named after it
+    if (sample.sample_id.find('/') != std::string::npos ||
+        sample.sample_id == "." || sample.sample_id == "..")
+      throw std::invalid_argument("sample ID " + sample.sample_id +
+                                  " cannot be used as a directory name");
+    if (!seen_ids.insert(sample.sample_id).second)
+      throw std::invalid_argument("duplicate sample ID " + sample.sample_id);
+    samples.push_back(std::move(sample));
+  }
+  return samples;
+}
+
+void commands::genotype::set_sample_output_paths(
+    GenotypeParams& parameters, std::string const& run_dirpath) {
   std::string cov_dirpath = mkdir(run_dirpath, "coverage");
   std::string geno_dirpath = mkdir(run_dirpath, "genotype");
   parameters.read_stats_fpath = full_path(run_dirpath, "read_stats.json");
@@ -103,15 +250,23 @@ GenotypeParams commands::genotype::parse_parameters(
       full_path(cov_dirpath, "allele_base_coverage.json");
   parameters.grouped_allele_counts_fpath =
       full_path(cov_dirpath, "grouped_allele_counts_coverage.json");
+  parameters.coverage_snapshot_fpath = full_path(cov_dirpath, "coverage.bin");
+  parameters.read_mappings_fpath = full_path(cov_dirpath, "read_mappings.tsv");
 
   parameters.genotyped_json_fpath = full_path(geno_dirpath, "genotyped.json");
   parameters.genotyped_vcf_fpath = full_path(geno_dirpath, "genotyped.vcf.gz");
   parameters.personalised_ref_fpath =
       full_path(geno_dirpath, "personalised_reference.fasta");
+}
 
-  parameters.maximum_threads = vm["max_threads"].as<uint32_t>();
-  omp_set_num_threads(parameters.maximum_threads);
-
-  if (vm.count("seed")) parameters.seed = seed;
-  return parameters;
-}
\ No newline at end of file
+GenotypeParams commands::genotype::make_sample_parameters(
+    GenotypeParams const& parameters, GenotypeSample const& sample) {
+  GenotypeParams sample_parameters = parameters;
+  sample_parameters.samples.clear();
+  sample_parameters.sample_id = sample.sample_id;
+  sample_parameters.reads_fpaths = sample.reads_fpaths;
+  std::string sample_dirpath =
+      mkdir(parameters.genotype_dirpath, sample.sample_id);
+  set_sample_output_paths(sample_parameters, sample_dirpath);
+  return sample_parameters;
+}
@@ -2,6 +2,7 @@
 #include <fstream>
 #include <vector>
 
+#include "common/instrumentation.hpp"
 #include "genotype/quasimap/coverage/allele_base.hpp"
 
 using namespace gram;
@@ -38,72 +39,49 @@ SitesAlleleBaseCoverage gram::coverage::generate::allele_base_non_nested(
 }
 
 void coverage::record::allele_base(PRG_Info const &prg_info,
-                                   const SearchStates &search_states,
+                                   SearchStateRefs const &search_states,
                                    const uint64_t &read_length) {
   PbCovRecorder record_it{prg_info, search_states, read_length};
 }
 
-/**
- * String serialise the base coverages for one allele.
- */
-std::string dump_allele(const PerBaseCoverage &allele) {
-  std::stringstream stream;
-  stream << "[";
-  auto i = 0;
-  for (const auto &base_coverage : allele) {
-    stream << (int)base_coverage;
-    if (i++ < allele.size() - 1) stream << ",";
-  }
-  stream << "]";
-  return stream.str();
-}
-
-/**
- * String serialise the alleles of a site.
- * @see dump_allele()
- */
-std::string dump_site(const SitePbCoverage &site) {
-  std::stringstream stream;
-  auto i = 0;
-  for (const auto &allele : site) {
-    stream << dump_allele(allele);
-    if (i++ < site.size() - 1) stream << ",";
-  }
-  return stream.str();
-}
-
-/**
- * String serialise all base-level coverages for all sites of the prg.
- * @see dump_site()
- */
-std::string dump_sites(const SitesAlleleBaseCoverage &sites) {
-  std::stringstream stream;
-  auto i = 0;
+void gram::dump_allele_base_coverage(std::ostream &out,
+                                     const SitesAlleleBaseCoverage &sites) {
+  out << "{\"allele_base_counts\":[";
+  bool first_site{true};
   for (const auto &site : sites) {
-    stream << "[";
-    stream << dump_site(site);
-    stream << "]";
-    if (i++ < sites.size() - 1) stream << ",";
+    if (!first_site) out << ",";
+    first_site = false;
+    out << "[";
+    bool first_allele{true};
+    for (const auto &allele : site) {
+      if (!first_allele) out << ",";
+      first_allele = false;
+      out << "[";
+      bool first_base{true};
+      for (const auto &base_coverage : allele) {
+        if (!first_base) out << ",";
+        first_base = false;
+        out << base_coverage;
+      }
+      out << "]";
+    }
+    out << "]";
   }
-  return stream.str();
+  out << "]}";
 }
 
 std::string gram::dump_allele_base_coverage(
     const SitesAlleleBaseCoverage &sites) {
   std::stringstream stream;
-  stream << "{\"allele_base_counts\":[";
-  stream << dump_sites(sites);
-  stream << "]}";
+  dump_allele_base_coverage(stream, sites);
   return stream.str();
 }
 
 void coverage::dump::allele_base(const Coverage &coverage,
                                  const GenotypeParams &parameters) {
-  std::string json_string =
-      dump_allele_base_coverage(coverage.allele_base_coverage);
-  std::ofstream file;
-  file.open(parameters.allele_base_coverage_fpath);
-  file << json_string << std::endl;
+  std::ofstream file(parameters.allele_base_coverage_fpath);
+  dump_allele_base_coverage(file, coverage.allele_base_coverage);
+  file << std::endl;
 }
 
 DummyCovNode::DummyCovNode(node_coordinate start_pos, node_coordinate end_pos,
@@ -227,6 +205,15 @@ PbCovRecorder::PbCovRecorder(const PRG_Info &prg_info,
   write_coverage_from_dummy_nodes();
 }
 
+PbCovRecorder::PbCovRecorder(const PRG_Info &prg_info,
+                             SearchStateRefs const &search_states,
+                             std::size_t read_size)
+    : prg_info(&prg_info), read_size(read_size) {
+  for (auto const &search_state : search_states)
+    process_SearchState(*search_state);
+  write_coverage_from_dummy_nodes();
+}
+
 void PbCovRecorder::write_coverage_from_dummy_nodes() {
   covG_ptr cov_node;
   node_coordinates to_increment;
@@ -246,6 +233,8 @@ void PbCovRecorder::write_coverage_from_dummy_nodes() {
 void PbCovRecorder::process_SearchState(SearchState const &ss) {
   bool first{true};
   Traverser t;
+  instrumentation::count(instrumentation::Counter::sa_positions_located,
+                         ss.sa_interval.second - ss.sa_interval.first + 1);
 
   for (auto occurrence = ss.sa_interval.first;
        occurrence <= ss.sa_interval.second; occurrence++) {
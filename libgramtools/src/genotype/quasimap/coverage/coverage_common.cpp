@@ -1,5 +1,8 @@
 #include "genotype/quasimap/coverage/coverage_common.hpp"
 
+#include <algorithm>
+
+#include "common/instrumentation.hpp"
 #include "common/random.hpp"
 #include "genotype/quasimap/coverage/allele_base.hpp"
 #include "genotype/quasimap/coverage/allele_sum.hpp"
@@ -7,28 +10,25 @@
 
 using namespace gram;
 
-LocusFinder::LocusFinder(SearchState const search_state, info_ptr prg_info)
-    : search_state(search_state), prg_info(prg_info) {
-  check_site_uniqueness();
-  assign_traversing_loci();
-  assign_traversed_loci();
+LocusFinder::LocusFinder(SearchState const &search_state, info_ptr prg_info) {
+  check_site_uniqueness(search_state);
+  assign_traversing_loci(search_state, prg_info);
+  assign_traversed_loci(search_state, prg_info);
 }
 
 void LocusFinder::check_site_uniqueness(SearchState const &search_state) {
-  auto all_loci = search_state.traversed_path;
-  all_loci.insert(all_loci.end(), search_state.traversing_path.begin(),
-                  search_state.traversing_path.end());
   SitePath unique_sites;
-  for (auto const &entry : all_loci) {
-    Marker site = entry.first;
-    if (unique_sites.find(site) != unique_sites.end()) {
-      throw std::logic_error(
-          "ERROR: A site cannot have been traversed more than once by a read, "
-          "but this one is marked as such.\n");
+  auto const check_path = [&unique_sites](VariantSitePath const &path) {
+    for (auto const &entry : path) {
+      if (!unique_sites.insert(entry.first)) {
+        throw std::logic_error(
+            "ERROR: A site cannot have been traversed more than once by a "
+            "read, but this one is marked as such.\n");
+      }
     }
-    unique_sites.insert(site);
-  }
-  return;
+  };
+  check_path(search_state.traversed_path);
+  check_path(search_state.traversing_path);
 }
 
 void LocusFinder::assign_nested_locus(VariantLocus const &var_loc,
@@ -37,8 +37,7 @@ void LocusFinder::assign_nested_locus(VariantLocus const &var_loc,
   VariantLocus cur_locus = var_loc;
   Marker &cur_marker = cur_locus.first;
   while (true) {
-    if (used_sites.find(cur_marker) != used_sites.end()) break;
-    used_sites.insert(cur_marker);
+    if (!used_sites.insert(cur_marker)) break;
     unique_loci.insert(cur_locus);
 
     if (par_map.find(cur_marker) == par_map.end()) {
@@ -58,6 +57,9 @@ void LocusFinder::assign_traversing_loci(SearchState const &search_state,
   assert(r->second == ALLELE_UNKNOWN);
 
   VariantLocus new_locus;
+  instrumentation::count(
+      instrumentation::Counter::sa_positions_located,
+      search_state.sa_interval.second - search_state.sa_interval.first + 1);
   // Assign the currently traversed alleles
   for (int i = search_state.sa_interval.first;
        i <= search_state.sa_interval.second; ++i) {
@@ -83,20 +85,20 @@ void LocusFinder::assign_traversed_loci(SearchState const &search_state,
 }
 
 MappingInstanceSelector::MappingInstanceSelector(
-    SearchStates const search_states, info_ptr prg_info,
+    SearchStates const &search_states, info_ptr prg_info,
     rand_ptr rand_generator)
-    : input_search_states(search_states),
-      usps(),
+    : usps(),
+      input_search_states(&search_states),
       prg_info(prg_info),
       rand_generator(rand_generator) {
-  process_searchstates(input_search_states);
+  process_searchstates(search_states);
   int32_t selected_index = random_select_entry();
   if (selected_index >= 0) apply_selection(selected_index);
 }
 
 int32_t MappingInstanceSelector::random_select_entry() {
   if (usps.size() == 0) return -1;
-  uint32_t nonvariant_count = count_nonvar_search_states(input_search_states);
+  uint32_t nonvariant_count = count_nonvar_search_states(*input_search_states);
   uint32_t count_total_options = nonvariant_count + usps.size();
 
   auto selected_option = rand_generator->generate(1, count_total_options);
@@ -107,28 +109,33 @@ int32_t MappingInstanceSelector::random_select_entry() {
 }
 
 void MappingInstanceSelector::apply_selection(int32_t selected_index) {
-  auto it = usps.begin();
-  std::advance(it, selected_index);
-  auto chosen_traversal = it->second;
-  selected = SelectedMapping{chosen_traversal.first, chosen_traversal.second};
+  auto &chosen_class = usps[selected_index];
+  selected.navigational_search_states = std::move(chosen_class.search_states);
+  selected.equivalence_class_loci = std::move(chosen_class.loci);
 }
 
-void MappingInstanceSelector::add_searchstate(SearchState const &ss) {
-  LocusFinder l{ss, prg_info};
-  // Create or retrieve the coverage information
-  auto &cov_info = usps[l.base_sites];
+void MappingInstanceSelector::add_searchstate(
+    SearchStates::const_iterator ss) {
+  LocusFinder l{*ss, prg_info};
+  // Create or retrieve the equivalence class, keeping `usps` sorted
+  auto position = std::lower_bound(
+      usps.begin(), usps.end(), l.base_sites,
+      [](EquivalenceClass const &entry, level0_Sites const &sites) {
+        return entry.sites < sites;
+      });
+  if (position == usps.end() || position->sites != l.base_sites)
+    position = usps.insert(position, EquivalenceClass{l.base_sites, {}, {}});
 
   // Merge each `VariantLocus` into the existing set of unique `VariantLocus`
-  for (auto &locus : l.unique_loci) cov_info.second.insert(locus);
+  for (auto const &locus : l.unique_loci) position->loci.insert(locus);
 
-  // Add the `SearchState` to the list of `SearchStates` compatible with the
-  // `base_sites`
-  cov_info.first.push_back(ss);
+  // Add the `SearchState` to those compatible with the `base_sites`
+  position->search_states.push_back(ss);
 }
 
 void MappingInstanceSelector::process_searchstates(SearchStates const &all_ss) {
-  for (auto const &ss : all_ss) {
-    if (ss.has_path()) add_searchstate(ss);
+  for (auto ss = all_ss.begin(); ss != all_ss.end(); ++ss) {
+    if (ss->has_path()) add_searchstate(ss);
   }
 }
 
@@ -165,8 +172,8 @@ uint32_t MappingInstanceSelector::count_nonvar_search_states(
  */
 SelectedMapping selection(const SearchStates &search_states,
                           const uint64_t &read_length, const PRG_Info &prg_info,
-                          SeedSize const &selection_seed) {
-  RandomInclusiveInt selector{Seed{selection_seed}};
+                          SelectionKey const selection_key) {
+  CounterRandomInt selector{selection_key};
   MappingInstanceSelector m{search_states, &prg_info, &selector};
 
   // This contains empty containers if we selected a mapping instance in an
@@ -176,17 +183,18 @@ SelectedMapping selection(const SearchStates &search_states,
   return selected;
 }
 
-void coverage::record::search_states(Coverage &coverage,
-                                     const SearchStates &search_states,
-                                     const uint64_t &read_length,
-                                     const PRG_Info &prg_info,
-                                     SeedSize const &selection_seed) {
+SelectedMapping coverage::record::search_states(
+    Coverage &coverage, const SearchStates &search_states,
+    const uint64_t &read_length, const PRG_Info &prg_info,
+    SelectionKey const selection_key) {
   SelectedMapping selected_search_states =
-      selection(search_states, read_length, prg_info, selection_seed);
+      selection(search_states, read_length, prg_info, selection_key);
 
   // If we selected a mapping instance that does not overlap any variant site,
   // there is no coverage to record.
-  if (selected_search_states.navigational_search_states.empty()) return;
+  if (selected_search_states.navigational_search_states.empty())
+    return selected_search_states;
+  instrumentation::count(instrumentation::Counter::coverage_records);
 
   coverage::record::allele_base(
       prg_info, selected_search_states.navigational_search_states, read_length);
@@ -194,6 +202,7 @@ void coverage::record::search_states(Coverage &coverage,
                                selected_search_states.equivalence_class_loci);
   coverage::record::grouped_allele_counts(
       coverage, selected_search_states.equivalence_class_loci);
+  return selected_search_states;
 }
 
 void coverage::dump::all(const Coverage &coverage,
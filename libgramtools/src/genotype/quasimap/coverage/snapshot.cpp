@@ -0,0 +1,283 @@
+#include "genotype/quasimap/coverage/snapshot.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+#include "genotype/quasimap/coverage/allele_base.hpp"
+#include "genotype/quasimap/coverage/allele_sum.hpp"
+
+using namespace gram;
+using namespace gram::coverage::snapshot;
+
+namespace {
+/** Above this many buffered bytes, the snapshot buffer is written out. */
+constexpr std::size_t flush_size{1 << 20};
+
+void put_varint(std::string& buf, uint64_t value) {
+  while (value >= 0x80) {
+    buf.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  buf.push_back(static_cast<char>(value));
+}
+
+void put_fixed(std::string& buf, uint64_t value, std::size_t num_bytes) {
+  for (std::size_t i{0}; i < num_bytes; i++)
+    buf.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+uint8_t get_byte(std::istream& in) {
+  auto const next = in.get();
+  if (next == std::char_traits<char>::eof())
+    throw CoverageSnapshotException("Truncated coverage snapshot");
+  return static_cast<uint8_t>(next);
+}
+
+uint64_t get_varint(std::istream& in) {
+  uint64_t result{0};
+  for (int shift{0}; shift < 64; shift += 7) {
+    auto const byte = get_byte(in);
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return result;
+  }
+  throw CoverageSnapshotException("Malformed varint in coverage snapshot");
+}
+
+uint64_t get_fixed(std::istream& in, std::size_t num_bytes) {
+  uint64_t result{0};
+  for (std::size_t i{0}; i < num_bytes; i++)
+    result |= static_cast<uint64_t>(get_byte(in)) << (8 * i);
+  return result;
+}
+
+bool get_magic(std::istream& in) {
+  char found_magic[sizeof(magic)];
+  return in.read(found_magic, sizeof(found_magic)) &&
+         std::equal(found_magic, found_magic + sizeof(found_magic), magic);
+}
+
+/**
+ * Reads a varint that must fit in `T`.
+ */
+template <typename T>
+T get_value(std::istream& in) {
+  auto const value = get_varint(in);
+  if (value > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+    throw CoverageSnapshotException("Out of range value in coverage snapshot");
+  return static_cast<T>(value);
+}
+
+/**
+ * Reads `num_values` varints. The values are read one at a time, so that a
+ * corrupt count cannot make us allocate more than the snapshot holds.
+ */
+template <typename T>
+std::vector<T> get_values(std::istream& in, uint64_t const num_values) {
+  std::vector<T> result;
+  for (uint64_t i = 0; i < num_values; ++i) result.push_back(get_value<T>(in));
+  return result;
+}
+
+void check_size(uint64_t const found, uint64_t const expected,
+                std::string const& what) {
+  if (found != expected)
+    throw CoverageSnapshotException(
+        "Coverage snapshot does not match the prg: it has " +
+        std::to_string(found) + " " + what + ", expected " +
+        std::to_string(expected));
+}
+
+/**
+ * For each variant site, the coverage graph nodes directly in it, in PRG
+ * order. Each node is reached through the access entry of its first character.
+ */
+std::vector<std::vector<covG_ptr>> site_nodes(
+    coverage_Graph const& coverage_graph, std::size_t const num_sites) {
+  std::vector<std::vector<covG_ptr>> result(num_sites);
+  for (auto const& entry : coverage_graph.random_access) {
+    if (entry.offset != 0 || entry.node == nullptr ||
+        entry.node->get_coverage_space() == 0)
+      continue;
+    auto const site_index = siteID_to_index(entry.node->get_site_ID());
+    if (site_index >= num_sites)
+      throw CoverageSnapshotException(
+          "Coverage graph node in site " +
+          std::to_string(entry.node->get_site_ID()) + ", but only " +
+          std::to_string(num_sites) + " sites have coverage");
+    result[site_index].push_back(entry.node);
+  }
+  return result;
+}
+
+void put_grouped_allele_counts(std::string& buf,
+                               GroupedAlleleCounts const& site) {
+  // Sorted, so that the same coverage always gives the same file
+  std::vector<GroupedAlleleCounts::value_type const*> groups;
+  groups.reserve(site.size());
+  for (auto const& group : site) groups.push_back(&group);
+  std::sort(groups.begin(), groups.end(),
+            [](auto const* lhs, auto const* rhs) {
+              return lhs->first < rhs->first;
+            });
+
+  put_varint(buf, groups.size());
+  for (auto const* group : groups) {
+    put_varint(buf, group->first.size());
+    for (auto const& allele_id : group->first) put_varint(buf, allele_id);
+    put_varint(buf, group->second);
+  }
+}
+}  // namespace
+
+void coverage::dump::snapshot(Coverage const& coverage,
+                              coverage_Graph const& coverage_graph,
+                              std::ostream& out) {
+  auto const num_sites = coverage.allele_sum_coverage.size();
+  check_size(coverage.grouped_allele_counts.size(), num_sites,
+             "grouped allele count sites");
+  auto const nodes = site_nodes(coverage_graph, num_sites);
+
+  std::string buf(magic, sizeof(magic));
+  put_fixed(buf, version, sizeof(version));
+  uint64_t bytes_written{0};
+  auto const flush = [&](bool const force) {
+    if (!force && buf.size() < flush_size) return;
+    out.write(buf.data(), buf.size());
+    bytes_written += buf.size();
+    buf.clear();
+  };
+
+  std::vector<uint64_t> site_offsets;
+  site_offsets.reserve(num_sites);
+  for (std::size_t site_index = 0; site_index < num_sites; ++site_index) {
+    site_offsets.push_back(bytes_written + buf.size());
+
+    auto const& allele_sums = coverage.allele_sum_coverage[site_index];
+    put_varint(buf, allele_sums.size());
+    for (auto const& allele_sum : allele_sums) put_varint(buf, allele_sum);
+
+    put_grouped_allele_counts(buf, coverage.grouped_allele_counts[site_index]);
+
+    put_varint(buf, nodes[site_index].size());
+    for (auto const& node : nodes[site_index]) {
+      auto const& node_coverage = node->get_coverage();
+      put_varint(buf, node_coverage.size());
+      for (auto const& base_coverage : node_coverage)
+        put_varint(buf, base_coverage);
+    }
+    flush(false);
+  }
+
+  auto const offsets_start = bytes_written + buf.size();
+  for (auto const& offset : site_offsets) {
+    put_fixed(buf, offset, sizeof(offset));
+    flush(false);
+  }
+  put_fixed(buf, num_sites, sizeof(uint64_t));
+  put_fixed(buf, offsets_start, sizeof(offsets_start));
+  buf.append(magic, sizeof(magic));
+  flush(true);
+  if (!out)
+    throw CoverageSnapshotException("Could not write coverage snapshot");
+}
+
+void coverage::dump::snapshot(Coverage const& coverage,
+                              PRG_Info const& prg_info,
+                              GenotypeParams const& parameters) {
+  std::ofstream out(parameters.coverage_snapshot_fpath, std::ios::binary);
+  if (!out.is_open())
+    throw CoverageSnapshotException("Cannot open " +
+                                    parameters.coverage_snapshot_fpath);
+  snapshot(coverage, prg_info.coverage_graph, out);
+}
+
+CoverageSnapshotReader::CoverageSnapshotReader(std::istream& in) : in(in) {
+  in.seekg(0);
+  if (!get_magic(in)) throw CoverageSnapshotException("Not a coverage snapshot");
+  auto const found_version = get_fixed(in, sizeof(version));
+  if (found_version != version)
+    throw CoverageSnapshotException("Unsupported coverage snapshot version " +
+                                    std::to_string(found_version));
+
+  in.seekg(-static_cast<std::streamoff>(footer_size), std::ios::end);
+  if (!in) throw CoverageSnapshotException("Truncated coverage snapshot");
+  num_sites = get_fixed(in, sizeof(num_sites));
+  offsets_start = get_fixed(in, sizeof(offsets_start));
+  if (!get_magic(in))
+    throw CoverageSnapshotException("Truncated coverage snapshot");
+}
+
+SiteCoverage CoverageSnapshotReader::get_site(std::size_t site_index) {
+  if (site_index >= num_sites)
+    throw CoverageSnapshotException("No site " + std::to_string(site_index) +
+                                    " in coverage snapshot");
+  in.clear();
+  in.seekg(offsets_start + site_index * sizeof(uint64_t));
+  auto const site_offset = get_fixed(in, sizeof(uint64_t));
+  in.seekg(site_offset);
+
+  SiteCoverage result;
+  result.allele_sums = get_values<CovCount>(in, get_varint(in));
+
+  auto const num_groups = get_varint(in);
+  for (uint64_t group = 0; group < num_groups; ++group) {
+    auto const group_size = get_varint(in);
+    if (group_size > result.allele_sums.size())
+      throw CoverageSnapshotException(
+          "Allele group larger than its site in coverage snapshot");
+    auto allele_ids = get_values<AlleleId>(in, group_size);
+    result.grouped_allele_counts[allele_ids] = get_value<CovCount>(in);
+  }
+
+  auto const num_nodes = get_varint(in);
+  for (uint64_t node = 0; node < num_nodes; ++node)
+    result.nodes_coverage.push_back(get_values<CovCount>(in, get_varint(in)));
+  return result;
+}
+
+Coverage coverage::load::snapshot(std::istream& in, PRG_Info const& prg_info) {
+  CoverageSnapshotReader reader(in);
+
+  Coverage coverage{};
+  coverage.allele_sum_coverage =
+      coverage::generate::allele_sum_structure(prg_info);
+  auto const num_sites = coverage.allele_sum_coverage.size();
+  check_size(reader.size(), num_sites, "variant sites");
+  coverage.grouped_allele_counts = SitesGroupedAlleleCounts(num_sites);
+  auto const nodes = site_nodes(prg_info.coverage_graph, num_sites);
+
+  for (std::size_t site_index = 0; site_index < num_sites; ++site_index) {
+    auto site = reader.get_site(site_index);
+
+    auto& allele_sums = coverage.allele_sum_coverage[site_index];
+    check_size(site.allele_sums.size(), allele_sums.size(),
+               "alleles in a site");
+    allele_sums = std::move(site.allele_sums);
+    coverage.grouped_allele_counts[site_index] =
+        std::move(site.grouped_allele_counts);
+
+    auto const& nodes_in_site = nodes[site_index];
+    check_size(site.nodes_coverage.size(), nodes_in_site.size(),
+               "nodes in a site");
+    for (std::size_t i = 0; i < nodes_in_site.size(); ++i) {
+      auto& node_coverage = nodes_in_site[i]->get_ref_to_coverage();
+      check_size(site.nodes_coverage[i].size(), node_coverage.size(),
+                 "bases in a node");
+      node_coverage = std::move(site.nodes_coverage[i]);
+    }
+  }
+
+  coverage.allele_base_coverage =
+      coverage::generate::allele_base_non_nested(prg_info);
+  return coverage;
+}
+
+Coverage coverage::load::snapshot(PRG_Info const& prg_info,
+                                  GenotypeParams const& parameters) {
+  std::ifstream in(parameters.coverage_snapshot_fpath, std::ios::binary);
+  if (!in.is_open())
+    throw CoverageSnapshotException("Cannot open " +
+                                    parameters.coverage_snapshot_fpath);
+  return snapshot(in, prg_info);
+}
@@ -0,0 +1,50 @@
+#include "genotype/quasimap/index_replicas.hpp"
+
+#include <exception>
+#include <iostream>
+#include <thread>
+
+using namespace gram;
+
+IndexReplicas::IndexReplicas(PRG_Info const &prg_info,
+                             KmerIndex const &kmer_index,
+                             NumaPolicy const policy, bool const huge_pages)
+    : original_prg_info(prg_info), original_kmer_index(kmer_index) {
+  auto const &nodes = numa_nodes();
+  if (policy != NumaPolicy::replicate || nodes.size() <= 1) return;
+
+  std::cout << "Replicating the indices on " << nodes.size() << " NUMA nodes"
+            << std::endl;
+  replicas.resize(nodes.size());
+  std::vector<std::exception_ptr> errors(nodes.size());
+  std::vector<std::thread> copiers;
+  for (std::size_t i = 0; i < nodes.size(); ++i)
+    copiers.emplace_back([&, i] {
+      try {
+        // Pages are allocated on the node of the thread first touching them
+        pin_current_thread(nodes[i]);
+        replicas[i] = std::make_unique<Replica>(prg_info, kmer_index);
+        if (huge_pages) back_with_huge_pages(replicas[i]->prg_info);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  for (auto &copier : copiers) copier.join();
+  for (auto const &error : errors)
+    if (error) std::rethrow_exception(error);
+}
+
+IndexReplicas::Replica const *IndexReplicas::local_replica() const {
+  if (replicas.empty()) return nullptr;
+  return replicas[current_numa_node_index()].get();
+}
+
+PRG_Info const &IndexReplicas::local_prg_info() const {
+  auto const replica = local_replica();
+  return replica ? replica->prg_info : original_prg_info;
+}
+
+KmerIndex const &IndexReplicas::local_kmer_index() const {
+  auto const replica = local_replica();
+  return replica ? replica->kmer_index : original_kmer_index;
+}
@@ -2,21 +2,29 @@
 
 #include <omp.h>
 
+#include <algorithm>
 #include <exception>
+#include <optional>
 #include <stdexcept>
 
+#include "common/instrumentation.hpp"
+#include "common/numa.hpp"
 #include "common/random.hpp"
 #include "genotype/quasimap/coverage/allele_base.hpp"
 #include "genotype/quasimap/coverage/coverage_common.hpp"
+#include "genotype/quasimap/coverage/snapshot.hpp"
+#include "genotype/quasimap/index_replicas.hpp"
+#include "genotype/quasimap/read_input.hpp"
+#include "genotype/quasimap/read_mappings.hpp"
 #include "genotype/quasimap/search/BWT_search.hpp"
 #include "genotype/quasimap/search/vBWT_jump.hpp"
 
 using namespace gram;
 
 QuasimapReadsStats gram::quasimap_reads(const GenotypeParams &parameters,
-                                        const KmerIndex &kmer_index,
-                                        const PRG_Info &prg_info,
+                                        IndexReplicas const &indices,
                                         ReadStats &readstats) {
+  auto const &prg_info = indices.prg_info();
   QuasimapReadsStats quasimap_stats{};
   std::cout << "Generating allele quasimap data structure" << std::endl;
   // The coverage structure records mapped allele counts (per site), aggregated
@@ -24,27 +32,72 @@ QuasimapReadsStats gram::quasimap_reads(const GenotypeParams &parameters,
   quasimap_stats.coverage = coverage::generate::empty_structure(prg_info);
   std::cout << "Done generating allele quasimap data structure" << std::endl;
 
-  // Produces seeds to initialise other random number generators used
-  // in multi-mapping read selection
-  auto master_seed_generator = RandomInclusiveInt(parameters.seed);
+  // Keys, with each read's index and strand, the random selection of
+  // multi-mapping reads' mapping instances
+  auto const master_seed =
+      RandomInclusiveInt(parameters.seed).get_seed().value();
 
   std::cout << "Master random seed for read selection: "
-            << std::to_string(master_seed_generator.get_seed().value())
-            << std::endl;
+            << std::to_string(master_seed) << std::endl;
   std::cout << "Maximum thread count: " << parameters.maximum_threads
             << std::endl;
 
+  std::optional<ReadMappingCache> read_cache;
+  if (parameters.read_cache_size > 0)
+    read_cache.emplace(parameters.read_cache_size);
+  auto *const read_cache_ptr = read_cache ? &read_cache.value() : nullptr;
+
+  std::optional<ReadMappingWriter> mapping_writer;
+  if (parameters.write_read_mappings) {
+    std::cout << "Writing read mappings to " << parameters.read_mappings_fpath
+              << std::endl;
+    mapping_writer.emplace(parameters.read_mappings_fpath,
+                           omp_get_max_threads());
+  }
+  auto *const mapping_writer_ptr =
+      mapping_writer ? &mapping_writer.value() : nullptr;
+
   std::cout << "Processing reads:" << std::endl;
 
+  instrumentation::begin_span("Map reads");
   // Execute quasimap for each read file provided
-  for (const auto &reads_fpath : parameters.reads_fpaths) {
-    handle_read_file(quasimap_stats, reads_fpath, parameters, kmer_index,
-                     prg_info, &master_seed_generator);
+  uint64_t read_index{0};
+  bool mapped_all_reads = true;
+  auto const &reads_fpaths = parameters.reads_fpaths;
+  if (parameters.paired) {
+    // Files are consecutive (mate 1, mate 2) pairs; `read_index` counts pairs
+    for (std::size_t i = 0; mapped_all_reads && i + 1 < reads_fpaths.size();
+         i += 2)
+      mapped_all_reads = handle_read_pair_files(
+          quasimap_stats, reads_fpaths[i], reads_fpaths[i + 1], parameters,
+          indices, master_seed, read_index, read_cache_ptr,
+          mapping_writer_ptr);
+  } else {
+    for (const auto &reads_fpath : reads_fpaths) {
+      mapped_all_reads = handle_read_file(
+          quasimap_stats, reads_fpath, parameters, indices, master_seed,
+          read_index, read_cache_ptr, mapping_writer_ptr);
+      if (!mapped_all_reads) break;
+    }
   }
-
+  if (!mapped_all_reads)
+    std::cout << "Stopped mapping reads: the sites' mean depth reached "
+              << parameters.max_mean_depth << std::endl;
+  if (mapping_writer) mapping_writer->close();
+  instrumentation::end_span();
+  if (read_cache)
+    std::cout << "Read mapping cache: " << read_cache->get_num_hits()
+              << " hits, " << read_cache->size() << " distinct reads cached"
+              << std::endl;
+
+  instrumentation::Span coverage_span("Process coverage");
   auto &coverage = quasimap_stats.coverage;
-  // Compute read mapping statistics (used in `infer` command). Can only be done
-  // after mapping!
+  // Compute read statistics (used in `infer` command) from the reads tallied by
+  // each thread, and from coverage, which can only be done after mapping!
+  ReadTally read_tally;
+  for (auto const &thread_tally : quasimap_stats.read_tallies)
+    read_tally.merge(thread_tally);
+  readstats.compute_read_stats(read_tally);
   readstats.compute_coverage_depth(coverage, prg_info.coverage_graph);
 
   // Extract non-nested per base coverage
@@ -52,27 +105,46 @@ QuasimapReadsStats gram::quasimap_reads(const GenotypeParams &parameters,
       coverage::generate::allele_base_non_nested(prg_info);
 
   // Write coverage results to disk
-  coverage::dump::all(coverage, parameters);
+  coverage::dump::snapshot(coverage, prg_info, parameters);
+  if (parameters.coverage_json) coverage::dump::all(coverage, parameters);
   return quasimap_stats;
 }
 
 /**
- * Emplace up to `max_set_size` reads into the reads buffer.
- * Returns a vector of `Pattern`s: a `Pattern` being a vector of `Base`s, which
- * are integer encoded. The encoding of DNA letters to integers also performed
- * in this function.
+ * Reports the number of reads mapped so far, each time at least 10000 more
+ * have been.
  */
-std::vector<Sequence> get_reads_buffer(SeqRead::SeqIterator &reads_it,
-                                       SeqRead &reads,
-                                       const uint64_t &max_set_size) {
-  std::vector<Sequence> reads_buffer;
-  while (reads_it != reads.end() and reads_buffer.size() < max_set_size) {
-    const auto *const raw_read = *reads_it;
-    auto read = encode_dna_bases(*raw_read);
-    reads_buffer.emplace_back(read);
-    ++reads_it;
+void report_progress(QuasimapReadsStats const &quasimap_stats,
+                     uint64_t &last_count_reported) {
+  uint64_t diff = quasimap_stats.all_reads_count - last_count_reported;
+  if (diff >= 10000) {
+    std::cout << quasimap_stats.all_reads_count << std::endl;
+    last_count_reported = quasimap_stats.all_reads_count;
   }
-  return reads_buffer;
+}
+
+/** Depth is only estimated when mapping can stop at a maximum depth */
+std::optional<DepthEstimator> make_depth_estimator(
+    const GenotypeParams &parameters, const PRG_Info &prg_info) {
+  if (parameters.max_mean_depth <= 0) return std::nullopt;
+  return DepthEstimator(prg_info);
+}
+
+/** Checked between batches of reads, once their coverage is all recorded */
+bool max_mean_depth_reached(
+    QuasimapReadsStats const &quasimap_stats, const GenotypeParams &parameters,
+    std::optional<DepthEstimator> const &depth_estimator) {
+  if (!depth_estimator) return false;
+  auto const mean_depth =
+      depth_estimator->mean_depth(quasimap_stats.coverage.allele_sum_coverage);
+  return mean_depth >= parameters.max_mean_depth;
+}
+
+/** Provides each mapping thread with a `ReadTally` */
+void prepare_read_tallies(QuasimapReadsStats &quasimap_stats) {
+  auto &read_tallies = quasimap_stats.read_tallies;
+  std::size_t const num_threads = omp_get_max_threads();
+  if (read_tallies.size() < num_threads) read_tallies.resize(num_threads);
 }
 
 /**
@@ -80,117 +152,544 @@ std::vector<Sequence> get_reads_buffer(SeqRead::SeqIterator &reads_it,
  * in parallel (if the CL option has been specified).
  */
 void handle_reads_buffer(QuasimapReadsStats &quasimap_stats,
-                         const std::vector<Sequence> &reads_buffer,
-                         Seeds const &selection_seeds,
+                         ReadBatch const &reads_buffer,
+                         SeedSize const master_seed,
+                         uint64_t const first_read_index,
                          const GenotypeParams &parameters,
-                         const KmerIndex &kmer_index,
-                         const PRG_Info &prg_info) {
+                         IndexReplicas const &indices,
+                         ReadMappingCache *const read_cache,
+                         ReadMappingWriter *const mapping_writer) {
   uint64_t last_count_reported = 0;
 
 #pragma omp parallel for
   for (std::size_t i = 0; i < reads_buffer.size(); ++i) {
     auto thread_id = omp_get_thread_num();
-    //  Report total number of mapped reads everytime at least `diff` such have
-    //  been mapped
-    if (thread_id == 0) {
-      uint64_t diff = quasimap_stats.all_reads_count - last_count_reported;
-      if (diff >= 10000) {
-        std::cout << quasimap_stats.all_reads_count << std::endl;
-        last_count_reported = quasimap_stats.all_reads_count;
-      }
-    }
+    if (thread_id == 0) report_progress(quasimap_stats, last_count_reported);
 
 //  atomic: for manipulating a static variable (shared among the threads)
 #pragma omp atomic
     quasimap_stats.all_reads_count +=
         2;  //  Increment by 2: mapping forward and reverse of read
 
-    auto const read = reads_buffer.at(i);
+    if (!read_is_subsampled(master_seed, first_read_index + i,
+                            parameters.subsample_fraction)) {
+#pragma omp atomic
+      quasimap_stats.subsampled_out_reads_count += 2;
+      continue;
+    }
+
+    auto const read = reads_buffer.read(i);
+    quasimap_stats.read_tallies[thread_id].add_read(
+        reads_buffer.length(i), read, reads_buffer.qualities(i));
     if (read.empty()) {
 #pragma omp atomic
       quasimap_stats.skipped_reads_count += 2;
       continue;
     }
-    auto const selection_seed = selection_seeds.at(i);
-    quasimap_forward_reverse(quasimap_stats, read, parameters, kmer_index,
-                             prg_info, selection_seed);
+    auto const read_name = reads_buffer.name(i);
+    quasimap_forward_reverse(quasimap_stats, read, parameters,
+                             indices.local_kmer_index(),
+                             indices.local_prg_info(), master_seed,
+                             first_read_index + i, read_cache, read_name,
+                             mapping_writer);
   }
 }
 
-void gram::handle_read_file(QuasimapReadsStats &quasimap_stats,
+bool gram::handle_read_file(QuasimapReadsStats &quasimap_stats,
                             const std::string &reads_fpath,
                             const GenotypeParams &parameters,
-                            const KmerIndex &kmer_index,
-                            const PRG_Info &prg_info,
-                            RandomGenerator *const seed_generator) {
+                            IndexReplicas const &indices,
+                            SeedSize const master_seed, uint64_t &read_index,
+                            ReadMappingCache *const read_cache,
+                            ReadMappingWriter *const mapping_writer) {
   //  Number of reads to load in memory; is upper limit of number of reads that
   //  can be mapped in parallel
-  uint64_t max_num_reads = 5000;
-  // Used for random selection of multi-mapping reads
-  Seeds selection_seeds(max_num_reads);
-
-  SeqRead reads(reads_fpath.c_str());
-  auto reads_it = reads.begin();
-  while (reads_it != reads.end()) {
-    auto reads_buffer = get_reads_buffer(reads_it, reads, max_num_reads);
-    for (int i = 0; i < max_num_reads; i++)
-      selection_seeds.at(i) = (*seed_generator)();
-    handle_reads_buffer(quasimap_stats, reads_buffer, selection_seeds,
-                        parameters, kmer_index, prg_info);
+  uint64_t const max_num_reads = parameters.read_batch_size;
+  prepare_read_tallies(quasimap_stats);
+  auto const depth_estimator =
+      make_depth_estimator(parameters, indices.prg_info());
+
+  // Decompression runs in other threads, concurrently with mapping. They are
+  // started unpinned, so as not to share the CPUs of pinned mapping thread 0
+  std::optional<ScopedUnpinned> unpinned{std::in_place};
+  ReadFileReader reads(reads_fpath, parameters.maximum_threads);
+  unpinned.reset();
+  // Reads are parsed straight into the buffer's contiguous storage, which is
+  // reused by each batch
+  ReadBatch reads_buffer;
+  while (reads.next_batch(reads_buffer, max_num_reads)) {
+    handle_reads_buffer(quasimap_stats, reads_buffer, master_seed, read_index,
+                        parameters, indices, read_cache, mapping_writer);
+    read_index += reads_buffer.size();
+    if (max_mean_depth_reached(quasimap_stats, parameters, depth_estimator))
+      return false;
+  }
+  return true;
+}
+
+/**
+ * As `handle_reads_buffer`, for the pairs of mates at the same index in
+ * `mates1` and `mates2`.
+ */
+void handle_pairs_buffer(QuasimapReadsStats &quasimap_stats,
+                         ReadBatch const &mates1, ReadBatch const &mates2,
+                         SeedSize const master_seed,
+                         uint64_t const first_pair_index,
+                         const GenotypeParams &parameters,
+                         IndexReplicas const &indices,
+                         ReadMappingCache *const read_cache,
+                         ReadMappingWriter *const mapping_writer) {
+  uint64_t last_count_reported = 0;
+
+#pragma omp parallel for
+  for (std::size_t i = 0; i < mates1.size(); ++i) {
+    auto thread_id = omp_get_thread_num();
+    if (thread_id == 0) report_progress(quasimap_stats, last_count_reported);
+
+#pragma omp atomic
+    quasimap_stats.all_reads_count += 4;  //  Both mates, forward and reverse
+
+    if (!read_is_subsampled(master_seed, first_pair_index + i,
+                            parameters.subsample_fraction)) {
+#pragma omp atomic
+      quasimap_stats.subsampled_out_reads_count += 4;
+      continue;
+    }
+
+    auto const mate1 = mates1.read(i);
+    auto const mate2 = mates2.read(i);
+    auto &read_tally = quasimap_stats.read_tallies[thread_id];
+    read_tally.add_read(mates1.length(i), mate1, mates1.qualities(i));
+    read_tally.add_read(mates2.length(i), mate2, mates2.qualities(i));
+    if (mate1.empty() || mate2.empty()) {
+      // A pair cannot map without both its mates
+      uint64_t const num_skipped = 2 * (mate1.empty() + mate2.empty());
+#pragma omp atomic
+      quasimap_stats.skipped_reads_count += num_skipped;
+#pragma omp atomic
+      quasimap_stats.unpaired_reads_count += 4 - num_skipped;
+      continue;
+    }
+    quasimap_pair(quasimap_stats, mate1, mate2, parameters,
+                  indices.local_kmer_index(), indices.local_prg_info(),
+                  master_seed, first_pair_index + i, read_cache,
+                  mates1.name(i), mates2.name(i), mapping_writer);
   }
 }
 
+bool gram::handle_read_pair_files(QuasimapReadsStats &quasimap_stats,
+                                  const std::string &mate1_fpath,
+                                  const std::string &mate2_fpath,
+                                  const GenotypeParams &parameters,
+                                  IndexReplicas const &indices,
+                                  SeedSize const master_seed,
+                                  uint64_t &pair_index,
+                                  ReadMappingCache *const read_cache,
+                                  ReadMappingWriter *const mapping_writer) {
+  //  Holds as many reads as `handle_read_file`'s buffer, over both files
+  uint64_t const max_num_pairs =
+      std::max<uint64_t>(parameters.read_batch_size / 2, 1);
+  prepare_read_tallies(quasimap_stats);
+  auto const depth_estimator =
+      make_depth_estimator(parameters, indices.prg_info());
+
+  // As in `handle_read_file`, decompression threads are started unpinned.
+  // The two files share the thread budget.
+  std::optional<ScopedUnpinned> unpinned{std::in_place};
+  int const num_threads = static_cast<int>(parameters.maximum_threads);
+  ReadFileReader mate1_reads(mate1_fpath, std::max((num_threads + 1) / 2, 1));
+  ReadFileReader mate2_reads(mate2_fpath, std::max(num_threads / 2, 1));
+  unpinned.reset();
+  ReadBatch mates1, mates2;
+  while (true) {
+    bool const has_pairs = mate1_reads.next_batch(mates1, max_num_pairs);
+    mate2_reads.next_batch(mates2, max_num_pairs);
+    if (mates1.size() != mates2.size())
+      throw std::runtime_error("Paired reads files " + mate1_fpath + " and " +
+                               mate2_fpath +
+                               " have different numbers of reads");
+    if (!has_pairs) break;
+    handle_pairs_buffer(quasimap_stats, mates1, mates2, master_seed,
+                        pair_index, parameters, indices, read_cache,
+                        mapping_writer);
+    pair_index += mates1.size();
+    if (max_mean_depth_reached(quasimap_stats, parameters, depth_estimator))
+      return false;
+  }
+  return true;
+}
+
 void gram::quasimap_forward_reverse(QuasimapReadsStats &quasimap_stats,
-                                    const Sequence &read,
+                                    ReadView const &read,
                                     const GenotypeParams &parameters,
                                     const KmerIndex &kmer_index,
                                     const PRG_Info &prg_info,
-                                    SeedSize const &selection_seed) {
+                                    SeedSize const master_seed,
+                                    uint64_t const read_index,
+                                    ReadMappingCache *const read_cache,
+                                    std::string_view const read_name,
+                                    ReadMappingWriter *const mapping_writer) {
+  ReadView const &forward_read = read;
   // Forward mapping
-  quasimap_read(read, quasimap_stats.coverage, kmer_index, prg_info, parameters,
-                quasimap_stats, selection_seed);
+  auto const forward_mapping = quasimap_read(
+      forward_read, quasimap_stats.coverage, kmer_index, prg_info, parameters,
+      quasimap_stats, read_selection_key(master_seed, read_index, false),
+      read_cache);
+
+  // Reverse mapping, of the reverse complement materialised once rather than
+  // complemented at each base access
+  thread_local Sequence reverse_bases;
+  forward_read.reverse_complement().copy(0, forward_read.size(), reverse_bases);
+  auto const reverse_mapping = quasimap_read(
+      ReadView(reverse_bases), quasimap_stats.coverage, kmer_index,
+      prg_info, parameters, quasimap_stats,
+      read_selection_key(master_seed, read_index, true), read_cache);
+
+  if (mapping_writer == nullptr) return;
+  if (forward_mapping)
+    mapping_writer->add(read_name, false, read.size(),
+                        forward_mapping->selected, prg_info);
+  if (reverse_mapping)
+    mapping_writer->add(read_name, true, read.size(),
+                        reverse_mapping->selected, prg_info);
+}
 
-  auto reverse_read = reverse_complement_read(read);
-  // Reverse mapping
-  quasimap_read(reverse_read, quasimap_stats.coverage, kmer_index, prg_info,
-                parameters, quasimap_stats, selection_seed);
+/**
+ * Looks up the read's seeding (last) kmer in the index, copying it into `kmer`.
+ * @return the kmer's search states, or nullptr if it is not in the index.
+ */
+SearchStates const *find_seed(ReadView const &read, uint32_t const kmer_size,
+                              KmerIndex const &kmer_index, Sequence &kmer) {
+  if (read.size() < kmer_size) return nullptr;
+  read.copy(read.size() - kmer_size, kmer_size, kmer);
+  auto const seed = kmer_index.find(kmer);
+  return seed == kmer_index.end() ? nullptr : &seed->second;
 }
 
-void gram::quasimap_read(const Sequence &read, Coverage &coverage,
-                         const KmerIndex &kmer_index, const PRG_Info &prg_info,
-                         const GenotypeParams &parameters,
-                         QuasimapReadsStats &stats,
-                         SeedSize const &selection_seed) {
-  /*
-   * We can discard reads containing 1 or more kmers not present in the index.
-   * This is based on the following assumptions:
-   *   - All kmers of size `kmers_size` in the PRG are in the index
-   *   - Reads must be mapped exactly
-   */
-  bool read_can_map_exactly =
-      all_read_kmers_occur_in_index(parameters.kmers_size, read, kmer_index);
-  if (not read_can_map_exactly) {
+/**
+ * Extends the seed one base at a time, aborting as soon as the search fails.
+ * Each newly completed kmer is only looked up in the index once the search has
+ * extended through it.
+ */
+ReadMapping extend_seed(ReadView const &read, SearchStates search_states,
+                        Sequence &kmer, uint32_t const kmer_size,
+                        KmerIndex const &kmer_index, PRG_Info const &prg_info) {
+  instrumentation::LocalCount bases_extended(
+      instrumentation::Counter::bases_extended);
+  for (std::size_t pos = read.size() - kmer_size; pos-- > 0;) {
+    ++bases_extended;
+    search_states =
+        process_read_char_search_states(read[pos], search_states, prg_info);
+    // Test read did not map
+    if (search_states.empty())
+      return ReadMapping{ReadMappingOutcome::no_extension, {}};
+
+    read.copy(pos, kmer_size, kmer);
+    if (kmer_index.find(kmer) == kmer_index.end())
+      return ReadMapping{ReadMappingOutcome::missing_kmer, {}};
+  }
+
+  search_states = handle_allele_encapsulated_states(search_states, prg_info);
+  if (search_states.empty())
+    return ReadMapping{ReadMappingOutcome::no_extension, {}};
+  return ReadMapping{ReadMappingOutcome::mapped, std::move(search_states)};
+}
+
+/**
+ * Extends a seeded read, unless it is found in `read_cache`: duplicate reads
+ * are only searched once; mapping instance selection is then done with each
+ * read's own seed.
+ */
+FoundMapping search_seeded_read(ReadView const &read,
+                                SearchStates const &seed, Sequence &kmer,
+                                const KmerIndex &kmer_index,
+                                const PRG_Info &prg_info,
+                                const GenotypeParams &parameters,
+                                ReadMappingCache *const read_cache) {
+  FoundMapping found;
+  std::optional<PackedRead> cache_key;
+  if (read_cache != nullptr) {
+    cache_key = ReadMappingCache::pack(read);
+    if (cache_key) found.cached = read_cache->find(*cache_key);
+  }
+
+  if (found.cached == nullptr) {
+    found.computed = extend_seed(read, seed, kmer, parameters.kmers_size,
+                                 kmer_index, prg_info);
+    if (cache_key) {
+      found.cached =
+          std::make_shared<ReadMapping const>(std::move(*found.computed));
+      found.computed.reset();
+      read_cache->insert(std::move(*cache_key), found.cached);
+    }
+  }
+  return found;
+}
+
+/**
+ * Counts in `stats` why a read did not map.
+ * @return whether the read mapped.
+ */
+bool count_outcome(ReadMappingOutcome const outcome,
+                   QuasimapReadsStats &stats) {
+  switch (outcome) {
+    case ReadMappingOutcome::missing_kmer:
 #pragma omp atomic
-    stats.missing_kmer_reads_count += 1;
-    return;
+      stats.missing_kmer_reads_count += 1;
+      return false;
+    case ReadMappingOutcome::no_extension:
+#pragma omp atomic
+      stats.no_extension_reads_count += 1;
+      return false;
+    case ReadMappingOutcome::mapped:
+      break;
   }
+  return true;
+}
 
-  auto seeding_kmer = get_last_kmer_in_read(parameters.kmers_size, read);
-  auto search_states =
-      search_read_backwards(read, seeding_kmer, kmer_index, prg_info);
-  // Test read did not map
-  if (search_states.empty()) {
+std::optional<MappedRead> gram::quasimap_read(
+    ReadView const &read, Coverage &coverage, const KmerIndex &kmer_index,
+    const PRG_Info &prg_info, const GenotypeParams &parameters,
+    QuasimapReadsStats &stats, SelectionKey const selection_key,
+    ReadMappingCache *const read_cache) {
+  // Strand pre-filter: a read whose seeding kmer is not indexed is discarded
+  // before any cache lookup or extension. For unstranded reads, this is
+  // typically the case for one of the two strands.
+  Sequence kmer;
+  auto const seed = find_seed(read, parameters.kmers_size, kmer_index, kmer);
+  if (seed == nullptr) {
 #pragma omp atomic
-    stats.no_extension_reads_count += 1;
-    return;
+    stats.missing_kmer_reads_count += 1;
+    return std::nullopt;
   }
+  instrumentation::count(instrumentation::Counter::reads_seeded);
+
+  auto found = search_seeded_read(read, *seed, kmer, kmer_index, prg_info,
+                                  parameters, read_cache);
+  auto const &mapping = found.get();
+  if (!count_outcome(mapping.outcome, stats)) return std::nullopt;
 
   auto read_length = read.size();
-  coverage::record::search_states(coverage, search_states, read_length,
-                                  prg_info, selection_seed);
+  auto selected = coverage::record::search_states(
+      coverage, mapping.search_states, read_length, prg_info, selection_key);
 #pragma omp atomic
   stats.exact_mapped_reads_count += 1;
-  return;
+  return MappedRead{std::move(found), std::move(selected)};
+}
+
+DepthEstimator::DepthEstimator(const PRG_Info &prg_info) {
+  auto const &coverage_graph = prg_info.coverage_graph;
+  for (auto const &bubble_entry : coverage_graph.bubble_map) {
+    auto const site_ID = bubble_entry.first->get_site_ID();
+    if (coverage_graph.par_map.find(site_ID) == coverage_graph.par_map.end())
+      level1_site_indices.push_back(siteID_to_index(site_ID));
+  }
+}
+
+double DepthEstimator::mean_depth(
+    AlleleSumCoverage const &allele_sum_coverage) const {
+  if (level1_site_indices.empty()) return 0;
+  uint64_t total_coverage = 0;
+  for (auto const site_index : level1_site_indices)
+    for (auto const allele_coverage : allele_sum_coverage[site_index])
+      total_coverage += allele_coverage;
+  return static_cast<double>(total_coverage) / level1_site_indices.size();
+}
+
+using MateMappings = std::array<std::optional<MappedRead>, 2>;
+
+/**
+ * Maps the mates of a pair in one of its orientations.
+ * @see quasimap_pair()
+ * @return each mate's selected mapping instance(s), if the pair mapped.
+ */
+MateMappings quasimap_pair_orientation(QuasimapReadsStats &stats,
+                                       std::array<ReadView, 2> const &mates,
+                                       const GenotypeParams &parameters,
+                                       const KmerIndex &kmer_index,
+                                       const PRG_Info &prg_info,
+                                       SelectionKey const selection_key,
+                                       ReadMappingCache *const read_cache) {
+  std::array<Sequence, 2> kmers;
+  std::array<SearchStates const *, 2> seeds;
+  for (int mate = 0; mate < 2; ++mate)
+    seeds[mate] = find_seed(mates[mate], parameters.kmers_size, kmer_index,
+                            kmers[mate]);
+  if (seeds[0] == nullptr || seeds[1] == nullptr) {
+    uint64_t const num_unseeded = (seeds[0] == nullptr) + (seeds[1] == nullptr);
+#pragma omp atomic
+    stats.missing_kmer_reads_count += num_unseeded;
+#pragma omp atomic
+    stats.unpaired_reads_count += 2 - num_unseeded;
+    return {};
+  }
+  instrumentation::count(instrumentation::Counter::reads_seeded, 2);
+
+  std::array<FoundMapping, 2> found;
+  for (int mate = 0; mate < 2; ++mate) {
+    found[mate] = search_seeded_read(mates[mate], *seeds[mate], kmers[mate],
+                                     kmer_index, prg_info, parameters,
+                                     read_cache);
+    if (!count_outcome(found[mate].get().outcome, stats)) {
+      // The other mate is dropped, or not extended at all
+#pragma omp atomic
+      stats.unpaired_reads_count += 1;
+      return {};
+    }
+  }
+
+  MateMappings selected;
+  if (count_instances(found[0].get().search_states) > max_located_instances ||
+      count_instances(found[1].get().search_states) > max_located_instances) {
+    // Too repetitive to pair: each mate is recorded on its own, as single
+    // reads are, rather than losing its coverage
+    CounterRandomInt mate_keys{selection_key};
+    for (int mate = 0; mate < 2; ++mate) {
+      auto mate_selection = coverage::record::search_states(
+          stats.coverage, found[mate].get().search_states, mates[mate].size(),
+          prg_info, mate_keys.next());
+      selected[mate].emplace(std::move(found[mate]), std::move(mate_selection));
+    }
+#pragma omp atomic
+    stats.exact_mapped_reads_count += 2;
+#pragma omp atomic
+    stats.unpaired_repetitive_reads_count += 2;
+    return selected;
+  }
+
+  auto const pairs = concordant_pairs(found[0].get().search_states,
+                                      found[1].get().search_states, prg_info,
+                                      parameters.max_insert_size);
+  if (pairs.empty()) {
+#pragma omp atomic
+    stats.unpaired_reads_count += 2;
+    return {};
+  }
+
+  // A single draw selects the pair, so that the mates' recorded instances are
+  // concordant with one another
+  CounterRandomInt selector{selection_key};
+  auto const &chosen_pair = pairs[selector.generate(1, pairs.size()) - 1];
+  for (int mate = 0; mate < 2; ++mate) {
+    auto const &instance = chosen_pair[mate];
+    FoundMapping instance_mapping;
+    instance_mapping.computed =
+        ReadMapping{ReadMappingOutcome::mapped, {*instance.search_state}};
+    auto &instance_state = instance_mapping.computed->search_states.front();
+    instance_state.sa_interval = {instance.sa_index, instance.sa_index};
+    auto instance_selection = coverage::record::search_states(
+        stats.coverage, instance_mapping.get().search_states,
+        mates[mate].size(), prg_info, selection_key);
+    selected[mate].emplace(std::move(instance_mapping),
+                           std::move(instance_selection));
+  }
+#pragma omp atomic
+  stats.exact_mapped_reads_count += 2;
+  return selected;
+}
+
+void gram::quasimap_pair(QuasimapReadsStats &quasimap_stats,
+                         ReadView const &mate1, ReadView const &mate2,
+                         const GenotypeParams &parameters,
+                         const KmerIndex &kmer_index, const PRG_Info &prg_info,
+                         SeedSize const master_seed, uint64_t const pair_index,
+                         ReadMappingCache *const read_cache,
+                         std::string_view const mate1_name,
+                         std::string_view const mate2_name,
+                         ReadMappingWriter *const mapping_writer) {
+  // As for single reads, reverse complements are materialised once
+  thread_local std::array<Sequence, 2> reverse_bases;
+  mate1.reverse_complement().copy(0, mate1.size(), reverse_bases[0]);
+  mate2.reverse_complement().copy(0, mate2.size(), reverse_bases[1]);
+  std::array<std::string_view, 2> const names{mate1_name, mate2_name};
+
+  for (bool const mate1_reversed : {false, true}) {
+    std::array<ReadView, 2> const mates{
+        mate1_reversed ? ReadView(reverse_bases[0]) : mate1,
+        mate1_reversed ? mate2 : ReadView(reverse_bases[1])};
+    auto const selected = quasimap_pair_orientation(
+        quasimap_stats, mates, parameters, kmer_index, prg_info,
+        read_selection_key(master_seed, pair_index, mate1_reversed),
+        read_cache);
+
+    if (mapping_writer == nullptr) continue;
+    for (int mate = 0; mate < 2; ++mate) {
+      bool const reversed = (mate == 0) == mate1_reversed;
+      if (selected[mate])
+        mapping_writer->add(names[mate], reversed, mates[mate].size(),
+                            selected[mate]->selected, prg_info);
+    }
+  }
+}
+
+/** The mapping instances of the search states, sorted by position */
+std::vector<MateInstance> locate_instances(SearchStates const &search_states,
+                                           const PRG_Info &prg_info) {
+  std::vector<MateInstance> instances;
+  for (auto const &search_state : search_states)
+    for (auto sa_index = search_state.sa_interval.first;
+         sa_index <= search_state.sa_interval.second; ++sa_index)
+      instances.push_back({&search_state, sa_index,
+                           static_cast<uint64_t>(prg_info.fm_index[sa_index])});
+  instrumentation::count(instrumentation::Counter::sa_positions_located,
+                         instances.size());
+  std::sort(instances.begin(), instances.end(),
+            [](MateInstance const &a, MateInstance const &b) {
+              return a.position < b.position;
+            });
+  return instances;
+}
+
+uint64_t gram::count_instances(SearchStates const &search_states) {
+  uint64_t count = 0;
+  for (auto const &search_state : search_states)
+    count += search_state.sa_interval.second - search_state.sa_interval.first +
+             1;
+  return count;
+}
+
+std::vector<ConcordantPair> gram::concordant_pairs(
+    SearchStates const &mate1_states, SearchStates const &mate2_states,
+    const PRG_Info &prg_info, uint64_t const max_insert_size) {
+  if (count_instances(mate1_states) > max_located_instances ||
+      count_instances(mate2_states) > max_located_instances)
+    return {};
+
+  auto const mate1_instances = locate_instances(mate1_states, prg_info);
+  auto const mate2_instances = locate_instances(mate2_states, prg_info);
+  std::vector<ConcordantPair> pairs;
+  auto window_start = mate2_instances.begin();
+  for (auto const &mate1_instance : mate1_instances) {
+    auto const position = mate1_instance.position;
+    auto const lowest =
+        position > max_insert_size ? position - max_insert_size : 0;
+    // Instances are sorted, so the window of mate 2 instances only moves right
+    while (window_start != mate2_instances.end() &&
+           window_start->position < lowest)
+      ++window_start;
+    for (auto mate2_instance = window_start;
+         mate2_instance != mate2_instances.end() &&
+         mate2_instance->position <= position + max_insert_size;
+         ++mate2_instance)
+      pairs.push_back({mate1_instance, *mate2_instance});
+  }
+  return pairs;
+}
+
+ReadMapping gram::map_read(ReadView const &read, const KmerIndex &kmer_index,
+                           const PRG_Info &prg_info,
+                           const GenotypeParams &parameters) {
+  /*
+   * We can discard reads containing 1 or more kmers not present in the index.
+   * This is based on the following assumptions:
+   *   - All kmers of size `kmers_size` in the PRG are in the index
+   *   - Reads must be mapped exactly
+   */
+  Sequence kmer;
+  auto const seed = find_seed(read, parameters.kmers_size, kmer_index, kmer);
+  if (seed == nullptr) return ReadMapping{ReadMappingOutcome::missing_kmer, {}};
+  return extend_seed(read, *seed, kmer, parameters.kmers_size, kmer_index,
+                     prg_info);
 }
 
 Sequence gram::get_kmer_in_read(const uint32_t &kmer_size,
@@ -267,32 +766,8 @@ SearchStates gram::process_read_char_search_states(const int_Base &pattern_char,
   return new_search_states;
 }
 
-/**
- * Produce integer-encoded Watson-Crick base complement.
- */
-int_Base complement_encoded_base(const int_Base &encoded_base) {
-  switch (encoded_base) {
-    case 1:
-      return 4;
-    case 2:
-      return 3;
-    case 3:
-      return 2;
-    case 4:
-      return 1;
-    default:
-      return 0;
-  }
-}
-
 Sequence gram::reverse_complement_read(const Sequence &read) {
-  Sequence reverse_read;
-  reverse_read.reserve(read.size());
-
-  for (auto it = read.rbegin(); it != read.rend(); ++it) {
-    const auto &base = *it;
-    auto complement_base = complement_encoded_base(base);
-    reverse_read.push_back(complement_base);
-  }
+  Sequence reverse_read(read.size());
+  reverse_complement_bases(read.data(), read.size(), reverse_read.data());
   return reverse_read;
 }
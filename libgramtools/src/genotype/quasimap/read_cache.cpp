@@ -0,0 +1,59 @@
+#include "genotype/quasimap/read_cache.hpp"
+
+using namespace gram;
+
+ReadMappingCache::ReadMappingCache(std::size_t max_num_reads,
+                                   std::size_t num_shards)
+    : shards(num_shards), max_num_reads(max_num_reads) {}
+
+std::optional<PackedRead> ReadMappingCache::pack(ReadView const& read) {
+  uint32_t const read_size = read.size();
+  PackedRead packed(sizeof(read_size) + (read.size() + 3) / 4, '\0');
+  for (std::size_t i = 0; i < sizeof(read_size); ++i)
+    packed[i] = static_cast<char>(read_size >> (8 * i));
+
+  for (std::size_t i = 0; i < read.size(); ++i) {
+    auto const base = read[i];
+    if (base < 1 || base > 4) return std::nullopt;
+    packed[sizeof(read_size) + i / 4] |= (base - 1) << (2 * (i % 4));
+  }
+  return packed;
+}
+
+ReadMappingCache::Shard& ReadMappingCache::get_shard(PackedRead const& key) {
+  return shards[std::hash<PackedRead>{}(key) % shards.size()];
+}
+
+ReadMapping_ptr ReadMappingCache::find(PackedRead const& key) {
+  auto& shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto const found = shard.mappings.find(key);
+  if (found == shard.mappings.end()) return nullptr;
+  ++num_hits;
+  return found->second;
+}
+
+bool ReadMappingCache::reserve_read() {
+  auto reserved = num_reads.load();
+  do {
+    if (reserved >= max_num_reads) return false;
+  } while (!num_reads.compare_exchange_weak(reserved, reserved + 1));
+  return true;
+}
+
+void ReadMappingCache::insert(PackedRead key, ReadMapping_ptr mapping) {
+  auto& shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  // Read counts are shared by the shards, so that their sum is capped
+  if (shard.mappings.count(key) > 0 || !reserve_read()) return;
+  shard.mappings.emplace(std::move(key), std::move(mapping));
+}
+
+std::size_t ReadMappingCache::size() {
+  std::size_t result{0};
+  for (auto& shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    result += shard.mappings.size();
+  }
+  return result;
+}
@@ -0,0 +1,297 @@
+#include "genotype/quasimap/read_input.hpp"
+
+#include <htslib/bgzf.h>
+#include <htslib/hts.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include "common/dna_kernels.hpp"
+
+using namespace gram;
+
+DecompressedStream::DecompressedStream(std::string const &fpath,
+                                       int num_threads)
+    : fpath(fpath), file(bgzf_open(fpath.c_str(), "r")) {
+  if (file == nullptr)
+    throw std::runtime_error("Cannot open read file " + fpath);
+  switch (bgzf_compression(file)) {
+    case bgzf:
+      compression = InputCompression::bgzf;
+      if (num_threads > 1) bgzf_mt(file, num_threads, 256);
+      break;
+    case gzip:
+      compression = InputCompression::gzip;
+      inflater = std::thread(&DecompressedStream::inflate_ahead, this);
+      break;
+    default:
+      compression = InputCompression::none;
+  }
+}
+
+DecompressedStream::~DecompressedStream() {
+  if (inflater.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    chunk_taken.notify_all();
+    inflater.join();
+  }
+  bgzf_close(file);
+}
+
+bool DecompressedStream::read_chunk(InputChunk &chunk) {
+  chunk.resize(chunk_size);
+  auto const num_read = bgzf_read(file, chunk.data(), chunk.size());
+  if (num_read < 0)
+    throw std::runtime_error("Cannot decompress read file " + fpath);
+  chunk.resize(num_read);
+  return num_read > 0;
+}
+
+void DecompressedStream::inflate_ahead() {
+  while (true) {
+    InputChunk chunk;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      chunk_taken.wait(lock, [this] {
+        return stopping || full_chunks.size() < max_queued_chunks;
+      });
+      if (stopping) return;
+      if (!free_chunks.empty()) {
+        chunk = std::move(free_chunks.back());
+        free_chunks.pop_back();
+      }
+    }
+
+    bool inflated_chunk = false;
+    std::exception_ptr error;
+    try {
+      inflated_chunk = read_chunk(chunk);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (inflated_chunk)
+        full_chunks.push_back(std::move(chunk));
+      else {
+        inflated_all = true;
+        inflate_error = error;
+      }
+    }
+    chunk_ready.notify_one();
+    if (!inflated_chunk) return;
+  }
+}
+
+bool DecompressedStream::next_chunk(InputChunk &chunk) {
+  if (!inflater.joinable()) return read_chunk(chunk);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  if (chunk.capacity() > 0) free_chunks.push_back(std::move(chunk));
+  chunk = InputChunk{};
+  chunk_ready.wait(lock,
+                   [this] { return inflated_all || !full_chunks.empty(); });
+  if (!full_chunks.empty()) {
+    chunk = std::move(full_chunks.front());
+    full_chunks.pop_front();
+    lock.unlock();
+    chunk_taken.notify_one();
+    return true;
+  }
+  if (inflate_error) std::rethrow_exception(inflate_error);
+  return false;
+}
+
+void ReadBatch::clear() {
+  bases.clear();
+  all_qualities.clear();
+  names.clear();
+  base_ends.assign(1, 0);
+  quality_ends.assign(1, 0);
+  name_ends.assign(1, 0);
+  lengths.clear();
+}
+
+void ReadBatch::start_read(std::string_view name) {
+  names.append(name);
+  read_length = 0;
+  read_is_dna = true;
+}
+
+void ReadBatch::append_bases(std::string_view read_bases) {
+  read_length += read_bases.size();
+  if (!read_is_dna) return;
+  auto const start = bases.size();
+  bases.resize(start + read_bases.size());
+  read_is_dna =
+      encode_bases(read_bases.data(), read_bases.size(), bases.data() + start);
+}
+
+void ReadBatch::append_qualities(std::string_view read_qualities) {
+  all_qualities.append(read_qualities);
+}
+
+void ReadBatch::end_read() {
+  if (!read_is_dna) bases.resize(base_ends.back());
+  base_ends.push_back(bases.size());
+  quality_ends.push_back(all_qualities.size());
+  name_ends.push_back(names.size());
+  lengths.push_back(read_length);
+}
+
+void ReadBatch::add(GenomicRead const &read) {
+  start_read(read.name);
+  append_bases(read.seq);
+  append_qualities(read.qual);
+  end_read();
+}
+
+FastxParser::FastxParser(std::unique_ptr<DecompressedStream> stream,
+                         InputChunk first_chunk, FastxFormat format)
+    : stream(std::move(stream)),
+      chunk(std::move(first_chunk)),
+      format(format) {}
+
+std::optional<FastxFormat> FastxParser::detect_format(InputChunk const &chunk) {
+  if (chunk.empty()) return std::nullopt;
+  if (chunk.front() == '>') return FastxFormat::fasta;
+  if (chunk.front() != '@') return std::nullopt;
+
+  // SAM headers also start with '@': FASTQ has a '+' line after the sequence
+  auto const end = chunk.data() + chunk.size();
+  auto const *line_start = chunk.data();
+  for (int line_number = 0; line_number < 2; ++line_number) {
+    auto const *line_end = static_cast<char const *>(
+        std::memchr(line_start, '\n', end - line_start));
+    if (line_end == nullptr) return std::nullopt;
+    line_start = line_end + 1;
+  }
+  if (line_start < end && *line_start == '+') return FastxFormat::fastq;
+  return std::nullopt;
+}
+
+bool FastxParser::next_line() {
+  if (has_line) {
+    has_line = false;
+    return true;
+  }
+  bool is_split = false;
+  while (true) {
+    if (position == chunk.size()) {
+      position = 0;
+      if (!stream->next_chunk(chunk)) {
+        // The last line has no line ending
+        if (!is_split) return false;
+        line = split_line;
+        break;
+      }
+    }
+    auto const *start = chunk.data() + position;
+    auto const remaining = chunk.size() - position;
+    auto const *newline =
+        static_cast<char const *>(std::memchr(start, '\n', remaining));
+    if (newline == nullptr) {
+      // The line continues in the next chunk
+      if (!is_split) split_line.clear();
+      split_line.append(start, remaining);
+      is_split = true;
+      position = chunk.size();
+      continue;
+    }
+    std::size_t const line_length = newline - start;
+    position += line_length + 1;
+    if (is_split) {
+      split_line.append(start, line_length);
+      line = split_line;
+    } else
+      line = std::string_view(start, line_length);
+    break;
+  }
+  if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+  return true;
+}
+
+bool FastxParser::parse_fastq(ReadBatch &batch) {
+  do {
+    if (!next_line()) return false;
+  } while (line.empty());
+  if (line.front() != '@')
+    throw std::runtime_error("FASTQ record does not start with '@': " +
+                             std::string(line));
+  batch.start_read(line.substr(1));
+
+  while (true) {
+    if (!next_line())
+      throw std::runtime_error("FASTQ record has no quality line");
+    if (!line.empty() && line.front() == '+') break;
+    batch.append_bases(line);
+  }
+
+  while (batch.current_num_qualities() < batch.current_length()) {
+    if (!next_line())
+      throw std::runtime_error("FASTQ record has fewer qualities than bases");
+    batch.append_qualities(line);
+  }
+  batch.end_read();
+  return true;
+}
+
+bool FastxParser::parse_fasta(ReadBatch &batch) {
+  do {
+    if (!next_line()) return false;
+  } while (line.empty());
+  if (line.front() != '>')
+    throw std::runtime_error("FASTA record does not start with '>': " +
+                             std::string(line));
+  batch.start_read(line.substr(1));
+
+  while (next_line()) {
+    if (!line.empty() && line.front() == '>') {
+      has_line = true;  // The next record's header
+      break;
+    }
+    batch.append_bases(line);
+  }
+  batch.end_read();
+  return true;
+}
+
+bool FastxParser::next_batch(ReadBatch &batch, std::size_t max_reads) {
+  batch.clear();
+  while (batch.size() < max_reads) {
+    bool const parsed = format == FastxFormat::fastq ? parse_fastq(batch)
+                                                     : parse_fasta(batch);
+    if (!parsed) break;
+  }
+  return !batch.empty();
+}
+
+ReadFileReader::ReadFileReader(std::string const &fpath, int num_threads) {
+  auto stream = std::make_unique<DecompressedStream>(fpath, num_threads);
+  InputChunk first_chunk;
+  stream->next_chunk(first_chunk);
+  auto const format = FastxParser::detect_format(first_chunk);
+  if (format) {
+    fastx_parser.emplace(std::move(stream), std::move(first_chunk), *format);
+    return;
+  }
+  stream.reset();
+  seq_read = std::make_unique<SeqRead>(fpath.c_str());
+  seq_read_it.emplace(seq_read->begin());
+}
+
+bool ReadFileReader::next_batch(ReadBatch &batch, std::size_t max_reads) {
+  if (fastx_parser) return fastx_parser->next_batch(batch, max_reads);
+
+  batch.clear();
+  auto &reads_it = *seq_read_it;
+  while (batch.size() < max_reads && reads_it != seq_read->end()) {
+    batch.add(**reads_it);
+    ++reads_it;
+  }
+  return !batch.empty();
+}
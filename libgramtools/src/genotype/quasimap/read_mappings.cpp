@@ -0,0 +1,159 @@
+#include "genotype/quasimap/read_mappings.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace gram;
+
+namespace {
+template <typename Loci>
+void append_loci(std::string& out, Loci const& loci) {
+  if (loci.empty()) {
+    out += '.';
+    return;
+  }
+  bool first = true;
+  for (auto const& locus : loci) {
+    if (!first) out += ',';
+    first = false;
+    out += std::to_string(locus.first);
+    out += ':';
+    out += std::to_string(locus.second);
+  }
+}
+
+void append_search_state(std::string& out, SearchState const& search_state,
+                         PRG_Info const& prg_info) {
+  auto const& sa_interval = search_state.sa_interval;
+  out += std::to_string(sa_interval.first);
+  out += '-';
+  out += std::to_string(sa_interval.second);
+  out += '|';
+  // Each position is an SA locate, run on the mapping thread: wide intervals
+  // are left for the reader to locate
+  auto const last_listed = std::min<uint64_t>(
+      sa_interval.second, sa_interval.first + max_listed_positions - 1);
+  for (auto i = sa_interval.first; i <= last_listed; ++i) {
+    if (i != sa_interval.first) out += ',';
+    out += std::to_string(prg_info.fm_index[i]);
+  }
+  if (last_listed < sa_interval.second) out += ",...";
+  out += '|';
+  append_loci(out, search_state.traversed_path);
+  out += '|';
+  append_loci(out, search_state.traversing_path);
+}
+}  // namespace
+
+void gram::format_read_mapping(std::string& out, std::string_view read_name,
+                               bool reverse_complement,
+                               std::size_t read_length,
+                               SelectedMapping const& selection,
+                               PRG_Info const& prg_info) {
+  out += read_name;
+  out += '\t';
+  out += reverse_complement ? '-' : '+';
+  out += '\t';
+  out += std::to_string(read_length);
+  out += '\t';
+
+  auto const& search_states = selection.navigational_search_states;
+  if (search_states.empty()) {
+    out += ".\t.";
+    return;
+  }
+  append_loci(out, selection.equivalence_class_loci);
+  out += '\t';
+  bool first = true;
+  for (auto const& search_state : search_states) {
+    if (!first) out += ';';
+    first = false;
+    append_search_state(out, *search_state, prg_info);
+  }
+}
+
+ReadMappingWriter::ReadMappingWriter(std::string const& fpath,
+                                     std::size_t num_threads)
+    : fpath(fpath),
+      out(fpath),
+      thread_buffers(num_threads),
+      max_queued_buffers(std::max<std::size_t>(2 * num_threads, 1)),
+      closed(false),
+      write_failed(false) {
+  if (!out.is_open())
+    throw std::runtime_error("Cannot open " + fpath + " for writing");
+  writer = std::thread(&ReadMappingWriter::write_buffers, this);
+}
+
+ReadMappingWriter::~ReadMappingWriter() {
+  try {
+    close();
+  } catch (std::runtime_error const&) {
+  }
+}
+
+void ReadMappingWriter::add(std::string_view read_name,
+                            bool reverse_complement, std::size_t read_length,
+                            SelectedMapping const& selection,
+                            PRG_Info const& prg_info) {
+  auto& buffer = thread_buffers.at(omp_get_thread_num()).lines;
+  format_read_mapping(buffer, read_name, reverse_complement, read_length,
+                      selection, prg_info);
+  buffer += '\n';
+  if (buffer.size() >= buffer_size) hand_off(buffer);
+}
+
+void ReadMappingWriter::hand_off(std::string& buffer) {
+  if (buffer.empty()) return;
+  std::string full_buffer;
+  full_buffer.reserve(buffer_size + buffer_size / 4);
+  std::swap(full_buffer, buffer);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    // Bounds memory use when the disk is slower than mapping
+    buffer_written.wait(
+        lock, [this] { return full_buffers.size() < max_queued_buffers; });
+    full_buffers.push_back(std::move(full_buffer));
+  }
+  buffer_available.notify_one();
+}
+
+void ReadMappingWriter::write_buffers() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    buffer_available.wait(lock,
+                          [this] { return closed || !full_buffers.empty(); });
+    if (full_buffers.empty()) return;  // Closed, and nothing left to write
+    auto buffer = std::move(full_buffers.front());
+    full_buffers.pop_front();
+    // After a failed write, buffers are still dequeued, so that mapping
+    // threads do not wait forever; the failure is reported on `close`
+    bool const write = !write_failed;
+    lock.unlock();
+    buffer_written.notify_all();
+    bool failed = false;
+    if (write) failed = !out.write(buffer.data(), buffer.size());
+    lock.lock();
+    write_failed = write_failed || failed;
+  }
+}
+
+void ReadMappingWriter::flush() {
+  for (auto& buffer : thread_buffers) hand_off(buffer.lines);
+}
+
+void ReadMappingWriter::close() {
+  if (!writer.joinable()) return;
+  flush();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+  }
+  buffer_available.notify_one();
+  writer.join();
+  out.close();
+  if (write_failed || out.fail())
+    throw std::runtime_error("Failed to write read mappings to " + fpath);
+}
@@ -1,5 +1,7 @@
 #include "genotype/quasimap/search/encapsulated_search.hpp"
 
+#include "common/instrumentation.hpp"
+
 /**
  * A caching object used to temporarily store a single search state
  * @see handle_allele_encapsulated_state()
@@ -33,6 +35,9 @@ SearchStates gram::handle_allele_encapsulated_state(
 
   SearchStates new_search_states = {};
   SearchStateCache cache;
+  instrumentation::count(
+      instrumentation::Counter::sa_positions_located,
+      search_state.sa_interval.second - search_state.sa_interval.first + 1);
 
   for (uint64_t sa_index = search_state.sa_interval.first;
        sa_index <= search_state.sa_interval.second; ++sa_index) {
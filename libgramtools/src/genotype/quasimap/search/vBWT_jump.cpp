@@ -1,5 +1,7 @@
 #include "genotype/quasimap/search/vBWT_jump.hpp"
 
+#include "common/instrumentation.hpp"
+
 SA_Interval gram::get_allele_marker_sa_interval(
     const Marker &allele_marker_char, const PRG_Info &prg_info) {
   const auto alphabet_rank = prg_info.fm_index.char2comp[allele_marker_char];
@@ -96,10 +98,13 @@ MarkersSearchResults gram::left_markers_search(const SearchState &search_state,
   MarkersSearchResults markers_search_results;
 
   const auto &sa_interval = search_state.sa_interval;
+  instrumentation::LocalCount sa_positions_located(
+      instrumentation::Counter::sa_positions_located);
 
   for (int index = sa_interval.first; index <= sa_interval.second; index++) {
     if (prg_info.bwt_markers_mask[index] == 0) continue;
 
+    ++sa_positions_located;
     auto prg_index = prg_info.fm_index[index];
     VariantLocus target_locus =
         prg_info.coverage_graph.random_access[prg_index].target;
@@ -136,6 +141,8 @@ SearchStates gram::search_state_vBWT_jumps(
   // A vector of the `VariantLocus`s that need to be processed
   auto marker_targets = left_markers_search(current_search_state, prg_info);
   if (marker_targets.empty()) return SearchStates{};
+  instrumentation::count(instrumentation::Counter::vbwt_jumps,
+                         marker_targets.size());
 
   target_m const &target_map = prg_info.coverage_graph.target_map;
   SearchStates markers_search_states = {};
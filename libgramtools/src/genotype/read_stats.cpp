@@ -2,71 +2,79 @@
 
 #include <math.h>
 
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <nlohmann/json.hpp>
+
 #include "genotype/infer/types.hpp"
 #include "prg/coverage_graph.hpp"
 
 using namespace gram;
 
-void gram::ReadStats::compute_base_error_rate(const std::string& reads_fpath) {
-  SeqRead reads(reads_fpath.c_str());
-  SeqRead::SeqIterator reads_it = reads.begin();
-  process_read_perbase_error_rates(reads_it);
-}
+void ReadTally::add_read(std::size_t length, ReadView const& read,
+                         std::string_view qualities) {
+  ++num_reads;
+  ++length_histogram[length];
 
-void gram::ReadStats::compute_base_error_rate(GenomicRead_vector const& reads) {
-  GenomicReadIterator reads_it(reads);
-  process_read_perbase_error_rates(reads_it);
+  if (!read.empty()) {
+    std::size_t num_gc = 0;
+    for (std::size_t i = 0; i < read.size(); ++i)
+      num_gc += (read[i] == 2 || read[i] == 3);  // C or G
+    ++gc_histogram[(100 * num_gc + read.size() / 2) / read.size()];
+  }
+
+  if (qualities.empty()) {
+    ++no_qual_reads;
+    return;
+  }
+  for (auto const base : qualities) {
+    // Assuming +33 Phred-scoring
+    int score = std::clamp(base - 33, 0, int{num_quality_scores} - 1);
+    ++quality_histogram[score];
+  }
 }
 
-void gram::ReadStats::process_read_perbase_error_rates(
-    AbstractGenomicReadIterator& reads_it) {
-  // The number of reads (with at least one base with recorded quality) to
-  // estimate from. Is defined in the header file.
-  uint64_t required_reads = NUM_READS_USED;
-  uint64_t num_informative_reads = 0;
+void ReadTally::merge(ReadTally const& other) {
+  num_reads += other.num_reads;
+  no_qual_reads += other.no_qual_reads;
+  for (std::size_t i = 0; i < num_quality_scores; ++i)
+    quality_histogram[i] += other.quality_histogram[i];
+  for (auto const& entry : other.length_histogram)
+    length_histogram[entry.first] += entry.second;
+  for (std::size_t i = 0; i < num_gc_bins; ++i)
+    gc_histogram[i] += other.gc_histogram[i];
+}
 
-  int64_t no_qual_reads = 0;
+void gram::ReadStats::compute_read_stats(ReadTally const& tally) {
   int64_t num_bases_processed = 0;
-  double mean_error = 0;
-
-  float running_qual_score = 0.0;
-
-  while (num_informative_reads < required_reads and reads_it.has_more_reads()) {
-    auto* const raw_read = *reads_it;
-
-    // Test for max read length
-    std::string sequence = std::string(raw_read->seq);
-    auto sequence_length = sequence.length();
-    if (sequence_length > this->max_read_length)
-      this->max_read_length = sequence_length;
-
-    // Process quality scores
-    std::string qualities = std::string(raw_read->qual);
-
-    if (qualities.length() ==
-        0) {  // We will keep looking for reads with quality scored bases.
-      no_qual_reads++;
-      ++reads_it;
-      continue;
-    }
-
-    for (const auto base : qualities) {
-      running_qual_score += (base - 33);  // Assuming +33 Phred-scoring
-      num_bases_processed++;
-    }
-
-    num_informative_reads++;
-    ++reads_it;
+  double running_qual_score = 0.0;
+  for (std::size_t score = 0; score < ReadTally::num_quality_scores; ++score) {
+    num_bases_processed += tally.quality_histogram[score];
+    running_qual_score +=
+        static_cast<double>(score) * tally.quality_histogram[score];
   }
 
+  double mean_error = 0;
   if (num_bases_processed > 0) {
     double mean_qual = running_qual_score / num_bases_processed;
     mean_error = pow(10, -mean_qual / 10);
   }
 
+  auto const& lengths = tally.length_histogram;
+  this->max_read_length = lengths.empty() ? 0 : lengths.rbegin()->first;
   this->num_bases_processed = num_bases_processed;
-  this->no_qual_reads = no_qual_reads;
+  this->no_qual_reads = tally.no_qual_reads;
   this->mean_pb_error = mean_error;
+  this->read_tally = tally;
+}
+
+void gram::ReadStats::compute_base_error_rate(GenomicRead_vector const& reads) {
+  ReadTally tally;
+  for (auto const& read : reads)
+    tally.add_read(read.seq.size(), encode_dna_bases(read.seq), read.qual);
+  compute_read_stats(tally);
 }
 
 ReadStats::haplogroup_cov ReadStats::get_max_cov_haplogroup(
@@ -162,6 +170,8 @@ void gram::AbstractReadStats::compute_coverage_depth(
 void gram::ReadStats::serialise(const std::string& json_output_fpath) {
   std::ofstream outf;
   outf.open(json_output_fpath);
+  // Enough digits for `deserialise` to restore the exact values
+  outf << std::setprecision(std::numeric_limits<double>::max_digits10);
 
   outf << R"(
 {
@@ -201,9 +211,66 @@ void gram::ReadStats::serialise(const std::string& json_output_fpath) {
     "No_qual_reads": )"
        << this->no_qual_reads;
 
+  nlohmann::json lengths = nlohmann::json::object();
+  for (auto const& entry : read_tally.length_histogram)
+    lengths[std::to_string(entry.first)] = entry.second;
+  outf << R"(
+    },)";
+
+  outf << R"(
+"Histograms":
+    {"Base_quality": )"
+       << nlohmann::json(read_tally.quality_histogram).dump() << ",";
+
+  outf << R"(
+    "Read_length": )"
+       << lengths.dump() << ",";
+
+  outf << R"(
+    "GC_percent": )"
+       << nlohmann::json(read_tally.gc_histogram).dump();
+
   outf << R"(
     }}
 )";
 
   outf.close();
 }
+
+void gram::ReadStats::deserialise(const std::string& json_input_fpath) {
+  std::ifstream inf(json_input_fpath);
+  if (!inf.is_open())
+    throw std::runtime_error("Cannot open read stats " + json_input_fpath);
+  nlohmann::json stats;
+  try {
+    inf >> stats;
+    auto const& read_depth = stats.at("Read_depth");
+    this->mean_cov_depth = read_depth.at("Mean").get<double>();
+    this->variance_cov_depth = read_depth.at("Variance").get<double>();
+    this->num_sites_noCov = read_depth.at("num_sites_noCov").get<std::size_t>();
+    this->num_sites_total = read_depth.at("num_sites_total").get<std::size_t>();
+    this->max_read_length = stats.at("Max_read_length").get<std::size_t>();
+    auto const& quality = stats.at("Quality");
+    this->mean_pb_error = quality.at("Error_rate_mean").get<double>();
+    this->num_bases_processed = quality.at("Num_bases").get<int64_t>();
+    this->no_qual_reads = quality.at("No_qual_reads").get<int64_t>();
+    // Absent from read stats written before histograms were tallied
+    auto const histograms = stats.find("Histograms");
+    if (histograms != stats.end()) {
+      read_tally = ReadTally{};
+      read_tally.quality_histogram =
+          histograms->at("Base_quality").get<ReadTally::QualityHistogram>();
+      for (auto const& entry : histograms->at("Read_length").items())
+        read_tally.length_histogram[std::stoul(entry.key())] =
+            entry.value().get<uint64_t>();
+      read_tally.gc_histogram =
+          histograms->at("GC_percent").get<ReadTally::GcHistogram>();
+      for (auto const& entry : read_tally.length_histogram)
+        read_tally.num_reads += entry.second;
+      read_tally.no_qual_reads = this->no_qual_reads;
+    }
+  } catch (nlohmann::json::exception const& e) {
+    throw std::runtime_error("Invalid read stats " + json_input_fpath + ": " +
+                             e.what());
+  }
+}
@@ -7,13 +7,15 @@
 #include "genotype/genotype.hpp"
 #include "genotype/parameters.hpp"
 #include "prg/prg_info.hpp"
+#include "serve/parameters.hpp"
+#include "serve/serve.hpp"
 #include "simulate/parameters.hpp"
 #include "simulate/simulate.hpp"
 
 using namespace gram;
 
 namespace gram {
-enum class Command { build, genotype, simulate };
+enum class Command { build, genotype, simulate, serve };
 
 struct top_level_params {
   po::variables_map vm;
@@ -45,6 +47,12 @@ int main(int argc, const char *const *argv) {
     commands::simulate::run(simu_params);
   }
 
+  else if (command_params.command == Command::serve) {
+    ServeParams serve_params = commands::serve::parse_parameters(
+        command_params.vm, command_params.parsed);
+    commands::serve::run(serve_params, debug);
+  }
+
   return 0;
 }
 
@@ -52,7 +60,7 @@ top_level_params gram::parse_command_line_parameters(int argc,
                                                      const char *const *argv) {
   po::options_description global("Gramtools! Global options");
   global.add_options()("command", po::value<std::string>(),
-                       "command to execute: {build, genotype, simulate}")(
+                       "command to execute: {build, genotype, simulate, serve}")(
       "subargs", po::value<std::vector<std::string> >(),
       "arguments to command")("help", "Produce this help message")(
       "debug", po::bool_switch()->default_value(false), "Turn on debug output");
@@ -90,6 +98,8 @@ top_level_params gram::parse_command_line_parameters(int argc,
     cmd = Command::genotype;
   else if (cmd_string == "simulate")
     cmd = Command::simulate;
+  else if (cmd_string == "serve")
+    cmd = Command::serve;
   else {
     std::cout << "Unrecognised command: " << cmd_string << std::endl;
     std::cout << global << std::endl;
@@ -62,6 +62,14 @@ coverage_Graph::coverage_Graph(PRG_String const& vec_in) {
   par_map.empty() ? is_nested = false : is_nested = true;
 }
 
+void coverage_Graph::clear_coverage() {
+  // Each node is reached through the access entry of its first character
+  for (auto const& entry : random_access) {
+    if (entry.offset == 0 && entry.node != nullptr)
+      entry.node->clear_coverage();
+  }
+}
+
 bool operator==(coverage_Graph const& f, coverage_Graph const& s) {
   // Test that the random_access vectors are the same, by testing each node
   node_access first;
@@ -201,7 +201,7 @@ marker_vec gram::prg_string_to_ints(std::string const &string_prg) {
                     << " is not a nucleotide char";
           exit(1);
         }
-        encoded_prg[char_count++] = encode_dna_base(c);
+        encoded_prg[char_count++] = base;
         break;
       }
     }
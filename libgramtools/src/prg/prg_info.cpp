@@ -1,5 +1,7 @@
 #include "prg/prg_info.hpp"
 #include "build/kmer_index/masks.hpp"
+#include "common/huge_pages.hpp"
+#include "common/instrumentation.hpp"
 
 using namespace gram;
 
@@ -25,5 +27,65 @@ PRG_Info gram::load_prg_info(CommonParameters const &parameters) {
   prg_info.rank_bwt_g = sdsl::rank_support_v<1>(&prg_info.dna_bwt_masks.mask_g);
   prg_info.rank_bwt_t = sdsl::rank_support_v<1>(&prg_info.dna_bwt_masks.mask_t);
 
+  if (parameters.huge_pages) {
+    auto const num_bytes = back_with_huge_pages(prg_info);
+    std::cout << "Collapsed " << num_bytes / huge_page_size
+              << " huge pages for the PRG indices" << std::endl;
+  }
   return prg_info;
 }
+
+uint64_t gram::back_with_huge_pages(PRG_Info const &prg_info) {
+  auto const &masks = prg_info.dna_bwt_masks;
+  std::pair<std::string, uint64_t> const collapsed[] = {
+      {"fm_index.sa_sample", advise_huge_pages(prg_info.fm_index.sa_sample)},
+      {"fm_index.wavelet_tree",
+       advise_huge_pages(prg_info.fm_index.wavelet_tree.tree)},
+      {"dna_bwt_masks",
+       advise_huge_pages(masks.mask_a) + advise_huge_pages(masks.mask_c) +
+           advise_huge_pages(masks.mask_g) + advise_huge_pages(masks.mask_t)},
+      {"bwt_markers_mask", advise_huge_pages(prg_info.bwt_markers_mask)},
+      {"coverage_graph.random_access",
+       advise_huge_pages(prg_info.coverage_graph.random_access)}};
+
+  uint64_t total_bytes = 0;
+  for (auto const &[structure, num_bytes] : collapsed) {
+    instrumentation::record_huge_pages(structure, num_bytes);
+    total_bytes += num_bytes;
+  }
+  return total_bytes;
+}
+
+PRG_Info gram::copy_prg_info_for_mapping(PRG_Info const &prg_info) {
+  PRG_Info copy;
+  copy.fm_index = prg_info.fm_index;
+  copy.encoded_prg = prg_info.encoded_prg;
+  copy.last_allele_positions = prg_info.last_allele_positions;
+
+  auto const &coverage_graph = prg_info.coverage_graph;
+  copy.coverage_graph.root = coverage_graph.root;
+  copy.coverage_graph.par_map = coverage_graph.par_map;
+  copy.coverage_graph.random_access = coverage_graph.random_access;
+  copy.coverage_graph.target_map = coverage_graph.target_map;
+  copy.coverage_graph.is_nested = coverage_graph.is_nested;
+  copy.num_variant_sites = prg_info.num_variant_sites;
+
+  copy.bwt_markers_mask = prg_info.bwt_markers_mask;
+  copy.markers_mask_count_set_bits = prg_info.markers_mask_count_set_bits;
+
+  // Rank and select supports are re-pointed at the copy's bit vectors
+  copy.dna_bwt_masks = prg_info.dna_bwt_masks;
+  copy.rank_bwt_a = sdsl::rank_support_v<1>(&copy.dna_bwt_masks.mask_a);
+  copy.rank_bwt_c = sdsl::rank_support_v<1>(&copy.dna_bwt_masks.mask_c);
+  copy.rank_bwt_g = sdsl::rank_support_v<1>(&copy.dna_bwt_masks.mask_g);
+  copy.rank_bwt_t = sdsl::rank_support_v<1>(&copy.dna_bwt_masks.mask_t);
+
+  copy.sites_mask = prg_info.sites_mask;
+  copy.allele_mask = prg_info.allele_mask;
+  copy.prg_markers_mask = prg_info.prg_markers_mask;
+  copy.prg_markers_rank = prg_info.prg_markers_rank;
+  copy.prg_markers_rank.set_vector(&copy.prg_markers_mask);
+  copy.prg_markers_select = prg_info.prg_markers_select;
+  copy.prg_markers_select.set_vector(&copy.prg_markers_mask);
+  return copy;
+}
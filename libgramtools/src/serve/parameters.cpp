@@ -0,0 +1,56 @@
+#include "serve/parameters.hpp"
+
+#include <omp.h>
+
+#include <iostream>
+
+using namespace gram;
+
+ServeParams commands::serve::parse_parameters(
+    po::variables_map &vm, const po::parsed_options &parsed) {
+  ServeParams parameters;
+  std::string numa_policy;
+
+  po::options_description serve_description("serve options");
+  serve_description.add_options()(
+      "gram_dir", po::value<std::string>(&parameters.gram_dirpath)->required(),
+      "gramtools directory")(
+      "kmer_size", po::value<uint32_t>(&parameters.kmers_size)->required(),
+      "kmer size that got used in build step")(
+      "socket", po::value<std::string>(&parameters.socket_fpath)->required(),
+      "path of the unix domain socket to listen on for genotyping jobs")(
+      "max_threads", po::value<uint32_t>()->default_value(1),
+      "maximum number of threads used by each job")(
+      "numa", po::value<std::string>(&numa_policy)->default_value("none"),
+      "placement of the PRG and kmer indices on multi-socket (NUMA) machines. "
+      "Choices: {none, interleave (spread their memory over the nodes), "
+      "replicate (copy them to each node)}. Mapping threads are then pinned "
+      "to nodes.")(
+      "huge_pages",
+      po::bool_switch(&parameters.huge_pages)->default_value(false),
+      "back the PRG indices with 2 MB transparent huge pages, for fewer TLB "
+      "misses in read mapping");
+
+  std::vector<std::string> opts =
+      po::collect_unrecognized(parsed.options, po::include_positional);
+  if (opts.size() > 0)
+    opts.erase(opts.begin());  // Takes out the command itself
+  try {
+    po::store(po::command_line_parser(opts).options(serve_description).run(),
+              vm);
+    po::notify(vm);
+    parameters.numa_policy = parse_numa_policy(numa_policy);
+  } catch (const std::exception &e) {
+    std::cout << e.what() << std::endl;
+    std::cout << serve_description << std::endl;
+    exit(1);
+  }
+
+  fill_common_parameters(parameters, parameters.gram_dirpath);
+  parameters.socket_fpath =
+      fs::absolute(fs::path(parameters.socket_fpath)).string();
+
+  parameters.maximum_threads = vm["max_threads"].as<uint32_t>();
+  omp_set_num_threads(parameters.maximum_threads);
+  return parameters;
+}
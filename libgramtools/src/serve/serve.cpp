@@ -0,0 +1,375 @@
+#include "serve/serve.hpp"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "build/kmer_index/load.hpp"
+#include "common/instrumentation.hpp"
+#include "common/numa.hpp"
+#include "genotype/genotype.hpp"
+
+using namespace gram;
+using namespace gram::serve;
+
+GenotypeParams gram::serve::make_job_parameters(
+    JSON const& request, CommonParameters const& server_parameters) {
+  if (!request.is_object())
+    throw ServeRequestException("request is not a JSON object");
+  auto const get_string = [&request](std::string const& key) {
+    if (!request.contains(key) || !request.at(key).is_string() ||
+        request.at(key).get<std::string>().empty())
+      throw ServeRequestException("request needs a non-empty \"" + key +
+                                  "\" string");
+    return request.at(key).get<std::string>();
+  };
+
+  GenotypeParams job_parameters;
+  static_cast<CommonParameters&>(job_parameters) = server_parameters;
+  job_parameters.sample_id = get_string("sample_id");
+
+  if (request.contains("from_coverage")) {
+    if (!request.at("from_coverage").is_boolean())
+      throw ServeRequestException("\"from_coverage\" must be a boolean");
+    job_parameters.from_coverage = request.at("from_coverage").get<bool>();
+  }
+
+  if (job_parameters.from_coverage) {
+    if (request.contains("reads"))
+      throw ServeRequestException(
+          "\"reads\" cannot be given with \"from_coverage\"");
+  } else {
+    if (!request.contains("reads") || !request.at("reads").is_array() ||
+        request.at("reads").empty())
+      throw ServeRequestException(
+          "request needs a non-empty \"reads\" array of file paths");
+    for (auto const& reads_fpath : request.at("reads")) {
+      if (!reads_fpath.is_string())
+        throw ServeRequestException("\"reads\" entries must be file paths");
+      job_parameters.reads_fpaths.push_back(
+          fs::absolute(fs::path(reads_fpath.get<std::string>())).string());
+    }
+  }
+
+  auto const ploidy = get_string("ploidy");
+  if (ploidy == "haploid")
+    job_parameters.ploidy = Ploidy::Haploid;
+  else if (ploidy == "diploid")
+    job_parameters.ploidy = Ploidy::Diploid;
+  else
+    throw ServeRequestException("Invalid/unsupported ploidy: " + ploidy);
+
+  if (request.contains("seed")) {
+    auto const& seed = request.at("seed");
+    if (!seed.is_number_integer() || seed.get<int64_t>() < 0 ||
+        seed.get<uint64_t>() > std::numeric_limits<SeedSize>::max())
+      throw ServeRequestException(
+          "\"seed\" must be a positive integer, of at most 32 bits");
+    job_parameters.seed = seed.get<SeedSize>();
+  }
+
+  if (request.contains("paired")) {
+    if (!request.at("paired").is_boolean())
+      throw ServeRequestException("\"paired\" must be a boolean");
+    job_parameters.paired = request.at("paired").get<bool>();
+    if (job_parameters.paired && job_parameters.reads_fpaths.size() % 2 != 0)
+      throw ServeRequestException(
+          "\"paired\" requires an even number of \"reads\" files");
+  }
+  if (request.contains("max_insert_size")) {
+    auto const& max_insert_size = request.at("max_insert_size");
+    if (!max_insert_size.is_number_integer() ||
+        max_insert_size.get<int64_t>() < 0)
+      throw ServeRequestException(
+          "\"max_insert_size\" must be a positive integer");
+    job_parameters.max_insert_size = max_insert_size.get<uint64_t>();
+  }
+  if (request.contains("subsample_fraction")) {
+    auto const& fraction = request.at("subsample_fraction");
+    if (!fraction.is_number() || !(fraction.get<double>() > 0) ||
+        fraction.get<double>() > 1)
+      throw ServeRequestException(
+          "\"subsample_fraction\" must be a number in (0, 1]");
+    job_parameters.subsample_fraction = fraction.get<double>();
+  }
+  if (request.contains("max_mean_depth")) {
+    auto const& max_mean_depth = request.at("max_mean_depth");
+    if (!max_mean_depth.is_number() || max_mean_depth.get<double>() < 0)
+      throw ServeRequestException(
+          "\"max_mean_depth\" must be a non-negative number");
+    job_parameters.max_mean_depth = max_mean_depth.get<double>();
+  }
+
+  auto const output_dirpath =
+      fs::absolute(fs::path(get_string("output_dir"))).string();
+  fs::create_directories(output_dirpath);
+  job_parameters.genotype_dirpath = output_dirpath;
+  job_parameters.instrumentation_fpath =
+      full_path(output_dirpath, "instrumentation.json");
+  commands::genotype::set_sample_output_paths(job_parameters, output_dirpath);
+  return job_parameters;
+}
+
+JSON gram::serve::make_job_response(GenotypeParams const& job_parameters,
+                                    QuasimapReadsStats const& stats) {
+  return JSON{{"status", "ok"},
+              {"sample_id", job_parameters.sample_id},
+              {"output_dir", job_parameters.genotype_dirpath},
+              {"stats",
+               {{"all_reads_count", stats.all_reads_count},
+                {"skipped_reads_count", stats.skipped_reads_count},
+                {"missing_kmer_reads_count", stats.missing_kmer_reads_count},
+                {"no_extension_reads_count", stats.no_extension_reads_count},
+                {"exact_mapped_reads_count", stats.exact_mapped_reads_count},
+                {"unpaired_reads_count", stats.unpaired_reads_count},
+                {"unpaired_repetitive_reads_count",
+                 stats.unpaired_repetitive_reads_count},
+                {"subsampled_out_reads_count",
+                 stats.subsampled_out_reads_count}}}};
+}
+
+JSON gram::serve::make_error_response(std::string const& message) {
+  return JSON{{"status", "error"}, {"message", message}};
+}
+
+std::optional<std::future<JSON>> JobQueue::push(GenotypeParams job_parameters) {
+  std::future<JSON> response;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (closed) return std::nullopt;
+    jobs.push_back(GenotypeJob{std::move(job_parameters), {}});
+    response = jobs.back().response.get_future();
+  }
+  job_available.notify_one();
+  return response;
+}
+
+bool JobQueue::pop(GenotypeJob& job) {
+  std::unique_lock<std::mutex> lock(mutex);
+  job_available.wait(lock, [this] { return closed || !jobs.empty(); });
+  if (jobs.empty()) return false;
+  job = std::move(jobs.front());
+  jobs.pop_front();
+  return true;
+}
+
+void JobQueue::close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+  }
+  job_available.notify_all();
+}
+
+namespace {
+/**
+ * Reads from `fd` up to the next newline, keeping any further bytes read in
+ * `pending`. Returns false at the end of the stream.
+ */
+bool read_line(int fd, std::string& pending, std::string& line) {
+  std::size_t newline_pos;
+  while ((newline_pos = pending.find('\n')) == std::string::npos) {
+    char chunk[4096];
+    auto const num_read = ::recv(fd, chunk, sizeof(chunk), 0);
+    if (num_read < 0 && errno == EINTR) continue;
+    if (num_read <= 0) return false;
+    pending.append(chunk, num_read);
+  }
+  line = pending.substr(0, newline_pos);
+  pending.erase(0, newline_pos + 1);
+  return true;
+}
+
+void write_line(int fd, std::string const& line) {
+  std::string const data = line + '\n';
+  std::size_t num_written{0};
+  while (num_written < data.size()) {
+    auto const result = ::send(fd, data.data() + num_written,
+                               data.size() - num_written, MSG_NOSIGNAL);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      return;  // The client has gone
+    }
+    num_written += result;
+  }
+}
+
+}  // namespace
+
+void SocketServer::accept_clients() {
+  while (true) {
+    int const client_fd = ::accept(listen_fd, nullptr, nullptr);
+    if (client_fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      return;  // The listening socket has been shut down
+    }
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    if (stopping) {
+      ::close(client_fd);
+      return;
+    }
+    client_fds.insert(client_fd);
+    std::thread(&SocketServer::serve_client, this, client_fd).detach();
+  }
+}
+
+void SocketServer::serve_client(int client_fd) {
+  std::string pending, line;
+  while (read_line(client_fd, pending, line)) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+    write_line(client_fd, handle_request(line).dump());
+  }
+  std::lock_guard<std::mutex> lock(clients_mutex);
+  ::close(client_fd);
+  client_fds.erase(client_fd);
+  clients_done.notify_all();
+}
+
+JSON SocketServer::handle_request(std::string const& line) {
+  JSON request;
+  try {
+    request = JSON::parse(line);
+  } catch (JSON::parse_error const& e) {
+    return make_error_response(std::string("invalid JSON: ") + e.what());
+  }
+
+  if (request.is_object() && request.contains("command")) {
+    if (request.at("command") != "shutdown")
+      return make_error_response("unknown command " +
+                                 request.at("command").dump());
+    std::cout << "Received shutdown request" << std::endl;
+    queue.close();
+    stop_accepting();
+    return JSON{{"status", "ok"}};
+  }
+
+  GenotypeParams job_parameters;
+  try {
+    job_parameters = make_job_parameters(request, server_parameters);
+  } catch (std::exception const& e) {
+    return make_error_response(e.what());
+  }
+  auto response = queue.push(std::move(job_parameters));
+  if (!response) return make_error_response("server is shutting down");
+  return response->get();
+}
+
+void SocketServer::stop_accepting() { ::shutdown(listen_fd, SHUT_RDWR); }
+
+SocketServer::SocketServer(std::string const& socket_fpath,
+                           CommonParameters const& server_parameters,
+                           JobQueue& queue)
+    : socket_fpath(socket_fpath),
+      server_parameters(server_parameters),
+      queue(queue) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socket_fpath.size() >= sizeof(address.sun_path))
+    throw std::runtime_error("Socket path is too long: " + socket_fpath);
+  std::strncpy(address.sun_path, socket_fpath.c_str(),
+               sizeof(address.sun_path) - 1);
+
+  // Only a stale socket, eg left by a killed server, is replaced
+  struct stat existing;
+  if (::lstat(socket_fpath.c_str(), &existing) == 0) {
+    if (!S_ISSOCK(existing.st_mode))
+      throw std::runtime_error("Cannot listen on " + socket_fpath +
+                               ": file exists and is not a socket");
+    ::unlink(socket_fpath.c_str());
+  }
+
+  listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0)
+    throw std::runtime_error(std::string("Cannot create socket: ") +
+                             std::strerror(errno));
+  // Connecting needs write permission on the socket: only give it to the user
+  auto const previous_umask = ::umask(0077);
+  auto const bound = ::bind(listen_fd, reinterpret_cast<sockaddr*>(&address),
+                            sizeof(address)) == 0;
+  ::umask(previous_umask);
+  if (!bound || ::listen(listen_fd, SOMAXCONN) < 0) {
+    auto const error = std::string(std::strerror(errno));
+    ::close(listen_fd);
+    throw std::runtime_error("Cannot listen on " + socket_fpath + ": " +
+                             error);
+  }
+  accept_thread = std::thread(&SocketServer::accept_clients, this);
+}
+
+SocketServer::~SocketServer() {
+  {
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    stopping = true;
+  }
+  stop_accepting();
+  accept_thread.join();
+  ::close(listen_fd);
+  ::unlink(socket_fpath.c_str());
+
+  std::unique_lock<std::mutex> lock(clients_mutex);
+  // Unblocks clients waiting for their next request
+  for (auto const client_fd : client_fds) ::shutdown(client_fd, SHUT_RD);
+  clients_done.wait(lock, [this] { return client_fds.empty(); });
+}
+
+void gram::commands::serve::run(ServeParams const& parameters,
+                                bool const& debug) {
+  std::cout << "Executing serve command" << std::endl;
+  std::optional<ScopedInterleave> interleave;
+  interleave.emplace(parameters.numa_policy == NumaPolicy::interleave);
+  std::cout << "Loading PRG data" << std::endl;
+  auto prg_info = load_prg_info(parameters);
+  std::cout << "Loading kmer index data" << std::endl;
+  const auto kmer_index = kmer_index::load(parameters);
+  interleave.reset();
+  // The indices are replicated once, for all jobs
+  IndexReplicas const indices(prg_info, kmer_index, parameters.numa_policy,
+                              parameters.huge_pages);
+
+  JobQueue queue;
+  std::optional<SocketServer> server;
+  try {
+    server.emplace(parameters.socket_fpath, parameters, queue);
+  } catch (std::runtime_error const& e) {
+    std::cout << e.what() << std::endl;
+    exit(1);
+  }
+  std::cout << "Listening for genotyping jobs on " << parameters.socket_fpath
+            << std::endl;
+  // Mapping threads are pinned after the server's threads are started, which
+  // are left unpinned
+  std::optional<PinnedThreads> pinned_threads;
+  if (parameters.numa_policy != NumaPolicy::none) pinned_threads.emplace();
+
+  // Jobs are run one at a time, each using all threads: per base coverage is
+  // recorded in the shared coverage graph, which is cleared after each job.
+  GenotypeJob job;
+  while (queue.pop(job)) {
+    std::cout << "====================" << std::endl
+              << "Genotyping sample " << job.parameters.sample_id
+              << std::endl;
+    // Each job's instrumentation report only covers that job
+    instrumentation::reset();
+    JSON response;
+    try {
+      TimerReport timer;
+      auto const stats = gram::genotype::genotype_sample(
+          job.parameters, indices, debug, timer);
+      timer.report();
+      instrumentation::write_report(job.parameters.instrumentation_fpath);
+      response = make_job_response(job.parameters, stats);
+    } catch (std::exception const& e) {
+      response = make_error_response(e.what());
+    }
+    prg_info.coverage_graph.clear_coverage();
+    job.response.set_value(response);
+  }
+  server.reset();
+  std::cout << "Server stopped" << std::endl;
+}
@@ -1,28 +1,28 @@
 /**
  * @file Combine JSON genotyped files into one
  */
+#include <omp.h>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 
-#include <nlohmann/json.hpp>
-
-#include "genotype/infer/output_specs/json_prg_spec.hpp"
+#include "genotype/infer/output_specs/json_prg_combine.hpp"
 
 namespace fs = std::filesystem;
-using JSON = nlohmann::json;
 using namespace gram::json;
 
 void usage(const char* argv[]) {
-  std::cout << "Usage: " << argv[0] << " fofn fout" << std::endl;
+  std::cout << "Usage: " << argv[0] << " fofn fout [max_threads]" << std::endl;
   std::cout << "\t fofn: file of file names of the JSON files to combine"
             << std::endl;
   std::cout << "\t fout: name of output combined JSON file" << std::endl;
+  std::cout << "\t max_threads: number of groups of files to merge in parallel"
+            << " (default: 1)" << std::endl;
   exit(1);
 }
 
 int main(int argc, const char* argv[]) {
-  if (argc != 3) usage(argv);
+  if (argc != 3 && argc != 4) usage(argv);
   fs::path fofn(argv[1]);
   if (!fs::exists(fofn)) {
     std::cout << fofn << " not found.";
@@ -32,34 +32,25 @@ int main(int argc, const char* argv[]) {
     usage(argv);
   }
 
-  std::ofstream fout(argv[2]);
-  if (!fout.good()) {
+  if (!std::ofstream(argv[2]).good()) {
     std::cout << "Error: could not open " << argv[2] << std::endl;
     usage(argv);
   }
 
+  int max_threads{1};
+  if (argc == 4) max_threads = std::stoi(argv[3]);
+  omp_set_num_threads(max_threads);
+
   std::ifstream fin(fofn);
   std::string next_file;
-  JSON next_json;
-  Json_Prg combined_json;
-  bool first{true};
+  std::vector<std::string> fpaths;
   while (std::getline(fin, next_file)) {
-    std::ifstream next_istream(next_file);
-    if (!next_istream.good()) {
+    if (!std::ifstream(next_file).good()) {
       std::cout << "Error: Could not open JSON file " << next_file << std::endl;
       exit(1);
     }
-    next_json.clear();
-    next_istream >> next_json;
-    if (first) {
-      combined_json.set_prg(next_json);
-      first = false;
-    }
-
-    else {
-      Json_Prg next_prg(next_json);
-      combined_json.combine_with(next_prg);
-    }
+    fpaths.push_back(next_file);
   }
-  fout << combined_json.get_prg();
+
+  combine_json_prgs(fpaths, argv[2]);
 }
@@ -0,0 +1,44 @@
+/**
+ * @file Convert a genotyped JSON file between its text and binary encodings
+ */
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "genotype/infer/output_specs/binary_jvcf.hpp"
+
+namespace fs = std::filesystem;
+using namespace gram::json;
+
+void usage(const char* argv[]) {
+  std::cout << "Usage: " << argv[0] << " {to_binary|to_json} fin fout"
+            << std::endl;
+  std::cout << "\t to_binary: convert JSON file fin to binary file fout"
+            << std::endl;
+  std::cout << "\t to_json: convert binary file fin to JSON file fout"
+            << std::endl;
+  exit(1);
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc != 4) usage(argv);
+  std::string const direction{argv[1]};
+  if (direction != "to_binary" && direction != "to_json") usage(argv);
+
+  fs::path fin_path(argv[2]);
+  if (!fs::exists(fin_path)) {
+    std::cout << fin_path << " not found." << std::endl;
+    usage(argv);
+  }
+  std::ifstream fin(fin_path, std::ios::binary);
+  std::ofstream fout(argv[3], std::ios::binary);
+  if (!fout.good()) {
+    std::cout << "Error: could not open " << argv[3] << std::endl;
+    usage(argv);
+  }
+
+  if (direction == "to_binary")
+    json_to_binary_jvcf(fin, fout);
+  else
+    binary_to_json_jvcf(fin, fout);
+}
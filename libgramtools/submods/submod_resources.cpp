@@ -1,6 +1,9 @@
 #include "submod_resources.hpp"
 #include "build/kmer_index/masks.hpp"
 
+#include <filesystem>
+
+namespace fs = std::filesystem;
 using namespace gram::submods;
 
 std::string gram::submods::decode(const uint64_t base) {
@@ -19,10 +22,16 @@ std::string gram::submods::decode(const uint64_t base) {
 }
 
 PRG_Info gram::submods::generate_prg_info(const marker_vec& prg_raw) {
+  return generate_prg_info(prg_raw, "");
+}
+
+PRG_Info gram::submods::generate_prg_info(const marker_vec& prg_raw,
+                                          std::string const& dirpath) {
+  fs::path const dir{dirpath};
   BuildParams parameters = {};
-  parameters.encoded_prg_fpath = "encoded_prg_file_name";
-  parameters.fm_index_fpath = "fm_index";
-  parameters.gram_dirpath = "gram_dir";
+  parameters.encoded_prg_fpath = (dir / "encoded_prg_file_name").string();
+  parameters.fm_index_fpath = (dir / "fm_index").string();
+  parameters.gram_dirpath = (dir / "gram_dir").string();
 
   PRG_String ps{prg_raw};
   auto encoded_prg = ps.get_PRG_string();
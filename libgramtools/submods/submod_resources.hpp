@@ -6,6 +6,13 @@
 namespace gram::submods {
 gram::PRG_Info generate_prg_info(const marker_vec &prg_raw);
 
+/**
+ * As above, writing the files the data structures are built from under
+ * `dirpath` rather than the working directory.
+ */
+gram::PRG_Info generate_prg_info(const marker_vec &prg_raw,
+                                 std::string const &dirpath);
+
 std::string decode(uint64_t base);
 
 using covG_ptrPair = std::pair<covG_ptr, covG_ptr>;
@@ -0,0 +1,90 @@
+#include <cctype>
+#include <random>
+
+#include "common/dna_kernels.hpp"
+#include "genotype/quasimap/read_view.hpp"
+#include "gtest/gtest.h"
+
+using namespace gram;
+
+namespace {
+std::vector<SimdLevel> supported_levels() {
+  std::vector<SimdLevel> levels;
+  for (auto level : {SimdLevel::scalar, SimdLevel::sse4, SimdLevel::avx2})
+    if (static_cast<int>(level) <= static_cast<int>(best_simd_level()))
+      levels.push_back(level);
+  return levels;
+}
+
+std::string random_bases(std::size_t length, std::mt19937 &generator) {
+  std::string const alphabet{"ACGTacgt"};
+  std::uniform_int_distribution<std::size_t> draw(0, alphabet.size() - 1);
+  std::string bases(length, 'A');
+  for (auto &base : bases) base = alphabet[draw(generator)];
+  return bases;
+}
+}  // namespace
+
+TEST(DnaKernels, EncodeBases_SameAsEncodeDnaBase) {
+  std::mt19937 generator(0);
+  // Lengths covering vector bodies and scalar tails
+  for (std::size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+    auto const bases = random_bases(length, generator);
+    Sequence expected;
+    for (auto base : bases) expected.push_back(encode_dna_base(base));
+    for (auto level : supported_levels()) {
+      Sequence encoded(length);
+      EXPECT_TRUE(
+          get_dna_kernels(level).encode(bases.data(), length, encoded.data()));
+      EXPECT_EQ(encoded, expected);
+    }
+  }
+}
+
+TEST(DnaKernels, EncodeNonDnaBase_ReturnsFalse) {
+  std::mt19937 generator(0);
+  for (std::size_t position : {0, 15, 31, 32, 40}) {
+    auto bases = random_bases(41, generator);
+    bases[position] = 'N';
+    for (auto level : supported_levels()) {
+      Sequence encoded(bases.size());
+      EXPECT_FALSE(get_dna_kernels(level).encode(bases.data(), bases.size(),
+                                                 encoded.data()));
+    }
+  }
+}
+
+TEST(DnaKernels, DecodeBases_InverseOfEncoding) {
+  std::mt19937 generator(0);
+  for (std::size_t length : {0, 7, 16, 47, 64}) {
+    auto bases = random_bases(length, generator);
+    for (auto &base : bases) base = std::toupper(base);
+    auto const encoded = encode_dna_bases(bases);
+    for (auto level : supported_levels()) {
+      std::string decoded(length, ' ');
+      get_dna_kernels(level).decode(encoded.data(), length, decoded.data());
+      EXPECT_EQ(decoded, bases);
+    }
+  }
+}
+
+TEST(DnaKernels, DecodeDnaBases_NonBasesDecodedToN) {
+  Sequence const encoded{1, 2, 0, 3, 4, 9};
+  EXPECT_EQ(decode_dna_bases(encoded), "ACNGTN");
+}
+
+TEST(DnaKernels, ReverseComplement_SameAsPerBaseComplement) {
+  std::mt19937 generator(0);
+  for (std::size_t length : {0, 1, 16, 17, 32, 33, 70}) {
+    auto encoded = encode_dna_bases(random_bases(length, generator));
+    if (length > 0) encoded.front() = 0;  // Not a base: complemented to 0
+    Sequence expected(encoded.rbegin(), encoded.rend());
+    for (auto &base : expected) base = complement_encoded_base(base);
+    for (auto level : supported_levels()) {
+      Sequence reverse(length);
+      get_dna_kernels(level).reverse_complement(encoded.data(), length,
+                                                reverse.data());
+      EXPECT_EQ(reverse, expected);
+    }
+  }
+}
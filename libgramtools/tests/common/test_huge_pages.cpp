@@ -0,0 +1,17 @@
+#include "common/huge_pages.hpp"
+#include "gtest/gtest.h"
+
+using namespace gram;
+
+TEST(AdviseHugePages, GivenRangeSmallerThanHugePage_NothingCollapsed) {
+  std::vector<char> const small(huge_page_size / 2);
+  EXPECT_EQ(advise_huge_pages(small), 0);
+}
+
+TEST(AdviseHugePages, GivenLargeRange_OnlyWholeAlignedHugePagesCollapsed) {
+  std::vector<uint64_t> const large(5 * huge_page_size / sizeof(uint64_t));
+  auto const result = advise_huge_pages(large);
+  // Nothing is collapsed where the kernel does not support collapsing
+  EXPECT_EQ(result % huge_page_size, 0);
+  EXPECT_LE(result, 5 * huge_page_size);
+}
@@ -0,0 +1,81 @@
+#include <thread>
+#include <vector>
+
+#include "common/instrumentation.hpp"
+#include "gtest/gtest.h"
+
+using namespace gram;
+using namespace gram::instrumentation;
+
+namespace {
+uint64_t total(Counter counter) {
+  return report()["counters"][counter_name(counter)].get<uint64_t>();
+}
+
+nlohmann::json find_span(std::string const& name) {
+  auto const spans = report()["spans"];
+  for (auto const& span : spans)
+    if (span["name"] == name) return span;
+  return nullptr;
+}
+}  // namespace
+
+TEST(Instrumentation, CountFromSeveralThreads_TotalIsSumOfCounts) {
+  auto const before = total(Counter::vbwt_jumps);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i)
+    threads.emplace_back([] {
+      for (int j = 0; j < 1000; ++j) count(Counter::vbwt_jumps);
+    });
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(total(Counter::vbwt_jumps), before + 4000);
+}
+
+TEST(Instrumentation, LocalCount_AddedWhenDestroyed) {
+  auto const before = total(Counter::bases_extended);
+  {
+    LocalCount bases_extended(Counter::bases_extended);
+    bases_extended += 10;
+    ++bases_extended;
+    EXPECT_EQ(total(Counter::bases_extended), before);
+  }
+  EXPECT_EQ(total(Counter::bases_extended), before + 11);
+}
+
+TEST(Instrumentation, SpanInSpan_Nested) {
+  {
+    Span outer("NestingTestOuter");
+    Span inner("NestingTestInner");
+  }
+  auto const outer = find_span("NestingTestOuter");
+  ASSERT_FALSE(outer.is_null());
+  ASSERT_EQ(outer["children"].size(), 1);
+  EXPECT_EQ(outer["children"][0]["name"], "NestingTestInner");
+  EXPECT_TRUE(find_span("NestingTestInner").is_null());
+  EXPECT_GE(outer["wall_seconds"].get<double>(),
+            outer["children"][0]["wall_seconds"].get<double>());
+}
+
+TEST(Instrumentation, Report_HasPeakMemory) {
+  EXPECT_GT(report()["peak_rss_bytes"].get<uint64_t>(), 0);
+}
+
+TEST(Instrumentation, RecordHugePages_BytesAddUpPerStructure) {
+  record_huge_pages("test_structure", 2048);
+  record_huge_pages("test_structure", 1024);
+  EXPECT_EQ(report()["huge_page_bytes"]["test_structure"].get<uint64_t>(),
+            3072);
+}
+
+TEST(Instrumentation, Reset_SpansAndCountsDiscarded) {
+  count(Counter::coverage_records, 5);
+  { Span span("ResetTestSpan"); }
+  ASSERT_FALSE(find_span("ResetTestSpan").is_null());
+
+  reset();
+  EXPECT_TRUE(report()["spans"].empty());
+  EXPECT_EQ(total(Counter::coverage_records), 0);
+  count(Counter::coverage_records);
+  EXPECT_EQ(total(Counter::coverage_records), 1);
+}
@@ -0,0 +1,93 @@
+#include <sched.h>
+
+#include <fstream>
+#include <thread>
+
+#include "common/numa.hpp"
+#include "common/parameters.hpp"
+#include "gtest/gtest.h"
+
+using namespace gram;
+
+TEST(ParseNumaPolicy, GivenPolicyNames_CorrectPolicies) {
+  EXPECT_EQ(parse_numa_policy("none"), NumaPolicy::none);
+  EXPECT_EQ(parse_numa_policy("interleave"), NumaPolicy::interleave);
+  EXPECT_EQ(parse_numa_policy("replicate"), NumaPolicy::replicate);
+  EXPECT_THROW(parse_numa_policy("local"), std::invalid_argument);
+}
+
+TEST(ParseCpuList, GivenRangesAndSingleCpus_AllCpusListed) {
+  EXPECT_EQ(parse_cpu_list("0-3,8,10-11\n"),
+            (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_TRUE(parse_cpu_list("").empty());
+}
+
+TEST(ParseCpuList, GivenMalformedList_Throws) {
+  EXPECT_THROW(parse_cpu_list("0-"), std::invalid_argument);
+  EXPECT_THROW(parse_cpu_list("3-1"), std::invalid_argument);
+  EXPECT_THROW(parse_cpu_list("1a"), std::invalid_argument);
+}
+
+TEST(ReadNumaNodes, GivenSysfsNodeDir_NodesWithCpusRead) {
+  auto const node_dirpath = fs::temp_directory_path() / "test_numa_nodes";
+  fs::remove_all(node_dirpath);
+  std::vector<std::pair<std::string, std::string>> const node_cpus{
+      {"node1", "4-7"}, {"node0", "0-3"}, {"node2", ""}};
+  for (auto const &[node, cpu_list] : node_cpus) {
+    fs::create_directories(node_dirpath / node);
+    std::ofstream(node_dirpath / node / "cpulist") << cpu_list << '\n';
+  }
+  fs::create_directories(node_dirpath / "power");
+
+  auto const nodes = read_numa_nodes(node_dirpath.string());
+  fs::remove_all(node_dirpath);
+  // Sorted by node ID; the node without CPUs is left out
+  ASSERT_EQ(nodes.size(), 2);
+  EXPECT_EQ(nodes[0].id, 0);
+  EXPECT_EQ(nodes[0].cpus, (std::vector<int>{0, 1, 2, 3}));
+  EXPECT_EQ(nodes[1].id, 1);
+  EXPECT_EQ(nodes[1].cpus, (std::vector<int>{4, 5, 6, 7}));
+}
+
+TEST(ReadNumaNodes, GivenMissingDir_NoNodes) {
+  EXPECT_TRUE(read_numa_nodes("/non/existent/node/dir").empty());
+}
+
+TEST(NumaNodes, AlwaysAtLeastOneNode_CurrentNodeAmongThem) {
+  auto const &nodes = numa_nodes();
+  ASSERT_GE(nodes.size(), 1);
+  EXPECT_LT(current_numa_node_index(), nodes.size());
+}
+
+TEST(PinnedThreads, NodeIndex_ThreadsSpreadEvenlyInBlocks) {
+  std::vector<std::size_t> result;
+  for (std::size_t thread_num = 0; thread_num < 6; ++thread_num)
+    result.push_back(PinnedThreads::node_index(thread_num, 6, 2));
+  EXPECT_EQ(result, (std::vector<std::size_t>{0, 0, 0, 1, 1, 1}));
+
+  // More nodes than threads
+  EXPECT_EQ(PinnedThreads::node_index(1, 2, 4), 2);
+}
+
+TEST(ScopedUnpinned, GivenPinnedThread_StartedThreadsRunOnAllNodes) {
+  auto const &nodes = numa_nodes();
+  std::size_t num_cpus = 0;
+  for (auto const &node : nodes) num_cpus += node.cpus.size();
+  auto const num_thread_cpus = [] {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    sched_getaffinity(0, sizeof(cpu_set), &cpu_set);
+    return static_cast<std::size_t>(CPU_COUNT(&cpu_set));
+  };
+
+  std::thread([&] {
+    pin_current_thread(nodes.front());
+    std::size_t started_thread_cpus = 0;
+    {
+      ScopedUnpinned const unpinned;
+      std::thread([&] { started_thread_cpus = num_thread_cpus(); }).join();
+    }
+    EXPECT_EQ(started_thread_cpus, num_cpus);
+    EXPECT_EQ(num_thread_cpus(), nodes.front().cpus.size());
+  }).join();
+}
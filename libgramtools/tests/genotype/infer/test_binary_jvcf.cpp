@@ -0,0 +1,97 @@
+#include <sstream>
+#include "gtest/gtest.h"
+
+#include "genotype/infer/output_specs/binary_jvcf.hpp"
+#include "genotype/infer/output_specs/json_prg_spec.hpp"
+
+using namespace gram::json;
+
+class Binary_Jvcf : public ::testing::Test {
+ protected:
+  void SetUp() {
+    prg = gram::json::spec::json_prg;
+    prg.at("Model") = "LevelGenotyping";
+    prg.at("Lvl1_Sites") = JSON::array({0});
+    prg.at("Child_Map") = {{"0", {{"1", JSON::array({1})}}}};
+    prg.at("Samples") = JSON::array(
+        {{{"Name", "sample1"}, {"Desc", ""}},
+         {{"Name", "sample2"}, {"Desc", "second"}}});
+    prg.at("Sites").push_back(JSON::parse(R"({
+       "POS": 3, "SEG": "gene1", "ALS": ["CTCCT", "CTT", "GTT"],
+       "GT": [[0, 1], [null]], "HAPG": [[0, 1], []],
+       "COV": [[10.0, 2.0, 0.0], [0.0, 0.0, 0.0]], "DP": [12, 0],
+       "FT": [[], ["AMBIG", "LOW"]],
+       "GT_CONF": [3.25, 0.0], "GT_CONF_PERCENTILE": [10.5, 0.0]})"));
+    prg.at("Sites").push_back(JSON::parse(R"({
+       "POS": 50, "SEG": "gene2", "ALS": ["AAAAAAA", "CTT"],
+       "GT": [[1], [0]], "HAPG": [[1], [0]],
+       "COV": [[0.5, 18.25], [7.0, 0.0]], "DP": [24, 7],
+       "FT": [[], []], "GT_CONF": [1.0, 2.0], "GT_CONF_PERCENTILE": [1, 2]})"));
+    // Does not fit the columnar layout: number of samples differs across fields
+    prg.at("Sites").push_back(JSON::parse(R"({
+       "POS": 70, "SEG": "gene2", "ALS": ["A"], "GT": [[0]], "HAPG": [],
+       "COV": [[1.0]], "DP": [1], "FT": [[]]})"));
+  }
+
+  std::stringstream to_binary() {
+    std::stringstream json_in, binary;
+    json_in << prg;
+    json_to_binary_jvcf(json_in, binary);
+    return binary;
+  }
+
+  JSON prg;
+};
+
+TEST_F(Binary_Jvcf, GivenJsonToBinaryToJson_SameJson) {
+  auto binary = to_binary();
+  std::stringstream json_out;
+  binary_to_json_jvcf(binary, json_out);
+
+  EXPECT_EQ(JSON::parse(json_out.str()), prg);
+  std::stringstream expected;
+  expected << prg << std::endl;
+  EXPECT_EQ(json_out.str(), expected.str());
+}
+
+TEST_F(Binary_Jvcf, GivenBinaryJvcf_RandomAccessToSites) {
+  auto binary = to_binary();
+  Binary_Jvcf_Reader reader(binary);
+  auto expected_header = prg;
+  expected_header.at("Sites") = JSON::array();
+  EXPECT_EQ(reader.get_header(), expected_header);
+
+  ASSERT_EQ(reader.size(), 3);
+  EXPECT_EQ(reader.get_site(2), prg.at("Sites").at(2));
+  EXPECT_EQ(reader.get_site(0), prg.at("Sites").at(0));
+  EXPECT_EQ(reader.get_site(1), prg.at("Sites").at(1));
+  EXPECT_THROW(reader.get_site(3), BinaryJvcfException);
+}
+
+TEST_F(Binary_Jvcf, GivenRepeatedSites_MuchSmallerThanJson) {
+  auto const one_copy = to_binary().str().size();
+  auto const site = prg.at("Sites").at(0);
+  for (int i{0}; i < 10; i++) prg.at("Sites").push_back(site);
+  auto const eleven_copies = to_binary().str().size();
+
+  auto const site_json_size = site.dump().size();
+  EXPECT_LT(eleven_copies - one_copy, 10 * site_json_size / 3);
+}
+
+TEST_F(Binary_Jvcf, GivenNoSites_RoundTrips) {
+  prg.at("Sites") = JSON::array();
+  auto binary = to_binary();
+  Binary_Jvcf_Reader reader(binary);
+  EXPECT_EQ(reader.size(), 0);
+  EXPECT_EQ(reader.get_header(), prg);
+}
+
+TEST_F(Binary_Jvcf, GivenTruncatedFile_Throws) {
+  auto truncated = to_binary().str();
+  truncated.resize(truncated.size() - 3);
+  std::stringstream binary{truncated};
+  EXPECT_THROW(Binary_Jvcf_Reader{binary}, BinaryJvcfException);
+
+  std::stringstream not_binary{"{\"Sites\": []}"};
+  EXPECT_THROW(Binary_Jvcf_Reader{not_binary}, BinaryJvcfException);
+}
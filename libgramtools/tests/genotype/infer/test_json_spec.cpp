@@ -1,3 +1,8 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "genotype/infer/output_specs/json_prg_combine.hpp"
 #include "genotype/infer/output_specs/json_prg_spec.hpp"
 #include "genotype/infer/output_specs/json_site_spec.hpp"
 #include "genotype/infer/types.hpp"
@@ -6,6 +11,7 @@
 using namespace gram;
 using namespace gram::json;
 using namespace gram::genotype::infer;
+namespace fs = std::filesystem;
 
 namespace gram::json {
 bool operator==(site_rescaler const& first, site_rescaler const& second) {
@@ -79,6 +85,10 @@ class JSON_data_store {
 
     MockJsonSite sample2({"AAAAAAA", "A"}, {1}, {4}, {0, 18}, 24, 50, "gene2");
     site2_samples.push_back(std::make_shared<MockJsonSite>(sample2));
+
+    MockJsonSite sample3({"AAAAAAA", "AAA"}, {0}, {0}, {15, 3}, 20, 50,
+                         "gene2");
+    site2_samples.push_back(std::make_shared<MockJsonSite>(sample3));
   }
 
   void set_prgs() {
@@ -89,11 +99,15 @@ class JSON_data_store {
     prg2.set_sample_info("Dorp", "");
     prg2.add_site(site1_samples.at(1));
     prg2.add_site(site2_samples.at(1));
+
+    prg3.set_sample_info("Blorp", "");
+    prg3.add_site(site1_samples.at(2));
+    prg3.add_site(site2_samples.at(2));
   }
 
  public:
   json_site_vec site1_samples, site2_samples;
-  Json_Prg prg1, prg2;
+  Json_Prg prg1, prg2, prg3;
   JSON_data_store() {
     set_site1_samples();
     set_site2_samples();
@@ -337,3 +351,152 @@ TEST(PRG_Combine_Successs2_cpy, GivenTwoPrgs_CorrectCombined) {
   site2_sample1.combine_with(site2_sample2);
   EXPECT_EQ(data.prg1.get_prg().at("Sites").at(1), site2_sample1.get_site());
 }
+
+TEST(PRG_Json_Writer, GivenSitesWrittenOneByOne_SameAsSerialisedPrg) {
+  JSON_data_store data;
+  std::stringstream streamed;
+  Json_Prg_Writer writer(streamed, data.prg1.get_prg());
+  for (auto const& site : data.prg1.get_prg().at("Sites"))
+    writer.add_site(site);
+  writer.close();
+
+  std::stringstream expected;
+  expected << data.prg1.get_prg() << std::endl;
+  EXPECT_EQ(streamed.str(), expected.str());
+  EXPECT_EQ(JSON::parse(streamed.str()), data.prg1.get_prg());
+}
+
+TEST(PRG_Json_Writer, GivenNoSites_WritesEmptySitesArray) {
+  Json_Prg empty_prg;
+  std::stringstream streamed;
+  { Json_Prg_Writer writer(streamed, empty_prg.get_prg()); }
+  EXPECT_EQ(JSON::parse(streamed.str()), empty_prg.get_prg());
+}
+
+TEST(PRG_Json_Reader, GivenSerialisedPrg_ReadsHeaderThenSites) {
+  JSON_data_store data;
+  std::stringstream serialised;
+  serialised << data.prg1.get_prg();
+
+  Json_Prg_Reader reader(serialised);
+  JSON expected_header = data.prg1.get_prg();
+  expected_header.at("Sites") = JSON::array();
+  EXPECT_EQ(reader.get_header(), expected_header);
+
+  JSON site;
+  for (auto const& expected_site : data.prg1.get_prg().at("Sites")) {
+    ASSERT_TRUE(reader.next_site(site));
+    EXPECT_EQ(site, expected_site);
+  }
+  EXPECT_FALSE(reader.next_site(site));
+}
+
+TEST(PRG_Json_Reader, GivenSitesBeforeOtherEntries_ReadsFullHeader) {
+  JSON_data_store data;
+  auto const& prg = data.prg1.get_prg();
+  std::stringstream serialised;
+  serialised << "{ \"Sites\" : " << prg.at("Sites");
+  for (auto const& entry : prg.items())
+    if (entry.key() != "Sites")
+      serialised << ",\n \"" << entry.key() << "\": " << entry.value();
+  serialised << "}";
+
+  Json_Prg_Reader reader(serialised);
+  EXPECT_EQ(reader.get_header().at("Samples"), prg.at("Samples"));
+  JSON site;
+  std::size_t num_sites{0};
+  while (reader.next_site(site))
+    EXPECT_EQ(site, prg.at("Sites").at(num_sites++));
+  EXPECT_EQ(num_sites, prg.at("Sites").size());
+}
+
+TEST(PRG_Json_Reader, GivenTruncatedJson_Throws) {
+  std::stringstream serialised{"{\"Model\": \"M1\", \"Sites\": [{\"POS\": [1"};
+  EXPECT_THROW(
+      {
+        Json_Prg_Reader reader(serialised);
+        JSON site;
+        reader.next_site(site);
+      },
+      JSONConsistencyException);
+}
+
+class PRG_Json_Merge : public ::testing::Test {
+ protected:
+  void SetUp() {
+    tmp_dir = fs::temp_directory_path() / "gram_test_json_merge";
+    fs::create_directories(tmp_dir);
+    std::vector<Json_Prg*> prgs{&data.prg1, &data.prg2, &data.prg3};
+    for (std::size_t i{0}; i < prgs.size(); i++) {
+      fpaths.push_back((tmp_dir / ("prg" + std::to_string(i))).string());
+      std::ofstream fout(fpaths.back());
+      fout << prgs.at(i)->get_prg();
+    }
+  }
+  void TearDown() { fs::remove_all(tmp_dir); }
+
+  JSON combined_in_memory() {
+    JSON_data_store copy;
+    copy.prg1.combine_with(copy.prg2);
+    copy.prg1.combine_with(copy.prg3);
+    return copy.prg1.get_prg();
+  }
+
+  JSON_data_store data;
+  fs::path tmp_dir;
+  std::vector<std::string> fpaths;
+};
+
+TEST_F(PRG_Json_Merge, GivenThreePrgs_SameAsInMemoryCombine) {
+  std::stringstream merged;
+  merge_json_prgs(fpaths, merged);
+  EXPECT_EQ(JSON::parse(merged.str()), combined_in_memory());
+}
+
+TEST_F(PRG_Json_Merge, GivenTreeReduction_SameAsInMemoryCombine) {
+  auto out_fpath = (tmp_dir / "combined").string();
+  combine_json_prgs(fpaths, out_fpath, 2);
+  std::ifstream fin(out_fpath);
+  EXPECT_EQ(JSON::parse(fin), combined_in_memory());
+  EXPECT_FALSE(fs::exists(out_fpath + "_combine_tmp"));
+}
+
+TEST_F(PRG_Json_Merge, GivenSameSampleNamesInSeveralGroups_ForcedNamesUnique) {
+  fpaths.push_back((tmp_dir / "prg3").string());
+  for (auto const& fpath : fpaths) {
+    JSON prg = data.prg1.get_prg();
+    prg.at("Samples").at(0).at("Name") = "Same";
+    std::ofstream(fpath) << prg;
+  }
+  auto out_fpath = (tmp_dir / "combined").string();
+  EXPECT_THROW(combine_json_prgs(fpaths, out_fpath, 2),
+               JSONConsistencyException);
+
+  // Groups of 2 files are merged first
+  combine_json_prgs(fpaths, out_fpath, 2, true);
+  std::ifstream fin(out_fpath);
+  std::vector<std::string> names;
+  for (auto const& sample : JSON::parse(fin).at("Samples"))
+    names.push_back(sample.at("Name"));
+  std::vector<std::string> expected{"Same", "Same_1", "Same_2", "Same_3"};
+  EXPECT_EQ(names, expected);
+}
+
+TEST_F(PRG_Json_Merge, GivenUnwritableOutput_Throws) {
+  // Writes to /dev/full fail as on a full disk
+  EXPECT_THROW(combine_json_prgs(fpaths, "/dev/full"), JSONCombineException);
+  EXPECT_THROW(combine_json_prgs(fpaths, (tmp_dir / "no_dir" / "out").string()),
+               JSONCombineException);
+}
+
+TEST_F(PRG_Json_Merge, GivenDifferentNumOfSites_Throws) {
+  std::ofstream fout(fpaths.at(1));
+  Json_Prg one_site;
+  one_site.set_sample_info("One_site", "");
+  one_site.add_site(data.site1_samples.at(1));
+  fout << one_site.get_prg();
+  fout.close();
+
+  std::stringstream merged;
+  EXPECT_THROW(merge_json_prgs(fpaths, merged), JSONCombineException);
+}
@@ -0,0 +1,126 @@
+#include <htslib/tbx.h>
+
+#include <sstream>
+#include "gtest/gtest.h"
+
+#include "genotype/infer/level_genotyping/runner.hpp"
+#include "genotype/infer/output_specs/make_vcf.hpp"
+#include "genotype/infer/output_specs/segment_tracker.hpp"
+#include "test_resources.hpp"
+
+using namespace gram::genotype;
+
+TEST(VcfIndexType, GivenSmallSegments_UseTbi) {
+  std::stringstream coords{
+      "chr1\t2200\n"
+      "chr2\t400\n"};
+  SegmentTracker tracker(coords);
+  EXPECT_EQ(vcf_index_min_shift(tracker), 0);
+}
+
+TEST(VcfIndexType, GivenSegmentTooLargeForTbi_UseCsi) {
+  std::stringstream coords{
+      "chr1\t2200\n"
+      "chr2\t600000000\n"};
+  SegmentTracker tracker(coords);
+  EXPECT_EQ(vcf_index_min_shift(tracker), 14);
+}
+
+TEST(VcfIndexType, GivenNoCoords_NoIndex) {
+  std::stringstream coords{""};
+  SegmentTracker tracker(coords);
+  EXPECT_FALSE(vcf_index_min_shift(tracker).has_value());
+}
+
+class WriteVcf : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    setup.setup_numbered_prg("AATAA5C6G6AA7C8G8AA");
+    GenomicRead_vector reads;
+    for (int i = 0; i < 5; i++)
+      reads.push_back(GenomicRead("Read", "AATAACAACAA", "???????????"));
+    setup.quasimap_reads(reads);
+    gtyper = std::make_shared<LevelGenotyper>(
+        setup.prg_info.coverage_graph, setup.coverage.grouped_allele_counts,
+        setup.read_stats, Ploidy::Haploid);
+
+    params.sample_id = "sample";
+    params.genotyped_vcf_fpath =
+        (fs::temp_directory_path() / "test_write_vcf.vcf.gz").string();
+    params.maximum_threads = 4;
+  }
+
+  void TearDown() override {
+    for (auto const extension : {"", ".tbi", ".csi"})
+      fs::remove(params.genotyped_vcf_fpath + extension);
+  }
+
+  /** The records overlapping `region`, read through the vcf's index */
+  std::vector<std::string> query(char const *region) {
+    htsFile *fp = hts_open(params.genotyped_vcf_fpath.c_str(), "r");
+    tbx_t *tbx = tbx_index_load(params.genotyped_vcf_fpath.c_str());
+    hts_itr_t *itr = tbx_itr_querys(tbx, region);
+    std::vector<std::string> records;
+    kstring_t line{0, 0, nullptr};
+    while (itr != nullptr && tbx_itr_next(fp, tbx, itr, &line) >= 0)
+      records.emplace_back(line.s);
+    free(line.s);
+    hts_itr_destroy(itr);
+    tbx_destroy(tbx);
+    hts_close(fp);
+    return records;
+  }
+
+  prg_setup setup;
+  gtyper_ptr gtyper;
+  GenotypeParams params;
+};
+
+TEST_F(WriteVcf, GivenSmallSegment_TbiIndexSupportsRegionQueries) {
+  std::stringstream coords{"chr1\t11\n"};
+  SegmentTracker tracker(coords);
+  write_vcf(params, gtyper, tracker);
+
+  auto const idx_fpath = params.genotyped_vcf_fpath + ".tbi";
+  ASSERT_TRUE(fs::exists(idx_fpath));
+  hts_idx_t *idx =
+      hts_idx_load(params.genotyped_vcf_fpath.c_str(), HTS_FMT_TBI);
+  ASSERT_NE(idx, nullptr);
+  uint64_t num_records, num_unplaced;
+  hts_idx_get_stat(idx, 0, &num_records, &num_unplaced);
+  hts_idx_destroy(idx);
+  EXPECT_EQ(num_records, 2);
+
+  // Sites at 1-based positions 6 and 9
+  auto const records = query("chr1:9-11");
+  ASSERT_EQ(records.size(), 1);
+  EXPECT_EQ(records[0].substr(0, 6), "chr1\t9");
+  EXPECT_EQ(query("chr1:1-11").size(), 2);
+}
+
+TEST_F(WriteVcf, GivenSegmentTooLargeForTbi_CsiIndexSupportsRegionQueries) {
+  std::stringstream coords{"chr1\t600000000\n"};
+  SegmentTracker tracker(coords);
+  write_vcf(params, gtyper, tracker);
+
+  EXPECT_FALSE(fs::exists(params.genotyped_vcf_fpath + ".tbi"));
+  ASSERT_TRUE(fs::exists(params.genotyped_vcf_fpath + ".csi"));
+  hts_idx_t *idx =
+      hts_idx_load(params.genotyped_vcf_fpath.c_str(), HTS_FMT_CSI);
+  ASSERT_NE(idx, nullptr);
+  hts_idx_destroy(idx);
+
+  auto const records = query("chr1:1-7");
+  ASSERT_EQ(records.size(), 1);
+  EXPECT_EQ(records[0].substr(0, 6), "chr1\t6");
+}
+
+TEST_F(WriteVcf, GivenNoCoords_NoIndex) {
+  std::stringstream coords{""};
+  SegmentTracker tracker(coords);
+  write_vcf(params, gtyper, tracker);
+
+  EXPECT_TRUE(fs::exists(params.genotyped_vcf_fpath));
+  EXPECT_FALSE(fs::exists(params.genotyped_vcf_fpath + ".tbi"));
+  EXPECT_FALSE(fs::exists(params.genotyped_vcf_fpath + ".csi"));
+}
@@ -1,3 +1,5 @@
+#include <filesystem>
+#include <fstream>
 #include "gtest/gtest.h"
 
 #include "genotype/infer/output_specs/segment_tracker.hpp"
@@ -215,3 +217,24 @@ TEST_F(Personalised_Ref, GivenSeqS2Tracker_CorrectMultiSegRef) {
   str_vec expected{{"ATCGCTT"}, {"TATC"}};
   EXPECT_EQ(res, expected);
 }
+
+TEST(Deduped_PRefs, GivenDuplicateSequences_WritesEachOnceInSequenceOrder) {
+  Fastas p_refs(3);
+  p_refs.at(0).set_ID("first");
+  p_refs.at(0).add_sequence("TTT");
+  p_refs.at(1).set_ID("second");
+  p_refs.at(1).add_sequence("AAA");
+  p_refs.at(2).set_ID("third");
+  p_refs.at(2).add_sequence("TTT");
+  add_description(p_refs, "desc");
+
+  auto fpath = (std::filesystem::temp_directory_path() / "gram_test_p_refs.fa")
+                   .string();
+  write_deduped_p_refs(p_refs, fpath);
+  std::ifstream fin(fpath);
+  std::stringstream written;
+  written << fin.rdbuf();
+  std::filesystem::remove(fpath);
+
+  EXPECT_EQ(written.str(), ">second desc\nAAA\n>first desc\nTTT\n");
+}
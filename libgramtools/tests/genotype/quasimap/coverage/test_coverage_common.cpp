@@ -8,11 +8,25 @@ using namespace gram::submods;
 std::set<SitePath> get_site_path_only(uniqueSitePaths const& map) {
   std::set<SitePath> site_path;
   for (auto const& e : map) {
-    site_path.insert(e.first);
+    site_path.insert(e.sites);
   }
   return site_path;
 }
 
+EquivalenceClass const& find_class(uniqueSitePaths const& map,
+                                   level0_Sites const& sites) {
+  for (auto const& e : map) {
+    if (e.sites == sites) return e;
+  }
+  throw std::out_of_range("No equivalence class for these sites");
+}
+
+SearchStates get_search_states(EquivalenceClass const& e) {
+  SearchStates result;
+  for (auto const& ss : e.search_states) result.push_back(*ss);
+  return result;
+}
+
 TEST(CountNonvariantSearchStates, OnePathOneNonPath_CountOne) {
   SearchStates search_states = {
       SearchState{SA_Interval{},
@@ -37,15 +51,19 @@ TEST(LocusFinder_logic, SameSiteMoreThanOnceInSearchState_ThrowsError) {
   EXPECT_THROW(l.check_site_uniqueness(search_state), std::logic_error);
 }
 
-TEST(SameLevel0SitesDifferentOrder, SingleEntryInMap) {
+TEST(SameLevel0SitesDifferentOrder, SameSites) {
   level0_Sites s1{Marker{5}, Marker{7}, Marker{9}, Marker{11}};
   level0_Sites s2{Marker{11}, Marker{9}, Marker{7}, Marker{5}};
 
-  uniqueSitePaths unique_map{};
-  unique_map.insert({s1, traversal_info{}});
-  unique_map.insert({s2, traversal_info{}});
+  EXPECT_EQ(s1, s2);
+  EXPECT_EQ(4, s2.size());
+}
 
-  EXPECT_EQ(1, unique_map.size());
+TEST(SortedSmallSet, InsertExistingElement_NotInserted) {
+  SitePath sites{5, 9};
+  EXPECT_TRUE(sites.insert(7));
+  EXPECT_FALSE(sites.insert(9));
+  EXPECT_EQ(sites, (SitePath{5, 7, 9}));
 }
 
 TEST(GetUniquePathSites, TwoDifferentPaths_CorrectPaths) {
@@ -67,10 +85,10 @@ TEST(GetUniquePathSites, TwoDifferentPaths_CorrectPaths) {
   EXPECT_EQ(result, expected);
 
   // Check SearchState dispatch
-  auto ss_result1 = m.usps[SitePath{5, 7}].first.front();
+  auto ss_result1 = *find_class(m.usps, SitePath{5, 7}).search_states.front();
   EXPECT_EQ(ss_result1, search_states.front());
 
-  auto ss_result2 = m.usps[SitePath{9, 11}].first.front();
+  auto ss_result2 = *find_class(m.usps, SitePath{9, 11}).search_states.front();
   EXPECT_EQ(ss_result2, search_states.back());
 }
 
@@ -297,6 +315,54 @@ TEST(RandomInclusiveInt, GivenSize2IntervalAndNoSeed_ReturnsInInclusiveRange) {
   EXPECT_TRUE(result <= 2);
 }
 
+TEST(CounterRandomInt, GivenKey_ReturnsKnownAnswers) {
+  CounterRandomInt r{2};
+  EXPECT_EQ(r.generate(1, 10), 6);
+  EXPECT_EQ(r.generate(1, 10), 8);
+}
+
+TEST(CounterRandomInt, GivenSize1Interval_ReturnsOnlyOption) {
+  CounterRandomInt r{56};
+  EXPECT_EQ(r.generate(1, 1), 1);
+}
+
+TEST(CounterRandomInt, GivenInterval_ReturnsInInclusiveRange) {
+  CounterRandomInt r{7};
+  for (int i = 0; i < 100; ++i) {
+    uint32_t result = r.generate(3, 5);
+    EXPECT_TRUE(result >= 3);
+    EXPECT_TRUE(result <= 5);
+  }
+}
+
+TEST(ReadSelectionKey, GivenSameRead_SameKey) {
+  EXPECT_EQ(read_selection_key(42, 10, false),
+            read_selection_key(42, 10, false));
+}
+
+TEST(ReadSelectionKey, GivenDifferentSeedReadOrStrand_DifferentKeys) {
+  auto const key = read_selection_key(42, 10, false);
+  EXPECT_NE(key, read_selection_key(43, 10, false));
+  EXPECT_NE(key, read_selection_key(42, 11, false));
+  EXPECT_NE(key, read_selection_key(42, 10, true));
+}
+
+TEST(ReadIsSubsampled, GivenFraction_DeterministicAndAboutThatFractionKept) {
+  std::size_t num_kept = 0;
+  for (uint64_t read_index = 0; read_index < 10000; ++read_index) {
+    bool const kept = read_is_subsampled(42, read_index, 0.25);
+    EXPECT_EQ(kept, read_is_subsampled(42, read_index, 0.25));
+    num_kept += kept;
+  }
+  EXPECT_GT(num_kept, 2300);
+  EXPECT_LT(num_kept, 2700);
+}
+
+TEST(ReadIsSubsampled, GivenFractionOne_AllReadsKept) {
+  for (uint64_t read_index = 0; read_index < 100; ++read_index)
+    EXPECT_TRUE(read_is_subsampled(42, read_index, 1));
+}
+
 class MappingInstanceSelector_addSearchStates : public ::testing::Test {
  protected:
   // In this example we pretend we have mapped "TAA" to the graph.
@@ -322,13 +388,16 @@ class MappingInstanceSelector_addSearchStates : public ::testing::Test {
 
 TEST_F(MappingInstanceSelector_addSearchStates,
        addOneSearchState_correctlyRegistered) {
-  selector.add_searchstate(s1);
-  traversal_info expected_info{
-      SearchStates{s1},
-      uniqueLoci{VariantLocus{5, FIRST_ALLELE}, VariantLocus{7, FIRST_ALLELE}}};
-  uniqueSitePaths expected_map{{SitePath{5}, expected_info}};
-
-  EXPECT_EQ(selector.usps, expected_map);
+  SearchStates all_ss{s1};
+  selector.add_searchstate(all_ss.begin());
+
+  ASSERT_EQ(selector.usps.size(), 1);
+  auto const& result = selector.usps.front();
+  EXPECT_EQ(result.sites, SitePath{5});
+  EXPECT_EQ(get_search_states(result), SearchStates{s1});
+  uniqueLoci expected_loci{VariantLocus{5, FIRST_ALLELE},
+                           VariantLocus{7, FIRST_ALLELE}};
+  EXPECT_EQ(result.loci, expected_loci);
 }
 
 TEST_F(MappingInstanceSelector_addSearchStates,
@@ -336,17 +405,20 @@ TEST_F(MappingInstanceSelector_addSearchStates,
   SearchStates all_ss{s1, s2, s3};
   selector.process_searchstates(all_ss);
 
-  traversal_info expected_i1{
-      SearchStates{s1, s2},
-      uniqueLoci{VariantLocus{5, FIRST_ALLELE}, VariantLocus{7, FIRST_ALLELE},
-                 VariantLocus{5, FIRST_ALLELE + 1}}};
-
-  traversal_info expected_i2{SearchStates{s3},
-                             uniqueLoci{VariantLocus{9, FIRST_ALLELE}}};
-
-  uniqueSitePaths expected_map{{SitePath{5}, expected_i1},
-                               {SitePath{9}, expected_i2}};
-  EXPECT_EQ(selector.usps, expected_map);
+  // Equivalence classes are ordered by their sites
+  ASSERT_EQ(selector.usps.size(), 2);
+  auto const& result1 = selector.usps[0];
+  EXPECT_EQ(result1.sites, SitePath{5});
+  EXPECT_EQ(get_search_states(result1), (SearchStates{s1, s2}));
+  uniqueLoci expected_loci1{VariantLocus{5, FIRST_ALLELE},
+                            VariantLocus{7, FIRST_ALLELE},
+                            VariantLocus{5, FIRST_ALLELE + 1}};
+  EXPECT_EQ(result1.loci, expected_loci1);
+
+  auto const& result2 = selector.usps[1];
+  EXPECT_EQ(result2.sites, SitePath{9});
+  EXPECT_EQ(get_search_states(result2), SearchStates{s3});
+  EXPECT_EQ(result2.loci, (uniqueLoci{VariantLocus{9, FIRST_ALLELE}}));
 }
 
 class MappingInstanceSelector_select : public ::testing::Test {
@@ -379,7 +451,7 @@ TEST_F(MappingInstanceSelector_select,
       .WillOnce(Return(3));
 
   MappingInstanceSelector m{&prg_info, &r};
-  m.set_searchstates(ss);  // Copies them to m
+  m.set_searchstates(ss);
   m.process_searchstates(ss);
   EXPECT_EQ(m.usps.size(), 1);  // Expect one unique site recorded: 7
 
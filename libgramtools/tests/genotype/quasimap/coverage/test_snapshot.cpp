@@ -0,0 +1,87 @@
+#include <sstream>
+
+#include "genotype/quasimap/coverage/snapshot.hpp"
+#include "gtest/gtest.h"
+#include "test_resources.hpp"
+
+using namespace gram;
+
+namespace {
+std::vector<PerBaseCoverage> all_node_coverage(coverage_Graph const& graph) {
+  std::vector<PerBaseCoverage> result;
+  for (auto const& entry : graph.random_access)
+    if (entry.offset == 0 && entry.node->get_coverage_space() > 0)
+      result.push_back(entry.node->get_coverage());
+  return result;
+}
+}  // namespace
+
+TEST(CoverageSnapshot, DumpThenLoad_SameCoverage) {
+  GenomicRead_vector reads{GenomicRead{"Read1", "GGGGGCCC", "IIIIIIII"},
+                           GenomicRead{"Read2", "GCCCC", "IIIII"},
+                           GenomicRead{"Read3", "GGAGCC", "IIIIII"}};
+  prg_setup setup;
+  setup.setup_bracketed_prg("G[GG[G,A]G,C]CCC");
+  setup.quasimap_reads(reads);
+  auto const expected_node_coverage =
+      all_node_coverage(setup.prg_info.coverage_graph);
+
+  std::stringstream snapshot;
+  coverage::dump::snapshot(setup.coverage, setup.prg_info.coverage_graph,
+                           snapshot);
+  setup.prg_info.coverage_graph.clear_coverage();
+
+  auto const loaded = coverage::load::snapshot(snapshot, setup.prg_info);
+  EXPECT_EQ(loaded.allele_sum_coverage, setup.coverage.allele_sum_coverage);
+  EXPECT_EQ(loaded.grouped_allele_counts, setup.coverage.grouped_allele_counts);
+  EXPECT_EQ(all_node_coverage(setup.prg_info.coverage_graph),
+            expected_node_coverage);
+}
+
+TEST(CoverageSnapshot, LoadAgainstDifferentPrg_Throws) {
+  prg_setup setup;
+  setup.setup_numbered_prg("G5CAAA6AA6T7G8C8GGG");
+  std::stringstream snapshot;
+  coverage::dump::snapshot(setup.coverage, setup.prg_info.coverage_graph,
+                           snapshot);
+
+  prg_setup other_setup;
+  other_setup.setup_numbered_prg("G5CAAA6AA6TGGG");
+  EXPECT_THROW(coverage::load::snapshot(snapshot, other_setup.prg_info),
+               CoverageSnapshotException);
+}
+
+TEST(CoverageSnapshot, LoadTruncatedSnapshot_Throws) {
+  prg_setup setup;
+  setup.setup_numbered_prg("G5CAAA6AA6T7G8C8GGG");
+  std::stringstream snapshot;
+  coverage::dump::snapshot(setup.coverage, setup.prg_info.coverage_graph,
+                           snapshot);
+
+  std::stringstream truncated(snapshot.str().substr(0, 14));
+  EXPECT_THROW(coverage::load::snapshot(truncated, setup.prg_info),
+               CoverageSnapshotException);
+}
+
+TEST(CoverageSnapshot, ReadOneSite_ThatSitesCoverage) {
+  GenomicRead_vector reads{GenomicRead{"Read1", "CAAAG", "IIIII"},
+                           GenomicRead{"Read2", "GCCGGG", "IIIIII"}};
+  prg_setup setup;
+  setup.setup_numbered_prg("G5CAAA6AA6T7G8C8GGG");
+  setup.quasimap_reads(reads);
+  std::stringstream snapshot;
+  coverage::dump::snapshot(setup.coverage, setup.prg_info.coverage_graph,
+                           snapshot);
+
+  CoverageSnapshotReader reader(snapshot);
+  ASSERT_EQ(reader.size(), 2);
+  auto const second_site = reader.get_site(1);
+  EXPECT_EQ(second_site.allele_sums, setup.coverage.allele_sum_coverage[1]);
+  EXPECT_EQ(second_site.grouped_allele_counts,
+            setup.coverage.grouped_allele_counts[1]);
+  // The second site's alleles start at PRG positions 12 and 14
+  auto const expected_nodes_coverage =
+      collect_coverage(setup.prg_info.coverage_graph, {12, 14});
+  EXPECT_EQ(second_site.nodes_coverage, expected_nodes_coverage);
+  EXPECT_THROW(reader.get_site(2), CoverageSnapshotException);
+}
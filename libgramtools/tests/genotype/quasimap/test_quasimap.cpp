@@ -12,8 +12,14 @@
  *
  */
 
+#include <omp.h>
+
+#include <algorithm>
+#include <fstream>
 #include <stdexcept>
 
+#include "common/instrumentation.hpp"
+#include "common/random.hpp"
 #include "genotype/quasimap/coverage/allele_base.hpp"
 #include "genotype/quasimap/quasimap.hpp"
 #include "genotype/quasimap/search/BWT_search.hpp"
@@ -30,6 +36,20 @@ TEST(ReverseComplementRead, GivenRead_ReverseComplementReadReturned) {
   EXPECT_EQ(result, expected);
 }
 
+TEST(ReadView, GivenReverseComplementView_BasesAndCopiesReverseComplemented) {
+  gram::Sequence read = {1, 2, 1, 3, 4};
+  auto const view = gram::ReadView{read}.reverse_complement();
+  ASSERT_EQ(view.size(), 5);
+  EXPECT_EQ(view[0], 1);
+  EXPECT_EQ(view[4], 4);
+
+  gram::Sequence kmer{4, 4, 4, 4};
+  view.copy(1, 3, kmer);
+  gram::Sequence expected = {2, 4, 3};
+  EXPECT_EQ(kmer, expected);
+  EXPECT_EQ(view.reverse_complement()[1], 2);
+}
+
 TEST(GetKmers, GivenKmersAtOffsets_CorrectExtractionAndThrowsIfKmerDoesNotFit) {
   auto read = encode_dna_bases("accgaat");
   uint32_t kmer_size = 4;
@@ -182,7 +202,7 @@ TEST(Coverage, ReadMapsToThreePositions_CorrectAlleleCoverage) {
   const auto read = encode_dna_bases("tagt");
 
   // Chooses mapping instance in site 5 only
-  SeedSize const random_seed1 = 42;
+  SelectionKey const random_seed1 = 200;
   quasimap_read(read, setup.coverage, setup.kmer_index, setup.prg_info,
                 setup.parameters, setup.quasimap_stats, random_seed1);
   auto &result = setup.coverage.allele_sum_coverage;
@@ -190,7 +210,7 @@ TEST(Coverage, ReadMapsToThreePositions_CorrectAlleleCoverage) {
   EXPECT_EQ(result, expected);
 
   // Chooses mapping instance in site 5 + site 7
-  SeedSize const random_seed2 = 150;
+  SelectionKey const random_seed2 = 150;
   quasimap_read(read, setup.coverage, setup.kmer_index, setup.prg_info,
                 setup.parameters, setup.quasimap_stats, random_seed2);
   expected = {{1, 0, 2}, {1, 0}};
@@ -241,7 +261,7 @@ TEST(Coverage, ReadMapsWithinAlleleAndOutsideSite_CorrectSumCoverage) {
   prg_setup setup;
   setup.setup_numbered_prg("gtagtac5gtagtact6t6ta");
 
-  SeedSize const random_seed = 29;
+  SelectionKey const random_seed = 29;
   Sequence read = encode_dna_bases("gtagt");
   quasimap_read(read, setup.coverage, setup.kmer_index, setup.prg_info,
                 setup.parameters, setup.quasimap_stats, random_seed);
@@ -392,7 +412,7 @@ TEST(Coverage, MappingThreeReadsOneReadMapsTwice_CorrectAlleleCoverage) {
       encode_dna_bases("gcact"),
   };
 
-  SeedSize const random_seed = 200;
+  SelectionKey const random_seed = 150;
   for (const auto &read : reads) {
     quasimap_read(read, setup.coverage, setup.kmer_index, setup.prg_info,
                   setup.parameters, setup.quasimap_stats, random_seed);
@@ -830,3 +850,384 @@ TEST_F(Coverage_Nested_SingleNestingPlusSNP,
       PerBaseCoverage{0},    PerBaseCoverage{1}};
   EXPECT_EQ(PbCov, expectedPbCov);
 }
+
+TEST(Coverage_ReadCache, DuplicateReadMappedFromCache_SameCoverage) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  ReadMappingCache read_cache(100);
+
+  const auto read = encode_dna_bases("ctgagtcta");
+  const auto unmappable_read = encode_dna_bases("ctgaggcta");
+  for (int i = 0; i < 2; ++i) {
+    quasimap_read(read, setup.coverage, setup.kmer_index, setup.prg_info,
+                  setup.parameters, setup.quasimap_stats, 42, &read_cache);
+    quasimap_read(unmappable_read, setup.coverage, setup.kmer_index,
+                  setup.prg_info, setup.parameters, setup.quasimap_stats, 42,
+                  &read_cache);
+  }
+
+  EXPECT_EQ(read_cache.size(), 2);
+  EXPECT_EQ(read_cache.get_num_hits(), 2);
+  const auto &result = setup.coverage.allele_sum_coverage;
+  AlleleSumCoverage expected = {{0, 2, 0}, {2, 0}};
+  EXPECT_EQ(result, expected);
+  EXPECT_EQ(setup.quasimap_stats.exact_mapped_reads_count, 2);
+  EXPECT_EQ(setup.quasimap_stats.no_extension_reads_count +
+                setup.quasimap_stats.missing_kmer_reads_count,
+            2);
+}
+
+TEST(MapRead, GivenMappableRead_Mapped) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  auto result = map_read(encode_dna_bases("ctgagtcta"), setup.kmer_index,
+                         setup.prg_info, setup.parameters);
+  EXPECT_EQ(result.outcome, ReadMappingOutcome::mapped);
+  EXPECT_FALSE(result.search_states.empty());
+}
+
+TEST(MapRead, GivenReadFailingMidway_NoExtension) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  auto result = map_read(encode_dna_bases("ctgaggcta"), setup.kmer_index,
+                         setup.prg_info, setup.parameters);
+  EXPECT_EQ(result.outcome, ReadMappingOutcome::no_extension);
+  EXPECT_TRUE(result.search_states.empty());
+}
+
+TEST(MapRead, GivenKmerMissingFromIndex_MissingKmer) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  auto const read = encode_dna_bases("ctgagtcta");
+
+  // Seeding kmer
+  auto kmer_index = setup.kmer_index;
+  kmer_index.erase(encode_dna_bases("ta"));
+  auto result = map_read(read, kmer_index, setup.prg_info, setup.parameters);
+  EXPECT_EQ(result.outcome, ReadMappingOutcome::missing_kmer);
+
+  // Kmer the search extends through
+  kmer_index = setup.kmer_index;
+  kmer_index.erase(encode_dna_bases("ga"));
+  result = map_read(read, kmer_index, setup.prg_info, setup.parameters);
+  EXPECT_EQ(result.outcome, ReadMappingOutcome::missing_kmer);
+}
+
+TEST(MapRead, GivenReverseComplementView_SameAsReverseComplementRead) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  auto const read = encode_dna_bases("tagactcag");  // Maps on reverse strand
+
+  auto from_view = map_read(ReadView{read}.reverse_complement(),
+                            setup.kmer_index, setup.prg_info, setup.parameters);
+  auto from_copy = map_read(reverse_complement_read(read), setup.kmer_index,
+                            setup.prg_info, setup.parameters);
+  EXPECT_EQ(from_view.outcome, ReadMappingOutcome::mapped);
+  EXPECT_EQ(from_view.search_states, from_copy.search_states);
+}
+
+TEST(MapRead, GivenReadShorterThanKmer_MissingKmer) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  auto result = map_read(encode_dna_bases("c"), setup.kmer_index,
+                         setup.prg_info, setup.parameters);
+  EXPECT_EQ(result.outcome, ReadMappingOutcome::missing_kmer);
+}
+
+TEST(QuasimapPair, ConcordantMates_BothMatesCoverageRecorded) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  setup.quasimap_stats.coverage = setup.coverage;
+  auto const mate1 = encode_dna_bases("gctcag");
+  // Maps reverse complemented, 10 positions after mate 1
+  auto const mate2 = encode_dna_bases("taggct");
+
+  quasimap_pair(setup.quasimap_stats, mate1, mate2, setup.parameters,
+                setup.kmer_index, setup.prg_info, 42, 0);
+  AlleleSumCoverage expected = {{1, 0, 0}, {0, 1}};
+  EXPECT_EQ(setup.quasimap_stats.coverage.allele_sum_coverage, expected);
+  EXPECT_EQ(setup.quasimap_stats.exact_mapped_reads_count, 2);
+  // In the other orientation, mate 1 maps but mate 2 does not
+  EXPECT_EQ(setup.quasimap_stats.unpaired_reads_count, 1);
+}
+
+TEST(QuasimapPair, MatesFurtherThanMaxInsertSize_NoCoverageRecorded) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  setup.quasimap_stats.coverage = setup.coverage;
+  setup.parameters.max_insert_size = 5;
+  auto const mate1 = encode_dna_bases("gctcag");
+  auto const mate2 = encode_dna_bases("taggct");
+
+  quasimap_pair(setup.quasimap_stats, mate1, mate2, setup.parameters,
+                setup.kmer_index, setup.prg_info, 42, 0);
+  AlleleSumCoverage expected = {{0, 0, 0}, {0, 0}};
+  EXPECT_EQ(setup.quasimap_stats.coverage.allele_sum_coverage, expected);
+  EXPECT_EQ(setup.quasimap_stats.exact_mapped_reads_count, 0);
+  EXPECT_EQ(setup.quasimap_stats.unpaired_reads_count, 3);
+}
+
+TEST(QuasimapPair, MateNotSeeded_PairDroppedWithoutExtension) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  setup.quasimap_stats.coverage = setup.coverage;
+  auto const mate1 = encode_dna_bases("gctcag");
+  auto const mate2 = encode_dna_bases("taggct");
+  // The seeding kmer of mate 2, reverse complemented
+  auto kmer_index = setup.kmer_index;
+  kmer_index.erase(encode_dna_bases("ta"));
+
+  quasimap_pair(setup.quasimap_stats, mate1, mate2, setup.parameters,
+                kmer_index, setup.prg_info, 42, 0);
+  EXPECT_EQ(setup.quasimap_stats.exact_mapped_reads_count, 0);
+  EXPECT_EQ(setup.quasimap_stats.missing_kmer_reads_count +
+                setup.quasimap_stats.no_extension_reads_count,
+            2);
+  // Mate 1 is not extended in one orientation, mate 2 in the other
+  EXPECT_EQ(setup.quasimap_stats.unpaired_reads_count, 2);
+}
+
+TEST(QuasimapPair, MateTooRepetitiveToPair_MatesRecordedIndependently) {
+  prg_setup setup;
+  // Mate 1 maps to more instances than are located for pairing
+  setup.setup_numbered_prg(std::string(max_located_instances + 10, 'a') +
+                           "5c6g6t");
+  setup.quasimap_stats.coverage = setup.coverage;
+  auto const mate1 = encode_dna_bases("aaaa");
+  // Maps reverse complemented, through allele 1 of the site
+  auto const mate2 = encode_dna_bases("agt");
+
+  quasimap_pair(setup.quasimap_stats, mate1, mate2, setup.parameters,
+                setup.kmer_index, setup.prg_info, 42, 0);
+  AlleleSumCoverage expected = {{1, 0}};
+  EXPECT_EQ(setup.quasimap_stats.coverage.allele_sum_coverage, expected);
+  EXPECT_EQ(setup.quasimap_stats.exact_mapped_reads_count, 2);
+  EXPECT_EQ(setup.quasimap_stats.unpaired_repetitive_reads_count, 2);
+}
+
+class Subsampling : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+    setup.quasimap_stats.coverage = setup.coverage;
+    setup.parameters.subsample_fraction = 0.5;
+    for (uint64_t index = 0; index < num_reads; ++index)
+      num_subsampled_out += !read_is_subsampled(master_seed, index, 0.5);
+  }
+
+  /** A fastq file of `num_reads` copies of `read` */
+  std::string write_reads(std::string const &fname, std::string const &read) {
+    auto const fpath = (fs::temp_directory_path() / fname).string();
+    std::ofstream out(fpath);
+    for (uint64_t index = 0; index < num_reads; ++index)
+      out << "@read" << index << '\n'
+          << read << "\n+\n"
+          << std::string(read.size(), 'I') << '\n';
+    return fpath;
+  }
+
+  static constexpr uint64_t num_reads = 50;
+  static constexpr SeedSize master_seed = 42;
+  uint64_t num_subsampled_out = 0;
+  prg_setup setup;
+};
+
+TEST_F(Subsampling, GivenSingleReads_AllReadsCountedSubsampledOutOnesToo) {
+  auto const fpath = write_reads("test_subsampling.fq", "gctcag");
+  IndexReplicas const indices(setup.prg_info, setup.kmer_index);
+  uint64_t read_index = 0;
+  handle_read_file(setup.quasimap_stats, fpath, setup.parameters, indices,
+                   master_seed, read_index);
+  fs::remove(fpath);
+
+  ASSERT_GT(num_subsampled_out, 0);
+  ASSERT_LT(num_subsampled_out, num_reads);
+  EXPECT_EQ(setup.quasimap_stats.all_reads_count, 2 * num_reads);
+  EXPECT_EQ(setup.quasimap_stats.subsampled_out_reads_count,
+            2 * num_subsampled_out);
+}
+
+TEST_F(Subsampling, GivenReadPairs_AllReadsCountedSubsampledOutOnesToo) {
+  auto const mate1_fpath = write_reads("test_subsampling_1.fq", "gctcag");
+  auto const mate2_fpath = write_reads("test_subsampling_2.fq", "taggct");
+  IndexReplicas const indices(setup.prg_info, setup.kmer_index);
+  uint64_t pair_index = 0;
+  handle_read_pair_files(setup.quasimap_stats, mate1_fpath, mate2_fpath,
+                         setup.parameters, indices, master_seed, pair_index);
+  fs::remove(mate1_fpath);
+  fs::remove(mate2_fpath);
+
+  EXPECT_EQ(setup.quasimap_stats.all_reads_count, 4 * num_reads);
+  EXPECT_EQ(setup.quasimap_stats.subsampled_out_reads_count,
+            4 * num_subsampled_out);
+}
+
+/**
+ * Maps the same reads, several of which map to more than one place, with
+ * different numbers of threads and read batch sizes.
+ */
+class ReproducibleSelection : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::vector<std::string> const reads{"ct",  "gctcag", "cta", "ag",
+                                         "agt", "tagact", "tc",  "ctga"};
+    std::ofstream out(reads_fpath);
+    for (int copy = 0; copy < 40; ++copy)
+      for (std::size_t i = 0; i < reads.size(); ++i)
+        out << "@read" << copy << '_' << i << '\n'
+            << reads[i] << "\n+\n"
+            << std::string(reads[i].size(), 'I') << '\n';
+  }
+
+  void TearDown() override {
+    fs::remove(reads_fpath);
+    fs::remove(mappings_fpath);
+  }
+
+  struct Result {
+    Coverage coverage;
+    std::vector<std::string> mappings;  // Sorted: threads write in any order
+  };
+
+  Result map_reads(int const num_threads, uint64_t const batch_size) {
+    prg_setup setup;
+    setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+    setup.quasimap_stats.coverage = setup.coverage;
+    setup.parameters.read_batch_size = batch_size;
+    IndexReplicas const indices(setup.prg_info, setup.kmer_index);
+
+    auto const previous_num_threads = omp_get_max_threads();
+    omp_set_num_threads(num_threads);
+    {
+      ReadMappingWriter writer(mappings_fpath, num_threads);
+      uint64_t read_index = 0;
+      handle_read_file(setup.quasimap_stats, reads_fpath, setup.parameters,
+                       indices, 42, read_index, nullptr, &writer);
+      writer.close();
+    }
+    omp_set_num_threads(previous_num_threads);
+
+    Result result{setup.quasimap_stats.coverage, {}};
+    std::ifstream in(mappings_fpath);
+    std::string line;
+    while (std::getline(in, line)) result.mappings.push_back(line);
+    std::sort(result.mappings.begin(), result.mappings.end());
+    return result;
+  }
+
+  std::string const reads_fpath =
+      (fs::temp_directory_path() / "test_reproducible_selection.fq").string();
+  std::string const mappings_fpath =
+      (fs::temp_directory_path() / "test_reproducible_selection.tsv").string();
+};
+
+TEST_F(ReproducibleSelection, GivenThreadCountsAndBatchSizes_SameSelections) {
+  auto const expected = map_reads(1, 5000);
+  ASSERT_FALSE(expected.mappings.empty());
+
+  for (auto const &[num_threads, batch_size] :
+       std::vector<std::pair<int, uint64_t>>{{4, 5000}, {1, 7}, {4, 7}}) {
+    auto const result = map_reads(num_threads, batch_size);
+    EXPECT_EQ(result.coverage.allele_sum_coverage,
+              expected.coverage.allele_sum_coverage);
+    EXPECT_EQ(result.coverage.grouped_allele_counts,
+              expected.coverage.grouped_allele_counts);
+    EXPECT_EQ(result.mappings, expected.mappings);
+  }
+}
+
+TEST(QuasimapPair, MatesMappingToSeveralLoci_ChosenInstancesConcordant) {
+  prg_setup setup;
+  // Mate 1 maps at 0, 49 and 58; mate 2 at 9 and 67
+  setup.setup_numbered_prg("ccat5g6t6aga7c8g8tt" + std::string(30, 't') +
+                           "ccat9g10t10ccat11g12t12aga13c14g14tt");
+  setup.parameters.max_insert_size = 20;
+  auto const mate1 = encode_dna_bases("ccatg");
+  auto const mate2 = encode_dna_bases("gtct");  // Maps reverse complemented
+
+  uint64_t first_locus_count = 0;
+  for (uint64_t pair_index = 0; pair_index < 20; ++pair_index) {
+    setup.quasimap_stats.coverage = setup.coverage;
+    quasimap_pair(setup.quasimap_stats, mate1, mate2, setup.parameters,
+                  setup.kmer_index, setup.prg_info, 42, pair_index);
+    auto const &coverage = setup.quasimap_stats.coverage.allele_sum_coverage;
+    // Mate 2's instance is the one near mate 1's
+    auto const mate1_first_locus = coverage[0][0];
+    auto const mate1_second_locus = coverage[2][0] + coverage[3][0];
+    EXPECT_EQ(mate1_first_locus + mate1_second_locus, 1);
+    EXPECT_EQ(coverage[1][0], mate1_first_locus);
+    EXPECT_EQ(coverage[4][0], mate1_second_locus);
+    first_locus_count += mate1_first_locus;
+  }
+  EXPECT_GT(first_locus_count, 0);
+  EXPECT_LT(first_locus_count, 20);
+}
+
+TEST(ConcordantPairs, GivenMatePositions_OnlyNearbyPairsListed) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  // Mate 1 maps at 0 only, mate 2 ("ct") at 1 and 17
+  auto const mate1_states =
+      map_read(encode_dna_bases("gct"), setup.kmer_index, setup.prg_info,
+               setup.parameters)
+          .search_states;
+  auto const mate2_states =
+      map_read(encode_dna_bases("ct"), setup.kmer_index, setup.prg_info,
+               setup.parameters)
+          .search_states;
+
+  auto result =
+      concordant_pairs(mate1_states, mate2_states, setup.prg_info, 5);
+  ASSERT_EQ(result.size(), 1);
+  EXPECT_EQ(result[0][0].position, 0);
+  EXPECT_EQ(result[0][1].position, 1);
+  EXPECT_EQ(setup.prg_info.fm_index[result[0][1].sa_index], 1);
+
+  result = concordant_pairs(mate1_states, mate2_states, setup.prg_info, 20);
+  ASSERT_EQ(result.size(), 2);
+  EXPECT_EQ(result[1][1].position, 17);
+}
+
+TEST(DepthEstimator, GivenNestedPRG_MeanOverLevel1SitesOnly) {
+  prg_setup setup;
+  setup.setup_bracketed_prg("AATAA[CCC[A,G],T]AA[C,G]A");
+  DepthEstimator depth_estimator(setup.prg_info);
+
+  // The nested site's coverage is not counted
+  AlleleSumCoverage allele_sum_coverage{{3, 1}, {10, 20}, {2, 2}};
+  EXPECT_EQ(depth_estimator.mean_depth(allele_sum_coverage), 4);
+}
+
+TEST(CopyPrgInfoForMapping, GivenMappableRead_SameMappingAsOriginal) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  auto const copy = copy_prg_info_for_mapping(setup.prg_info);
+  auto const read = encode_dna_bases("ctgagtcta");
+
+  auto const expected =
+      map_read(read, setup.kmer_index, setup.prg_info, setup.parameters);
+  auto const result = map_read(read, setup.kmer_index, copy, setup.parameters);
+  EXPECT_EQ(result.outcome, ReadMappingOutcome::mapped);
+  EXPECT_EQ(result.search_states, expected.search_states);
+  // Per base coverage recorded through the copy is in the original's nodes
+  EXPECT_EQ(copy.coverage_graph.random_access[4].node,
+            setup.prg_info.coverage_graph.random_access[4].node);
+}
+
+TEST(IndexReplicas, GivenNoReplication_OriginalIndicesUsed) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  IndexReplicas const indices(setup.prg_info, setup.kmer_index);
+  EXPECT_EQ(indices.num_replicas(), 0);
+  EXPECT_EQ(&indices.local_prg_info(), &setup.prg_info);
+  EXPECT_EQ(&indices.local_kmer_index(), &setup.kmer_index);
+}
+
+TEST(BackWithHugePages, GivenSmallPrg_NoWholeHugePageCollapsed) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta");
+  EXPECT_EQ(back_with_huge_pages(setup.prg_info), 0);
+  auto const huge_page_bytes = instrumentation::report()["huge_page_bytes"];
+  EXPECT_TRUE(huge_page_bytes.contains("fm_index.sa_sample"));
+  EXPECT_TRUE(huge_page_bytes.contains("coverage_graph.random_access"));
+}
@@ -0,0 +1,81 @@
+#include "common/utils.hpp"
+#include "genotype/quasimap/read_cache.hpp"
+#include "gtest/gtest.h"
+
+using namespace gram;
+
+TEST(ReadCache_Pack, GivenReadsOfDifferentLengths_DifferentKeys) {
+  auto first = ReadMappingCache::pack(encode_dna_bases("A"));
+  auto second = ReadMappingCache::pack(encode_dna_bases("AA"));
+  auto third = ReadMappingCache::pack(encode_dna_bases("AAAAA"));
+  ASSERT_TRUE(first && second && third);
+  EXPECT_NE(*first, *second);
+  EXPECT_NE(*second, *third);
+}
+
+TEST(ReadCache_Pack, GivenSameReads_SameKeys) {
+  auto first = ReadMappingCache::pack(encode_dna_bases("ACGTTGCA"));
+  auto second = ReadMappingCache::pack(encode_dna_bases("ACGTTGCA"));
+  auto third = ReadMappingCache::pack(encode_dna_bases("ACGTTGCC"));
+  EXPECT_EQ(first, second);
+  EXPECT_NE(first, third);
+}
+
+TEST(ReadCache_Pack, GivenNonACGTBase_NoKey) {
+  EXPECT_FALSE(ReadMappingCache::pack(Sequence{1, 0, 2}).has_value());
+}
+
+TEST(ReadCache, InsertThenFind_CountsHits) {
+  ReadMappingCache cache(10);
+  auto key = *ReadMappingCache::pack(encode_dna_bases("ACGT"));
+  EXPECT_EQ(cache.find(key), nullptr);
+
+  auto mapping = std::make_shared<ReadMapping const>(
+      ReadMapping{ReadMappingOutcome::no_extension, {}});
+  cache.insert(key, mapping);
+  EXPECT_EQ(cache.find(key), mapping);
+  EXPECT_EQ(cache.get_num_hits(), 1);
+  EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(ReadCache, GivenFullCache_NewReadsNotCached) {
+  ReadMappingCache cache(1, 1);
+  auto mapping = std::make_shared<ReadMapping const>(
+      ReadMapping{ReadMappingOutcome::missing_kmer, {}});
+  auto first = *ReadMappingCache::pack(encode_dna_bases("ACGT"));
+  auto second = *ReadMappingCache::pack(encode_dna_bases("TTTT"));
+  cache.insert(first, mapping);
+  cache.insert(second, mapping);
+
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(cache.find(second), nullptr);
+}
+
+TEST(ReadCache, GivenMoreShardsThanReads_SizeCappedOverAllShards) {
+  ReadMappingCache cache(3, 16);
+  auto mapping = std::make_shared<ReadMapping const>(
+      ReadMapping{ReadMappingOutcome::missing_kmer, {}});
+  std::string const bases{"ACGT"};
+  for (auto const first : bases)
+    for (auto const second : bases)
+      for (auto const third : bases) {
+        auto const read = std::string{first, second, third};
+        cache.insert(*ReadMappingCache::pack(encode_dna_bases(read)), mapping);
+      }
+
+  EXPECT_EQ(cache.size(), 3);
+}
+
+TEST(ReadCache, GivenSameReadInsertedTwice_CachedOnce) {
+  ReadMappingCache cache(2, 1);
+  auto mapping = std::make_shared<ReadMapping const>(
+      ReadMapping{ReadMappingOutcome::missing_kmer, {}});
+  auto first = *ReadMappingCache::pack(encode_dna_bases("ACGT"));
+  auto second = *ReadMappingCache::pack(encode_dna_bases("TTTT"));
+  cache.insert(first, mapping);
+  cache.insert(first, mapping);
+  cache.insert(second, mapping);
+
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.find(second), mapping);
+}
@@ -0,0 +1,130 @@
+#include <htslib/bgzf.h>
+#include <zlib.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "common/utils.hpp"
+#include "genotype/quasimap/read_input.hpp"
+#include "gtest/gtest.h"
+
+using namespace gram;
+namespace fs = std::filesystem;
+
+namespace {
+std::string const fastq{
+    "@read1 comment\nACGT\n+\n5555\n"
+    "@read2\nCCA\nGG\n+read2\n?????\n"
+    "@read3\nTT\n+\n@@\n"};
+
+struct ParsedRead {
+  std::string name;
+  Sequence bases;
+  std::string qual;
+  std::size_t length;
+};
+
+std::vector<ParsedRead> read_all(std::string const& fpath,
+                                 int num_threads = 1) {
+  ReadFileReader reader(fpath, num_threads);
+  ReadBatch batch;
+  std::vector<ParsedRead> reads;
+  // Small batches, to parse over batch boundaries
+  while (reader.next_batch(batch, 2)) {
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+      ParsedRead read{std::string(batch.name(i)), {},
+                      std::string(batch.qualities(i)), batch.length(i)};
+      batch.read(i).copy(0, batch.read(i).size(), read.bases);
+      reads.push_back(read);
+    }
+  }
+  return reads;
+}
+
+void expect_fastq_reads(std::vector<ParsedRead> const& reads) {
+  ASSERT_EQ(reads.size(), 3);
+  EXPECT_EQ(reads[0].name, "read1 comment");
+  EXPECT_EQ(reads[0].bases, encode_dna_bases("ACGT"));
+  EXPECT_EQ(reads[0].qual, "5555");
+  EXPECT_EQ(reads[1].name, "read2");
+  EXPECT_EQ(reads[1].bases, encode_dna_bases("CCAGG"));
+  EXPECT_EQ(reads[1].qual, "?????");
+  // A quality string can start with '@'
+  EXPECT_EQ(reads[2].bases, encode_dna_bases("TT"));
+  EXPECT_EQ(reads[2].qual, "@@");
+}
+
+class ReadInput : public ::testing::Test {
+ protected:
+  fs::path const fpath{fs::temp_directory_path() / "test_read_input.fq"};
+  void TearDown() override { fs::remove(fpath); }
+
+  void write_plain(std::string const& content) {
+    std::ofstream out(fpath);
+    out << content;
+  }
+};
+}  // namespace
+
+TEST_F(ReadInput, PlainFastq_AllReadsParsed) {
+  write_plain(fastq);
+  expect_fastq_reads(read_all(fpath));
+}
+
+TEST_F(ReadInput, GzipFastq_AllReadsParsed) {
+  auto* out = gzopen(fpath.c_str(), "wb");
+  gzwrite(out, fastq.data(), fastq.size());
+  gzclose(out);
+
+  DecompressedStream stream(fpath, 1);
+  EXPECT_EQ(stream.get_compression(), InputCompression::gzip);
+  expect_fastq_reads(read_all(fpath));
+}
+
+TEST_F(ReadInput, BgzfFastqManyThreads_AllReadsParsed) {
+  auto* out = bgzf_open(fpath.c_str(), "w");
+  bgzf_write(out, fastq.data(), fastq.size());
+  bgzf_close(out);
+
+  DecompressedStream stream(fpath, 4);
+  EXPECT_EQ(stream.get_compression(), InputCompression::bgzf);
+  expect_fastq_reads(read_all(fpath, 4));
+}
+
+TEST_F(ReadInput, Fasta_ReadsHaveNoQualities) {
+  write_plain(">read1\nAC\nGT\n\n>read2\r\nTT\r\n");
+  auto const reads = read_all(fpath);
+  ASSERT_EQ(reads.size(), 2);
+  EXPECT_EQ(reads[0].bases, encode_dna_bases("ACGT"));
+  EXPECT_EQ(reads[1].name, "read2");
+  EXPECT_EQ(reads[1].bases, encode_dna_bases("TT"));
+  EXPECT_TRUE(reads[1].qual.empty());
+}
+
+TEST_F(ReadInput, NonDnaBases_NoEncodedBasesButLengthKept) {
+  write_plain("@read1\nACNGT\n+\n55555\n@read2\nacgt\n+\n5555\n");
+  auto const reads = read_all(fpath);
+  ASSERT_EQ(reads.size(), 2);
+  EXPECT_TRUE(reads[0].bases.empty());
+  EXPECT_EQ(reads[0].length, 5);
+  EXPECT_EQ(reads[1].bases, encode_dna_bases("ACGT"));
+}
+
+TEST_F(ReadInput, TruncatedFastq_Throws) {
+  write_plain("@read1\nACGT\n+\n55\n");
+  EXPECT_THROW(read_all(fpath), std::runtime_error);
+}
+
+TEST(ReadInputFormat, SamHeader_NotFastx) {
+  std::string const sam{"@HD\tVN:1.6\n@SQ\tSN:chr1\tLN:10\nread1\t4\t*\n"};
+  InputChunk chunk(sam.begin(), sam.end());
+  EXPECT_FALSE(FastxParser::detect_format(chunk).has_value());
+}
+
+TEST(ReadInputFormat, FastqAndFasta_Detected) {
+  InputChunk fastq_chunk(fastq.begin(), fastq.end());
+  EXPECT_EQ(FastxParser::detect_format(fastq_chunk), FastxFormat::fastq);
+  std::string const fasta{">read1\nACGT\n"};
+  InputChunk fasta_chunk(fasta.begin(), fasta.end());
+  EXPECT_EQ(FastxParser::detect_format(fasta_chunk), FastxFormat::fasta);
+}
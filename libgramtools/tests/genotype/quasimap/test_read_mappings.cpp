@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include "genotype/quasimap/quasimap.hpp"
+#include "genotype/quasimap/read_mappings.hpp"
+#include "gtest/gtest.h"
+#include "test_resources.hpp"
+
+using namespace gram;
+namespace fs = std::filesystem;
+
+TEST(ReadMappings_Format, ReadOutsideSites_NoLociNorSearchStates) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5cccc6g6t6ag");
+  auto selection = quasimap_read(encode_dna_bases("gct"), setup.coverage,
+                                 setup.kmer_index, setup.prg_info,
+                                 setup.parameters, setup.quasimap_stats);
+  ASSERT_TRUE(selection.has_value());
+
+  std::string result;
+  format_read_mapping(result, "read1", true, 3, selection->selected,
+                      setup.prg_info);
+  EXPECT_EQ(result, "read1\t-\t3\t.\t.");
+}
+
+TEST(ReadMappings_Format, ReadWithinAllele_LocusAndSearchStateWritten) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5cccc6g6t6ag");
+  auto selection = quasimap_read(encode_dna_bases("cccc"), setup.coverage,
+                                 setup.kmer_index, setup.prg_info,
+                                 setup.parameters, setup.quasimap_stats);
+  ASSERT_TRUE(selection.has_value());
+
+  std::string result;
+  format_read_mapping(result, "read1", false, 4, selection->selected,
+                      setup.prg_info);
+  std::string const expected_prefix{"read1\t+\t4\t5:0\t"};
+  EXPECT_EQ(result.substr(0, expected_prefix.size()), expected_prefix);
+  EXPECT_EQ(std::count(result.begin(), result.end(), '|'), 3);
+}
+
+TEST(ReadMappings_Format, ManyMappingInstances_PositionsListTruncated) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5" + std::string(20, 'c') + "6g6t6ag");
+  auto selection = quasimap_read(encode_dna_bases("cc"), setup.coverage,
+                                 setup.kmer_index, setup.prg_info,
+                                 setup.parameters, setup.quasimap_stats);
+  ASSERT_TRUE(selection.has_value());
+
+  std::string result;
+  format_read_mapping(result, "read1", false, 2, selection->selected,
+                      setup.prg_info);
+  // The positions are between the first and second '|'
+  auto const start = result.find('|') + 1;
+  auto const positions = result.substr(start, result.find('|', start) - start);
+  auto const num_commas = std::count(positions.begin(), positions.end(), ',');
+  EXPECT_EQ(static_cast<std::size_t>(num_commas), max_listed_positions);
+  EXPECT_EQ(positions.substr(positions.size() - 4), ",...");
+}
+
+TEST(ReadMappings_Format, UnmappedRead_NoSelection) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5cccc6g6t6ag");
+  auto selection = quasimap_read(encode_dna_bases("tttt"), setup.coverage,
+                                 setup.kmer_index, setup.prg_info,
+                                 setup.parameters, setup.quasimap_stats);
+  EXPECT_FALSE(selection.has_value());
+}
+
+TEST(ReadMappings_Writer, AddedMappingsWrittenOnClose) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5cccc6g6t6ag");
+  auto selection = quasimap_read(encode_dna_bases("gct"), setup.coverage,
+                                 setup.kmer_index, setup.prg_info,
+                                 setup.parameters, setup.quasimap_stats);
+  ASSERT_TRUE(selection.has_value());
+
+  auto const fpath = fs::temp_directory_path() / "test_read_mappings.tsv";
+  {
+    ReadMappingWriter writer(fpath.string(), 1);
+    writer.add("read1", false, 3, selection->selected, setup.prg_info);
+    writer.add("read2", true, 3, selection->selected, setup.prg_info);
+  }
+
+  std::ifstream in(fpath);
+  std::string line;
+  std::vector<std::string> lines;
+  while (std::getline(in, line)) lines.push_back(line);
+  std::vector<std::string> expected{"read1\t+\t3\t.\t.", "read2\t-\t3\t.\t."};
+  EXPECT_EQ(lines, expected);
+  fs::remove(fpath);
+}
+
+TEST(ReadMappings_Writer, MoreBuffersThanQueued_AllMappingsWritten) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5cccc6g6t6ag");
+  auto selection = quasimap_read(encode_dna_bases("gct"), setup.coverage,
+                                 setup.kmer_index, setup.prg_info,
+                                 setup.parameters, setup.quasimap_stats);
+  ASSERT_TRUE(selection.has_value());
+
+  // Fills several times the 2 buffers a single thread may queue
+  auto const num_reads = 5 * ReadMappingWriter::buffer_size / 10;
+  auto const fpath = fs::temp_directory_path() / "test_read_mappings.tsv";
+  {
+    ReadMappingWriter writer(fpath.string(), 1);
+    for (std::size_t i = 0; i < num_reads; ++i)
+      writer.add("read", false, 3, selection->selected, setup.prg_info);
+    writer.close();
+  }
+
+  std::ifstream in(fpath);
+  std::string line;
+  std::size_t num_lines = 0;
+  while (std::getline(in, line)) ++num_lines;
+  EXPECT_EQ(num_lines, num_reads);
+  fs::remove(fpath);
+}
+
+TEST(ReadMappings_Writer, GivenFullDisk_CloseThrows) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5cccc6g6t6ag");
+  auto selection = quasimap_read(encode_dna_bases("gct"), setup.coverage,
+                                 setup.kmer_index, setup.prg_info,
+                                 setup.parameters, setup.quasimap_stats);
+  ASSERT_TRUE(selection.has_value());
+
+  // Writes to /dev/full fail as on a full disk
+  ReadMappingWriter writer("/dev/full", 1);
+  writer.add("read1", false, 3, selection->selected, setup.prg_info);
+  EXPECT_THROW(writer.close(), std::runtime_error);
+}
@@ -0,0 +1,68 @@
+#include <sstream>
+
+#include "genotype/parameters.hpp"
+#include "gtest/gtest.h"
+
+using namespace gram;
+using namespace gram::commands::genotype;
+
+/**
+ * Samples manifest, for batch genotyping
+ */
+
+TEST(SamplesManifest, GivenSamplesWithOneOrMoreReadsFiles_AllParsed) {
+  std::istringstream manifest{
+      "# sample\treads\n"
+      "s1\t/data/s1.fq.gz\n"
+      "\n"
+      "s2\t/data/s2_1.fq.gz\t/data/s2_2.fq.gz\r\n"};
+  auto result = parse_samples_manifest(manifest);
+
+  ASSERT_EQ(result.size(), 2);
+  EXPECT_EQ(result[0].sample_id, "s1");
+  EXPECT_EQ(result[0].reads_fpaths, std::vector<std::string>{"/data/s1.fq.gz"});
+  EXPECT_EQ(result[1].sample_id, "s2");
+  std::vector<std::string> expected_reads{"/data/s2_1.fq.gz",
+                                          "/data/s2_2.fq.gz"};
+  EXPECT_EQ(result[1].reads_fpaths, expected_reads);
+}
+
+TEST(SamplesManifest, GivenRelativeReadsPath_MadeAbsolute) {
+  std::istringstream manifest{"s1\treads.fq\n"};
+  auto result = parse_samples_manifest(manifest);
+
+  ASSERT_EQ(result.size(), 1);
+  EXPECT_EQ(result[0].reads_fpaths[0],
+            fs::absolute(fs::path("reads.fq")).string());
+}
+
+TEST(SamplesManifest, GivenSampleWithNoReads_Throws) {
+  std::istringstream manifest{"s1\t/data/s1.fq.gz\ns2\n"};
+  EXPECT_THROW(parse_samples_manifest(manifest), std::invalid_argument);
+}
+
+TEST(SamplesManifest, GivenSampleWithNoReadsAndReadsNotRequired_Parsed) {
+  std::istringstream manifest{"s1\ns2\n"};
+  auto samples = parse_samples_manifest(manifest, false);
+  ASSERT_EQ(samples.size(), 2);
+  EXPECT_EQ(samples[1].sample_id, "s2");
+  EXPECT_TRUE(samples[1].reads_fpaths.empty());
+}
+
+TEST(SamplesManifest, GivenDuplicateSampleID_Throws) {
+  std::istringstream manifest{"s1\t/data/s1.fq.gz\ns1\t/data/s2.fq.gz\n"};
+  EXPECT_THROW(parse_samples_manifest(manifest), std::invalid_argument);
+}
+
+TEST(SamplesManifest, GivenSampleIDNotUsableAsDirectoryName_Throws) {
+  for (auto const sample_id : {"a/b", ".", ".."}) {
+    std::istringstream manifest{std::string(sample_id) + "\t/data/s1.fq.gz\n"};
+    EXPECT_THROW(parse_samples_manifest(manifest), std::invalid_argument)
+        << sample_id;
+  }
+}
+
+TEST(SamplesManifest, GivenEmptySampleID_Throws) {
+  std::istringstream manifest{"\t/data/s1.fq.gz\n"};
+  EXPECT_THROW(parse_samples_manifest(manifest), std::invalid_argument);
+}
@@ -38,6 +38,44 @@ TEST(ReadProcessingStats, GivenOneOKAndOneEmptyGenomicRead_CorrectStats) {
   EXPECT_FLOAT_EQ(r.get_mean_pb_error(), 0.001);
 }
 
+TEST(ReadTally, GivenReads_CorrectHistograms) {
+  ReadTally tally;
+  tally.add_read(4, encode_dna_bases("GCAT"), "55?5");
+  tally.add_read(4, encode_dna_bases("GGGC"), "");
+  // Non-ACGT bases: length is tallied, but not GC content
+  tally.add_read(3, encode_dna_bases("GNC"), "555");
+
+  EXPECT_EQ(tally.num_reads, 3);
+  EXPECT_EQ(tally.no_qual_reads, 1);
+  EXPECT_EQ(tally.quality_histogram[20], 6);
+  EXPECT_EQ(tally.quality_histogram[30], 1);
+  ReadTally::LengthHistogram expected_lengths{{3, 1}, {4, 2}};
+  EXPECT_EQ(tally.length_histogram, expected_lengths);
+  EXPECT_EQ(tally.gc_histogram[50], 1);
+  EXPECT_EQ(tally.gc_histogram[100], 1);
+}
+
+TEST(ReadTally, MergeThreadTallies_SameStatsAsSingleTally) {
+  GenomicRead_vector reads{GenomicRead{"Read1", "AAAA", "5555"},
+                           GenomicRead{"Read2", "TTTTTT", "??????"},
+                           GenomicRead{"Read3", "CC", ""}};
+  ReadTally first, second;
+  first.add_read(4, encode_dna_bases("AAAA"), "5555");
+  second.add_read(6, encode_dna_bases("TTTTTT"), "??????");
+  second.add_read(2, encode_dna_bases("CC"), "");
+  first.merge(second);
+
+  ReadStats merged, single;
+  merged.compute_read_stats(first);
+  single.compute_base_error_rate(reads);
+
+  EXPECT_EQ(merged.get_max_read_len(), 6);
+  EXPECT_EQ(merged.get_max_read_len(), single.get_max_read_len());
+  EXPECT_EQ(merged.get_num_bases_processed(), 10);
+  EXPECT_EQ(merged.get_num_no_qual_reads(), 1);
+  EXPECT_FLOAT_EQ(merged.get_mean_pb_error(), single.get_mean_pb_error());
+}
+
 /**
  * Coverage mean and variance
  * Notes:
@@ -180,3 +218,34 @@ TEST(ReadMappingStats,
   EXPECT_EQ(stats.get_num_sites_noCov(), 0);
   EXPECT_EQ(stats.get_num_sites_total(), 1);
 }
+
+TEST(ReadStatsSerialisation, SerialiseThenDeserialise_SameStats) {
+  GenomicRead_vector reads{GenomicRead{"Read1", "AAA", "#5I"},
+                           GenomicRead{"Read2", "GCAAA", "#####"}};
+  prg_setup setup;
+  setup.setup_numbered_prg("G5CAAA6AA6T7G8C8GGG");
+  setup.quasimap_reads(reads);
+
+  auto const fpath = fs::temp_directory_path() / "test_read_stats.json";
+  setup.read_stats.serialise(fpath.string());
+  ReadStats loaded;
+  loaded.deserialise(fpath.string());
+  fs::remove(fpath);
+
+  auto const& expected = setup.read_stats;
+  EXPECT_EQ(loaded.get_mean_pb_error(), expected.get_mean_pb_error());
+  EXPECT_EQ(loaded.get_mean_cov(), expected.get_mean_cov());
+  EXPECT_EQ(loaded.get_var_cov(), expected.get_var_cov());
+  EXPECT_EQ(loaded.get_num_sites_noCov(), expected.get_num_sites_noCov());
+  EXPECT_EQ(loaded.get_num_sites_total(), expected.get_num_sites_total());
+  EXPECT_EQ(loaded.get_max_read_len(), expected.get_max_read_len());
+  EXPECT_EQ(loaded.get_num_bases_processed(),
+            expected.get_num_bases_processed());
+  EXPECT_EQ(loaded.get_num_no_qual_reads(), expected.get_num_no_qual_reads());
+  auto const& loaded_tally = loaded.get_read_tally();
+  auto const& expected_tally = expected.get_read_tally();
+  EXPECT_EQ(loaded_tally.num_reads, expected_tally.num_reads);
+  EXPECT_EQ(loaded_tally.quality_histogram, expected_tally.quality_histogram);
+  EXPECT_EQ(loaded_tally.length_histogram, expected_tally.length_histogram);
+  EXPECT_EQ(loaded_tally.gc_histogram, expected_tally.gc_histogram);
+}
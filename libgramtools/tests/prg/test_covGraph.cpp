@@ -47,6 +47,28 @@ TEST(coverage_Graph, is_nested_status) {
   EXPECT_TRUE(nested_g.is_nested);
 }
 
+TEST(coverage_Graph, ClearCoverage_AllBubbleNodesZeroed) {
+  std::string prg{"AT[GC,[A,CT]G]A"};
+  marker_vec v = prg_string_to_ints(prg);
+  PRG_String p{v};
+  coverage_Graph g{p};
+
+  std::vector<covG_ptr> covered_nodes;
+  for (auto const& entry : g.random_access) {
+    auto& coverage = entry.node->get_ref_to_coverage();
+    if (coverage.empty()) continue;
+    coverage.assign(coverage.size(), 3);
+    covered_nodes.push_back(entry.node);
+  }
+  ASSERT_FALSE(covered_nodes.empty());
+
+  g.clear_coverage();
+  for (auto const& node : covered_nodes) {
+    PerBaseCoverage expected(node->get_sequence_size(), 0);
+    EXPECT_EQ(node->get_coverage(), expected);
+  }
+}
+
 TEST(coverage_Graph, SequencePositions) {
   // Check POS is based on first (REF) allele of each site
   std::string prg{"ATCG[G[A,CCC]C,G]A[AT,T]A"};
@@ -0,0 +1,261 @@
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "serve/serve.hpp"
+
+using namespace gram;
+using namespace gram::serve;
+
+auto const serve_test_dir =
+    fs::path(__FILE__).parent_path().parent_path() / "test_data" / "serve_job";
+
+class Serve_JobRequest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    server_parameters.gram_dirpath = "/data/gram_dir";
+    server_parameters.kmers_size = 5;
+    server_parameters.maximum_threads = 4;
+    request = JSON{{"sample_id", "s1"},
+                   {"reads", {"/data/s1_1.fq", "/data/s1_2.fq"}},
+                   {"ploidy", "diploid"},
+                   {"output_dir", serve_test_dir.string()}};
+  }
+  void TearDown() override { fs::remove_all(serve_test_dir); }
+
+  CommonParameters server_parameters;
+  JSON request;
+};
+
+TEST_F(Serve_JobRequest, GivenValidRequest_JobParametersSet) {
+  auto result = make_job_parameters(request, server_parameters);
+
+  EXPECT_EQ(result.gram_dirpath, "/data/gram_dir");
+  EXPECT_EQ(result.kmers_size, 5);
+  EXPECT_EQ(result.maximum_threads, 4);
+  EXPECT_EQ(result.sample_id, "s1");
+  std::vector<std::string> expected_reads{"/data/s1_1.fq", "/data/s1_2.fq"};
+  EXPECT_EQ(result.reads_fpaths, expected_reads);
+  EXPECT_EQ(result.ploidy, Ploidy::Diploid);
+  EXPECT_FALSE(result.seed.has_value());
+  auto expected_json_fpath =
+      fs::absolute(serve_test_dir / "genotype" / "genotyped.json");
+  EXPECT_EQ(result.genotyped_json_fpath, expected_json_fpath.string());
+  EXPECT_TRUE(fs::exists(serve_test_dir / "coverage"));
+  // Each job reports its own instrumentation, in its output directory
+  EXPECT_EQ(result.instrumentation_fpath,
+            fs::absolute(serve_test_dir / "instrumentation.json").string());
+}
+
+TEST_F(Serve_JobRequest, GivenSeed_SeedSet) {
+  request["seed"] = 42;
+  auto result = make_job_parameters(request, server_parameters);
+  EXPECT_EQ(result.seed, Seed{42});
+}
+
+TEST_F(Serve_JobRequest, GivenSeedOutOfRange_Throws) {
+  request["seed"] = -1;
+  EXPECT_THROW(make_job_parameters(request, server_parameters),
+               ServeRequestException);
+  request["seed"] = uint64_t{1} << 32;
+  EXPECT_THROW(make_job_parameters(request, server_parameters),
+               ServeRequestException);
+}
+
+TEST_F(Serve_JobRequest, GivenPaired_PairedModeSet) {
+  request["paired"] = true;
+  request["max_insert_size"] = 500;
+  auto result = make_job_parameters(request, server_parameters);
+  EXPECT_TRUE(result.paired);
+  EXPECT_EQ(result.max_insert_size, 500);
+
+  request["reads"] = {"/data/s1_1.fq"};
+  EXPECT_THROW(make_job_parameters(request, server_parameters),
+               ServeRequestException);
+}
+
+TEST_F(Serve_JobRequest, GivenSubsampling_FractionAndDepthSet) {
+  request["subsample_fraction"] = 0.5;
+  request["max_mean_depth"] = 30;
+  auto result = make_job_parameters(request, server_parameters);
+  EXPECT_EQ(result.subsample_fraction, 0.5);
+  EXPECT_EQ(result.max_mean_depth, 30);
+
+  request["subsample_fraction"] = 0;
+  EXPECT_THROW(make_job_parameters(request, server_parameters),
+               ServeRequestException);
+}
+
+TEST_F(Serve_JobRequest, GivenFromCoverage_NoReadsNeeded) {
+  request.erase("reads");
+  request["from_coverage"] = true;
+  auto result = make_job_parameters(request, server_parameters);
+  EXPECT_TRUE(result.from_coverage);
+  EXPECT_TRUE(result.reads_fpaths.empty());
+
+  request["reads"] = {"/data/s1_1.fq"};
+  EXPECT_THROW(make_job_parameters(request, server_parameters),
+               ServeRequestException);
+}
+
+TEST_F(Serve_JobRequest, GivenMissingOrInvalidEntries_Throws) {
+  for (auto const& key : {"sample_id", "reads", "ploidy", "output_dir"}) {
+    auto incomplete_request = request;
+    incomplete_request.erase(key);
+    EXPECT_THROW(make_job_parameters(incomplete_request, server_parameters),
+                 ServeRequestException);
+  }
+
+  request["ploidy"] = "triploid";
+  EXPECT_THROW(make_job_parameters(request, server_parameters),
+               ServeRequestException);
+
+  request["ploidy"] = "haploid";
+  request["reads"] = JSON::array();
+  EXPECT_THROW(make_job_parameters(request, server_parameters),
+               ServeRequestException);
+}
+
+TEST(Serve_JobResponse, GivenStats_StatsInResponse) {
+  GenotypeParams job_parameters;
+  job_parameters.sample_id = "s1";
+  QuasimapReadsStats stats;
+  stats.all_reads_count = 10;
+  stats.exact_mapped_reads_count = 6;
+
+  auto result = make_job_response(job_parameters, stats);
+  EXPECT_EQ(result.at("status"), "ok");
+  EXPECT_EQ(result.at("sample_id"), "s1");
+  EXPECT_EQ(result.at("stats").at("all_reads_count"), 10);
+  EXPECT_EQ(result.at("stats").at("exact_mapped_reads_count"), 6);
+}
+
+TEST(Serve_JobQueue, JobsPoppedInOrder_ResponsesDelivered) {
+  JobQueue queue;
+  GenotypeParams first, second;
+  first.sample_id = "s1";
+  second.sample_id = "s2";
+  auto first_response = queue.push(first);
+  auto second_response = queue.push(second);
+  ASSERT_TRUE(first_response && second_response);
+
+  std::thread runner([&queue] {
+    GenotypeJob job;
+    while (queue.pop(job))
+      job.response.set_value(JSON{{"sample_id", job.parameters.sample_id}});
+  });
+  EXPECT_EQ(first_response->get().at("sample_id"), "s1");
+  EXPECT_EQ(second_response->get().at("sample_id"), "s2");
+
+  queue.close();
+  runner.join();
+}
+
+TEST(Serve_JobQueue, GivenClosedQueue_PushRefused) {
+  JobQueue queue;
+  queue.close();
+  EXPECT_FALSE(queue.push(GenotypeParams{}).has_value());
+  GenotypeJob job;
+  EXPECT_FALSE(queue.pop(job));
+}
+
+class Serve_SocketServer : public Serve_JobRequest {
+ protected:
+  void SetUp() override {
+    Serve_JobRequest::SetUp();
+    fs::remove(socket_fpath);
+  }
+  void TearDown() override {
+    Serve_JobRequest::TearDown();
+    fs::remove(socket_fpath);
+  }
+
+  int connect_client() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_fpath.c_str(),
+                 sizeof(address.sun_path) - 1);
+    int const fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address),
+                  sizeof(address)) < 0) {
+      ::close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  /** Sends `request` as one line, and parses the line sent back */
+  JSON exchange(int fd, std::string const& request) {
+    auto const line = request + '\n';
+    ::send(fd, line.data(), line.size(), MSG_NOSIGNAL);
+    std::string response;
+    char c;
+    while (::recv(fd, &c, 1, 0) == 1 && c != '\n') response.push_back(c);
+    return JSON::parse(response);
+  }
+
+  std::string const socket_fpath =
+      (fs::temp_directory_path() / "test_serve.sock").string();
+};
+
+TEST_F(Serve_SocketServer, GivenClientRequests_ResponsesSentBack) {
+  JobQueue queue;
+  SocketServer server(socket_fpath, server_parameters, queue);
+  struct stat socket_stat;
+  ASSERT_EQ(::stat(socket_fpath.c_str(), &socket_stat), 0);
+  EXPECT_TRUE(S_ISSOCK(socket_stat.st_mode));
+  EXPECT_EQ(socket_stat.st_mode & 0077, 0);  // Only the user can connect
+
+  std::thread runner([&queue] {
+    GenotypeJob job;
+    while (queue.pop(job))
+      job.response.set_value(
+          make_job_response(job.parameters, QuasimapReadsStats{}));
+  });
+
+  int const client_fd = connect_client();
+  ASSERT_GE(client_fd, 0);
+  EXPECT_EQ(exchange(client_fd, "{not json").at("status"), "error");
+  auto const response = exchange(client_fd, request.dump());
+  EXPECT_EQ(response.at("status"), "ok");
+  EXPECT_EQ(response.at("sample_id"), "s1");
+  request["seed"] = -1;
+  EXPECT_EQ(exchange(client_fd, request.dump()).at("status"), "error");
+  EXPECT_EQ(exchange(client_fd, R"({"command": "shutdown"})").at("status"),
+            "ok");
+  ::close(client_fd);
+
+  runner.join();
+}
+
+TEST_F(Serve_SocketServer, GivenStaleSocket_Replaced) {
+  // A server killed without cleaning up leaves its socket behind
+  int const fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socket_fpath.c_str(),
+               sizeof(address.sun_path) - 1);
+  ASSERT_EQ(::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)),
+            0);
+  ::close(fd);
+
+  JobQueue queue;
+  SocketServer server(socket_fpath, server_parameters, queue);
+  int const client_fd = connect_client();
+  EXPECT_GE(client_fd, 0);
+  ::close(client_fd);
+}
+
+TEST_F(Serve_SocketServer, GivenExistingRegularFile_NotReplaced) {
+  std::ofstream(socket_fpath) << "data";
+  JobQueue queue;
+  EXPECT_THROW(SocketServer(socket_fpath, server_parameters, queue),
+               std::runtime_error);
+  EXPECT_TRUE(fs::is_regular_file(socket_fpath));
+}